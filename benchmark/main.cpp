@@ -0,0 +1,313 @@
+// MIT License
+//
+// Copyright(c) 2022-2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "pch.h"
+
+#include <mock_runtime.h>
+#include <synthetic_app.h>
+
+#include "replay.h"
+
+// The benchmark runs the synthetic app through the layer on top of the mock runtime, for each combination of refresh
+// rate and Turbo Mode requested on the command line. It reports the latency of the OpenXR calls seen by the app,
+// along with the frame statistics that the layer logs when the session is destroyed. These include the GPU time of each
+// stage of the composition, which is best measured by replaying a capture (see replay.h) on the target GPU.
+
+namespace {
+
+    using namespace openxr_api_layer::benchmark;
+
+    // The layer appends its name to %LocalAppData% for its log file and its user settings.
+    const std::string LayerPrettyName = "Quad-Views-Foveated";
+
+    struct Options {
+        std::filesystem::path layerPath;
+        std::vector<float> refreshRates{90.f, 120.f, 144.f};
+        std::vector<bool> turboModes{false, true};
+        std::vector<std::string> settings;
+        std::optional<std::filesystem::path> replayPath;
+        bool hasFrameCount{false};
+        MockRuntimeConfig runtime;
+        SyntheticAppConfig app;
+    };
+
+    void PrintUsage(const char* program) {
+        std::cout
+            << fmt::format("Usage: {} [options]\n", program)
+            << "  --layer <path>          The layer DLL (default: next to the benchmark)\n"
+               "  --rates <list>          The display refresh rates, comma-separated (default: 90,120,144)\n"
+               "  --turbo <on|off|both>   Whether to run with Turbo Mode (default: both)\n"
+               "  --frames <count>        The number of frames recorded per run (default: 600)\n"
+               "  --setting <name=value>  A layer setting for all runs (can be repeated)\n"
+               "  --stereo                Use the stereo view configuration instead of quad views\n"
+               "  --no-foveated           Do not request foveated rendering\n"
+               "  --no-eye-tracking       Make the runtime report no eye tracker\n"
+               "  --gaze <pattern>        The eye gaze: center, saccades or sweep (default: saccades)\n"
+               "  --head-motion <radians> The amplitude of the head yaw oscillation (default: 0)\n"
+               "  --replay <directory>    Replay the images and eye gaze of a capture\n"
+               "  --depth                 Submit depth buffers\n"
+               "  --warp                  Use the WARP software device\n";
+    }
+
+    Options ParseArguments(int argc, char** argv) {
+        Options options;
+
+        char path[_MAX_PATH];
+        GetModuleFileNameA(nullptr, path, sizeof(path));
+#ifdef _WIN64
+        options.layerPath = std::filesystem::path(path).parent_path() / (LAYER_NAME ".dll");
+#else
+        options.layerPath = std::filesystem::path(path).parent_path() / (LAYER_NAME "-32.dll");
+#endif
+
+        for (int i = 1; i < argc; i++) {
+            const std::string_view arg(argv[i]);
+            const auto nextArg = [&]() -> std::string {
+                if (i + 1 >= argc) {
+                    throw std::runtime_error(fmt::format("Missing value for {}", arg));
+                }
+                return argv[++i];
+            };
+
+            if (arg == "--layer") {
+                options.layerPath = nextArg();
+            } else if (arg == "--rates") {
+                options.refreshRates.clear();
+                std::stringstream rates(nextArg());
+                std::string rate;
+                while (std::getline(rates, rate, ',')) {
+                    options.refreshRates.push_back(std::stof(rate));
+                }
+            } else if (arg == "--turbo") {
+                const std::string value = nextArg();
+                if (value == "on") {
+                    options.turboModes = {true};
+                } else if (value == "off") {
+                    options.turboModes = {false};
+                } else if (value == "both") {
+                    options.turboModes = {false, true};
+                } else {
+                    throw std::runtime_error(fmt::format("Invalid Turbo Mode: {}", value));
+                }
+            } else if (arg == "--frames") {
+                options.app.frameCount = std::stoi(nextArg());
+                options.hasFrameCount = true;
+            } else if (arg == "--setting") {
+                options.settings.push_back(nextArg());
+            } else if (arg == "--stereo") {
+                options.app.useQuadViews = false;
+            } else if (arg == "--no-foveated") {
+                options.app.useFoveatedRendering = false;
+            } else if (arg == "--no-eye-tracking") {
+                options.runtime.supportsEyeTracking = false;
+            } else if (arg == "--gaze") {
+                const std::string value = nextArg();
+                if (value == "center") {
+                    options.runtime.gazePattern = GazePattern::Center;
+                } else if (value == "saccades") {
+                    options.runtime.gazePattern = GazePattern::Saccades;
+                } else if (value == "sweep") {
+                    options.runtime.gazePattern = GazePattern::Sweep;
+                } else {
+                    throw std::runtime_error(fmt::format("Invalid gaze pattern: {}", value));
+                }
+            } else if (arg == "--head-motion") {
+                options.runtime.headMotionAmplitude = std::stof(nextArg());
+            } else if (arg == "--replay") {
+                options.replayPath = nextArg();
+            } else if (arg == "--depth") {
+                options.app.submitDepth = true;
+            } else if (arg == "--warp") {
+                options.app.useWarpDevice = true;
+            } else {
+                throw std::runtime_error(fmt::format("Unknown option: {}", arg));
+            }
+        }
+
+        return options;
+    }
+
+    // The user settings file is read by the layer upon xrGetSystem(), after the settings shipped with the layer.
+    void WriteSettings(const std::filesystem::path& path, const Options& options, bool useTurboMode) {
+        std::ofstream settings(path, std::ios_base::trunc);
+        if (!settings.is_open()) {
+            throw std::runtime_error(fmt::format("Failed to write {}", path.string()));
+        }
+        settings << "frame_statistics=1\n";
+        // Only log the statistics once, when the session is destroyed.
+        settings << "frame_statistics_interval=3600\n";
+        settings << "turbo_mode=" << (useTurboMode ? 1 : 0) << "\n";
+        for (const auto& setting : options.settings) {
+            settings << setting << "\n";
+        }
+    }
+
+    // Return the statistics lines that the layer logged past the given offset in its log file.
+    std::vector<std::string> ReadLayerStatistics(const std::filesystem::path& path, std::streamoff offset) {
+        std::vector<std::string> lines;
+        std::ifstream log(path);
+        log.seekg(offset);
+        std::string line;
+        while (std::getline(log, line)) {
+            for (const auto& prefix : {"Frame statistics", "Layer CPU overhead"}) {
+                const auto position = line.find(prefix);
+                if (position != std::string::npos) {
+                    lines.push_back(line.substr(position));
+                }
+            }
+        }
+        return lines;
+    }
+
+    std::streamoff GetFileSize(const std::filesystem::path& path) {
+        std::error_code error;
+        const auto size = std::filesystem::file_size(path, error);
+        return error ? 0 : static_cast<std::streamoff>(size);
+    }
+
+    std::string FormatLatency(const LatencyStatistics& stats) {
+        return fmt::format("{:<26}{:>10.1f}{:>10.1f}{:>10.1f}",
+                           stats.name,
+                           stats.percentile(50) / 1000.f,
+                           stats.percentile(95) / 1000.f,
+                           stats.percentile(99) / 1000.f);
+    }
+
+    void PrintResults(const SyntheticAppResults& results,
+                      const MockRuntimeStatistics& runtimeStatistics,
+                      const std::vector<std::string>& layerStatistics,
+                      const ReplayFrameSource* replay,
+                      float refreshRate) {
+        std::cout << fmt::format("  Views:");
+        for (const auto& view : results.views) {
+            std::cout << fmt::format(" {}x{}", view.recommendedImageRectWidth, view.recommendedImageRectHeight);
+        }
+        std::cout << "\n";
+        std::cout << fmt::format("  Runtime: {} frames submitted, {} discarded, {} eye gaze queries\n",
+                                 runtimeStatistics.framesSubmitted,
+                                 runtimeStatistics.framesDiscarded,
+                                 runtimeStatistics.eyeGazeQueries);
+        std::cout << fmt::format("  App: {} frames discarded\n", results.framesDiscarded);
+
+        std::cout << fmt::format("  {:<26}{:>10}{:>10}{:>10}\n", "Call (us)", "p50", "p95", "p99");
+        for (const auto& call : results.calls) {
+            std::cout << "  " << FormatLatency(call) << "\n";
+        }
+        std::cout << "  " << FormatLatency(results.frameInterval)
+                  << fmt::format(" (period {:.1f})\n", 1e6f / refreshRate);
+
+        for (const auto& line : layerStatistics) {
+            std::cout << "  " << line << "\n";
+        }
+
+        if (replay && replay->getMaxFocusFovDeviation()) {
+            std::cout << fmt::format("  Replay: focus FOV deviates by up to {:.4f} rad from the capture\n",
+                                     *replay->getMaxFocusFovDeviation());
+        }
+    }
+
+    MockRuntimeStatistics operator-(const MockRuntimeStatistics& a, const MockRuntimeStatistics& b) {
+        return {a.framesWaited - b.framesWaited,
+                a.framesBegun - b.framesBegun,
+                a.framesDiscarded - b.framesDiscarded,
+                a.framesSubmitted - b.framesSubmitted,
+                a.layersSubmitted - b.layersSubmitted,
+                a.eyeGazeQueries - b.eyeGazeQueries};
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    try {
+        Options options = ParseArguments(argc, argv);
+
+        std::optional<Capture> capture;
+        if (options.replayPath) {
+            capture = LoadCapture(*options.replayPath);
+            std::cout << fmt::format(
+                "Loaded {} frames from {}\n", capture->frames.size(), options.replayPath->string());
+
+            if (capture->resolution) {
+                options.runtime.recommendedResolution = *capture->resolution;
+            }
+            for (uint32_t eye = 0; eye < std::size(capture->eyeFov); eye++) {
+                if (capture->eyeFov[eye]) {
+                    options.runtime.eyeFov[eye] = *capture->eyeFov[eye];
+                }
+            }
+            options.runtime.gazePattern = GazePattern::Replay;
+            if (!options.hasFrameCount) {
+                options.app.frameCount = static_cast<uint32_t>(capture->frames.size());
+            }
+        }
+
+        // Keep the log and the settings of the layer away from the user's.
+        const std::filesystem::path localAppData = std::filesystem::temp_directory_path() / "quad-views-benchmark";
+        const std::filesystem::path layerAppData = localAppData / LayerPrettyName;
+        std::filesystem::create_directories(layerAppData);
+        SetEnvironmentVariableA("LOCALAPPDATA", localAppData.string().c_str());
+        const std::filesystem::path logPath = layerAppData / (LayerPrettyName + ".log");
+        const std::filesystem::path settingsPath = layerAppData / "settings.cfg";
+
+        const LoadedLayer layer = LoadLayer(options.layerPath);
+        std::cout << fmt::format("Loaded {}\n", options.layerPath.string());
+
+        for (const float refreshRate : options.refreshRates) {
+            for (const bool useTurboMode : options.turboModes) {
+                std::cout << fmt::format("\n{} Hz, {}{}, Turbo Mode {}\n",
+                                         refreshRate,
+                                         options.app.useQuadViews ? "quad views" : "stereo",
+                                         options.app.useQuadViews && options.app.useFoveatedRendering ? ", foveated"
+                                                                                                      : "",
+                                         useTurboMode ? "on" : "off");
+
+                WriteSettings(settingsPath, options, useTurboMode);
+                MockRuntimeConfig runtimeConfig = options.runtime;
+                runtimeConfig.displayRefreshRate = refreshRate;
+                ConfigureMockRuntime(runtimeConfig);
+
+                const std::streamoff logOffset = GetFileSize(logPath);
+                const MockRuntimeStatistics runtimeStatisticsBefore = GetMockRuntimeStatistics();
+                std::unique_ptr<ReplayFrameSource> replay;
+                if (capture) {
+                    replay = std::make_unique<ReplayFrameSource>(*capture);
+                }
+                const SyntheticAppResults results = RunSyntheticApp(layer, options.app, replay.get());
+
+                PrintResults(results,
+                             GetMockRuntimeStatistics() - runtimeStatisticsBefore,
+                             ReadLayerStatistics(logPath, logOffset),
+                             replay.get(),
+                             refreshRate);
+            }
+        }
+
+        FreeLibrary(layer.module);
+    } catch (std::exception& exc) {
+        std::cerr << exc.what() << "\n";
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,238 @@
+// MIT License
+//
+// Copyright(c) 2022-2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "pch.h"
+
+#include "replay.h"
+
+namespace openxr_api_layer::benchmark {
+
+    namespace {
+
+        XrFovf ReadFov(std::istream& stream) {
+            XrFovf fov{};
+            stream >> fov.angleLeft >> fov.angleRight >> fov.angleUp >> fov.angleDown;
+            return fov;
+        }
+
+        float GetFovDeviation(const XrFovf& a, const XrFovf& b) {
+            return std::max({std::abs(a.angleLeft - b.angleLeft),
+                             std::abs(a.angleRight - b.angleRight),
+                             std::abs(a.angleUp - b.angleUp),
+                             std::abs(a.angleDown - b.angleDown)});
+        }
+
+    } // namespace
+
+    Capture LoadCapture(const std::filesystem::path& directory) {
+        const std::filesystem::path capturePath = directory / "capture.txt";
+        std::ifstream file(capturePath);
+        if (!file.is_open()) {
+            throw std::runtime_error(fmt::format("Failed to open {}", capturePath.string()));
+        }
+
+        Capture capture;
+        std::string line;
+        unsigned int lineNumber = 0;
+        while (std::getline(file, line)) {
+            lineNumber++;
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+
+            std::istringstream stream(line);
+            std::string type;
+            stream >> type;
+            if (type == "resolution") {
+                XrExtent2Di resolution{};
+                stream >> resolution.width >> resolution.height;
+                capture.resolution = resolution;
+            } else if (type == "eye") {
+                uint32_t eye = 0;
+                stream >> eye;
+                if (eye >= std::size(capture.eyeFov)) {
+                    throw std::runtime_error(fmt::format("L{}: Invalid eye index {}", lineNumber, eye));
+                }
+                capture.eyeFov[eye] = ReadFov(stream);
+            } else if (type == "frame") {
+                CaptureFrame frame;
+                for (auto& image : frame.images) {
+                    std::string path;
+                    stream >> path;
+                    image = directory / path;
+                }
+                stream >> frame.eyeGaze.x >> frame.eyeGaze.y >> frame.eyeGaze.z;
+                if (stream.fail()) {
+                    throw std::runtime_error(fmt::format("L{}: Incomplete frame", lineNumber));
+                }
+                std::array<XrFovf, 2> focusFov;
+                focusFov[0] = ReadFov(stream);
+                focusFov[1] = ReadFov(stream);
+                if (!stream.fail()) {
+                    frame.focusFov = focusFov;
+                }
+                capture.frames.push_back(std::move(frame));
+                continue;
+            } else {
+                throw std::runtime_error(fmt::format("L{}: Unknown statement \"{}\"", lineNumber, type));
+            }
+
+            if (stream.fail()) {
+                throw std::runtime_error(fmt::format("L{}: Invalid \"{}\" statement", lineNumber, type));
+            }
+        }
+
+        if (capture.frames.empty()) {
+            throw std::runtime_error(fmt::format("No frames in {}", capturePath.string()));
+        }
+
+        return capture;
+    }
+
+    ReplayFrameSource::ReplayFrameSource(Capture capture) : m_capture(std::move(capture)) {
+        // WIC works with either threading model, so we use the one already set up on this thread, if any.
+        const HRESULT hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+        if (hr != RPC_E_CHANGED_MODE) {
+            CHECK_HRCMD(hr);
+            m_needComUninitialize = true;
+        }
+        CHECK_HRCMD(CoCreateInstance(CLSID_WICImagingFactory,
+                                     nullptr,
+                                     CLSCTX_INPROC_SERVER,
+                                     IID_PPV_ARGS(m_wicFactory.ReleaseAndGetAddressOf())));
+    }
+
+    ReplayFrameSource::~ReplayFrameSource() {
+        // Release the WIC objects before COM goes away.
+        m_wicFactory.Reset();
+        if (m_needComUninitialize) {
+            CoUninitialize();
+        }
+    }
+
+    void ReplayFrameSource::initialize(ID3D11Device* device,
+                                       const std::vector<XrViewConfigurationView>& views,
+                                       DXGI_FORMAT colorFormat) {
+        // The images are copied as-is into the swapchains, so they must be decoded in the same pixel layout.
+        if (colorFormat != DXGI_FORMAT_R8G8B8A8_UNORM_SRGB && colorFormat != DXGI_FORMAT_B8G8R8A8_UNORM_SRGB) {
+            throw std::runtime_error(fmt::format("Unsupported swapchain format {}", static_cast<int>(colorFormat)));
+        }
+
+        // Load all the images before the frame loop starts, so that the disk accesses do not skew the timings.
+        m_images.clear();
+        m_frameImages.clear();
+        for (const auto& frame : m_capture.frames) {
+            std::array<ID3D11Texture2D*, 4> images{};
+            for (uint32_t i = 0; i < views.size() && i < std::size(images); i++) {
+                images[i] = loadImage(device, frame.images[i], colorFormat);
+            }
+            m_frameImages.push_back(images);
+        }
+    }
+
+    void ReplayFrameSource::beginFrame(uint32_t frameIndex) {
+        SetMockEyeGaze(m_capture.frames[frameIndex % m_capture.frames.size()].eyeGaze);
+    }
+
+    void ReplayFrameSource::renderView(uint32_t frameIndex,
+                                       uint32_t viewIndex,
+                                       const XrView& view,
+                                       ID3D11DeviceContext* context,
+                                       ID3D11Texture2D* texture,
+                                       ID3D11RenderTargetView* renderTargetView) {
+        const uint32_t captureIndex = frameIndex % m_capture.frames.size();
+        ID3D11Texture2D* const image = m_frameImages[captureIndex][viewIndex];
+
+        D3D11_TEXTURE2D_DESC sourceDesc;
+        image->GetDesc(&sourceDesc);
+        D3D11_TEXTURE2D_DESC destinationDesc;
+        texture->GetDesc(&destinationDesc);
+
+        // The captured images may not match the resolution of the swapchains. Crop them or leave a black border.
+        if (sourceDesc.Width < destinationDesc.Width || sourceDesc.Height < destinationDesc.Height) {
+            const float clearColor[] = {0, 0, 0, 1};
+            context->ClearRenderTargetView(renderTargetView, clearColor);
+        }
+        D3D11_BOX box{};
+        box.right = std::min(sourceDesc.Width, destinationDesc.Width);
+        box.bottom = std::min(sourceDesc.Height, destinationDesc.Height);
+        box.back = 1;
+        context->CopySubresourceRegion(texture, 0, 0, 0, 0, image, 0, &box);
+
+        // The focus views come after the stereo views.
+        const auto& focusFov = m_capture.frames[captureIndex].focusFov;
+        if (focusFov && viewIndex >= xr::StereoView::Count) {
+            const float deviation = GetFovDeviation((*focusFov)[viewIndex - xr::StereoView::Count], view.fov);
+            m_maxFocusFovDeviation = std::max(m_maxFocusFovDeviation.value_or(0.f), deviation);
+        }
+    }
+
+    ID3D11Texture2D* ReplayFrameSource::loadImage(ID3D11Device* device,
+                                                  const std::filesystem::path& path,
+                                                  DXGI_FORMAT format) {
+        auto it = m_images.find(path);
+        if (it != m_images.end()) {
+            return it->second.Get();
+        }
+
+        ComPtr<IWICBitmapDecoder> decoder;
+        CHECK_HRCMD(m_wicFactory->CreateDecoderFromFilename(
+            path.c_str(), nullptr, GENERIC_READ, WICDecodeMetadataCacheOnDemand, decoder.ReleaseAndGetAddressOf()));
+        ComPtr<IWICBitmapFrameDecode> frame;
+        CHECK_HRCMD(decoder->GetFrame(0, frame.ReleaseAndGetAddressOf()));
+        ComPtr<IWICFormatConverter> converter;
+        CHECK_HRCMD(m_wicFactory->CreateFormatConverter(converter.ReleaseAndGetAddressOf()));
+        CHECK_HRCMD(converter->Initialize(frame.Get(),
+                                          format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB ? GUID_WICPixelFormat32bppBGRA
+                                                                                    : GUID_WICPixelFormat32bppRGBA,
+                                          WICBitmapDitherTypeNone,
+                                          nullptr,
+                                          0.f,
+                                          WICBitmapPaletteTypeCustom));
+
+        UINT width, height;
+        CHECK_HRCMD(converter->GetSize(&width, &height));
+        std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4);
+        CHECK_HRCMD(converter->CopyPixels(nullptr, width * 4, static_cast<UINT>(pixels.size()), pixels.data()));
+
+        // The images are expected to be captured from sRGB swapchains.
+        D3D11_TEXTURE2D_DESC desc{};
+        desc.Format = format;
+        desc.Width = width;
+        desc.Height = height;
+        desc.ArraySize = 1;
+        desc.MipLevels = 1;
+        desc.SampleDesc.Count = 1;
+        desc.Usage = D3D11_USAGE_IMMUTABLE;
+        desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+        D3D11_SUBRESOURCE_DATA data{};
+        data.pSysMem = pixels.data();
+        data.SysMemPitch = width * 4;
+        ComPtr<ID3D11Texture2D> texture;
+        CHECK_HRCMD(device->CreateTexture2D(&desc, &data, texture.ReleaseAndGetAddressOf()));
+
+        m_images.insert_or_assign(path, texture);
+        return texture.Get();
+    }
+
+} // namespace openxr_api_layer::benchmark
@@ -0,0 +1,102 @@
+// MIT License
+//
+// Copyright(c) 2022-2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include <mock_runtime.h>
+#include <synthetic_app.h>
+
+namespace openxr_api_layer::benchmark {
+
+    // A capture is a directory with a capture.txt file describing the frames, and the images it references. Images are
+    // loaded through WIC, so any format it decodes (PNG, BMP, DDS...) works, and they are treated as sRGB. The paths
+    // are relative to the directory. Lines starting with '#' are comments. The file contains:
+    //
+    //   resolution <width> <height>
+    //     Optional. The recommended resolution reported by the runtime.
+    //
+    //   eye <index> <angleLeft> <angleRight> <angleUp> <angleDown>
+    //     Optional. The FOV of the headset for the left (0) or right (1) eye, in radians.
+    //
+    //   frame <left> <right> <leftFocus> <rightFocus> <gazeX> <gazeY> <gazeZ> [<leftFocusFov> <rightFocusFov>]
+    //     The images for the views of a frame, and the eye gaze direction in view space (-Z forward). The focus images
+    //     are ignored with the stereo view configuration. The focus FOVs, each as 4 angles in the order above, are the
+    //     ones the layer returned when the frame was captured. When present, they are compared to the ones returned
+    //     during the replay.
+    //
+    // The layer does not write captures. They are put together from the swapchain images of the application, exported
+    // with a graphics debugger such as PIX or RenderDoc, and from the "EyeGaze" and "xrLocateViews" events that the
+    // layer traces in a recording made with scripts/Capture-ETL.bat. For example:
+    //
+    //   resolution 2064 2208
+    //   frame left0.png right0.png focusLeft0.png focusRight0.png 0 0 -1
+    //   frame left1.png right1.png focusLeft1.png focusRight1.png 0.05 -0.02 -0.998
+    struct CaptureFrame {
+        std::filesystem::path images[4];
+        XrVector3f eyeGaze{0, 0, -1};
+        std::optional<std::array<XrFovf, 2>> focusFov;
+    };
+
+    struct Capture {
+        std::optional<XrExtent2Di> resolution;
+        std::optional<XrFovf> eyeFov[2];
+        std::vector<CaptureFrame> frames;
+    };
+
+    Capture LoadCapture(const std::filesystem::path& directory);
+
+    // Feed the captured images and eye gaze to the synthetic app. The mock runtime must use GazePattern::Replay.
+    class ReplayFrameSource : public FrameSource {
+      public:
+        explicit ReplayFrameSource(Capture capture);
+        ~ReplayFrameSource() override;
+
+        void initialize(ID3D11Device* device,
+                        const std::vector<XrViewConfigurationView>& views,
+                        DXGI_FORMAT colorFormat) override;
+        void beginFrame(uint32_t frameIndex) override;
+        void renderView(uint32_t frameIndex,
+                        uint32_t viewIndex,
+                        const XrView& view,
+                        ID3D11DeviceContext* context,
+                        ID3D11Texture2D* texture,
+                        ID3D11RenderTargetView* renderTargetView) override;
+
+        // The largest difference between a recorded focus FOV angle and the replayed one, in radians.
+        std::optional<float> getMaxFocusFovDeviation() const {
+            return m_maxFocusFovDeviation;
+        }
+
+      private:
+        ID3D11Texture2D* loadImage(ID3D11Device* device, const std::filesystem::path& path, DXGI_FORMAT format);
+
+        const Capture m_capture;
+        bool m_needComUninitialize{false};
+        ComPtr<IWICImagingFactory> m_wicFactory;
+        // The images are loaded upfront and shared between the frames that reference them.
+        std::map<std::filesystem::path, ComPtr<ID3D11Texture2D>> m_images;
+        std::vector<std::array<ID3D11Texture2D*, 4>> m_frameImages;
+        std::optional<float> m_maxFocusFovDeviation;
+    };
+
+} // namespace openxr_api_layer::benchmark
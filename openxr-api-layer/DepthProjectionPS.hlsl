@@ -0,0 +1,73 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// A Pixel Shader that composites the depth of the focus view into the depth of the stereo view, using the same
+// projection as ProjectionPS.hlsl.
+
+// Must match the layout of the constant buffer in ProjectionPS.hlsl. Only the leading members are declared.
+cbuffer ConstantBuffer : register(b0) {
+    float smoothingArea;
+    bool ignoreAlpha;
+    bool isUnpremultipliedAlpha;
+    bool debugFocusView;
+    float sharpeningPeak;
+    bool peripheralUpscaling;
+    bool focusLayer;
+    float4 focusUVScaleBias[2];
+    float4 stereoUVClamp[2];
+    float4 focusUVClamp[2];
+};
+
+// The views are created on the array slice used by the application, so we always read slice 0.
+// There is one texture for each eye.
+Texture2DArray<float> sourceStereoDepth[2] : register(t0);
+Texture2DArray<float> sourceFocusDepth[2] : register(t2);
+
+// Depth values cannot be filtered, so the nearest texel is picked.
+float loadDepth(Texture2DArray<float> source, float2 coord, float4 uvClamp) {
+    float width, height, elements;
+    source.GetDimensions(width, height, elements);
+    int2 texel = int2(clamp(coord, uvClamp.xy, uvClamp.zw) * float2(width, height));
+    return source.Load(int4(texel, 0, 0));
+}
+
+float main(in float4 position : SV_POSITION, in float2 texcoord : PROJ_COORD0, in float3 projectedFocusCoord : PROJ_COORD1, in nointerpolation uint viewIndex : VIEW_INDEX) : SV_DEPTH {
+    float2 layer1ProjectedCoordNdc = projectedFocusCoord.xy / projectedFocusCoord.z;
+    float2 layer1TexCoord = layer1ProjectedCoordNdc * float2(0.5f, -0.5f) + 0.5f;
+
+    // Unlike color, there is no transition around the edges: the focus depth is used wherever it is available.
+    [branch] if (all(abs(layer1ProjectedCoordNdc) < 1)) {
+        float2 layer1ImageCoord = layer1TexCoord * focusUVScaleBias[viewIndex].xy + focusUVScaleBias[viewIndex].zw;
+        [branch] if (viewIndex == 0) {
+            return loadDepth(sourceFocusDepth[0], layer1ImageCoord, focusUVClamp[0]);
+        } else {
+            return loadDepth(sourceFocusDepth[1], layer1ImageCoord, focusUVClamp[1]);
+        }
+    }
+
+    [branch] if (viewIndex == 0) {
+        return loadDepth(sourceStereoDepth[0], texcoord, stereoUVClamp[0]);
+    } else {
+        return loadDepth(sourceStereoDepth[1], texcoord, stereoUVClamp[1]);
+    }
+}
@@ -0,0 +1,54 @@
+// MIT License
+//
+// Copyright(c) 2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// A pass-through Geometry Shader that routes each eye to its array slice of the render target.
+// Writing SV_RenderTargetArrayIndex from the Vertex Shader is an optional feature on D3D11.
+
+struct VSOutput {
+    float4 position : SV_POSITION;
+    float2 texcoord : PROJ_COORD0;
+    float3 projectedFocusCoord : PROJ_COORD1;
+    nointerpolation uint viewIndex : VIEW_INDEX;
+};
+
+struct GSOutput {
+    float4 position : SV_POSITION;
+    float2 texcoord : PROJ_COORD0;
+    float3 projectedFocusCoord : PROJ_COORD1;
+    nointerpolation uint viewIndex : VIEW_INDEX;
+    uint renderTargetIndex : SV_RenderTargetArrayIndex;
+};
+
+[maxvertexcount(3)]
+void main(triangle VSOutput input[3], inout TriangleStream<GSOutput> output) {
+    [unroll]
+    for (uint i = 0; i < 3; i++) {
+        GSOutput vertex;
+        vertex.position = input[i].position;
+        vertex.texcoord = input[i].texcoord;
+        vertex.projectedFocusCoord = input[i].projectedFocusCoord;
+        vertex.viewIndex = input[i].viewIndex;
+        vertex.renderTargetIndex = input[i].viewIndex;
+        output.Append(vertex);
+    }
+}
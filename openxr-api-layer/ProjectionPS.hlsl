@@ -27,11 +27,27 @@ cbuffer ConstantBuffer : register(b0) {
     bool ignoreAlpha;
     bool isUnpremultipliedAlpha;
     bool debugFocusView;
+    // When non-zero, the focus view is sharpened inline. See ffx_cas.h for the definition of the peak.
+    float sharpeningPeak;
+    // When set, the peripheral (stereo) image is reconstructed with an edge-adaptive filter instead of bilinear.
+    bool peripheralUpscaling;
+    // When set, only the focus view is drawn, with the edge transition written to the alpha channel. The output covers
+    // exactly the focus view.
+    bool focusLayer;
+    float4 focusUVScaleBias[2];
+    float4 stereoUVClamp[2];
+    float4 focusUVClamp[2];
+    // Size of a texel (xy) of the focus image.
+    float4 focusTexelSize[2];
+    // Size of a texel (xy) and size in texels (zw) of the stereo image.
+    float4 stereoTexelSize[2];
 };
 
 SamplerState sourceSampler : register(s0);
-Texture2D sourceStereoTexture : register(t0);
-Texture2D sourceFocusTexture : register(t1);
+// The views are created on the array slice used by the application, so we always sample slice 0.
+// There is one texture for each eye.
+Texture2DArray sourceStereoTexture[2] : register(t0);
+Texture2DArray sourceFocusTexture[2] : register(t2);
 
 float4 premultiplyAlpha(float4 color) {
     return float4(color.rgb * color.a, color.a);
@@ -45,14 +61,212 @@ float4 unpremultiplyAlpha(float4 color) {
     }
 }
 
-float4 main(in float4 position : SV_POSITION, in float2 texcoord : PROJ_COORD0, in float3 projectedFocusCoord : PROJ_COORD1) : SV_TARGET {
-    // Convert to texcoord and pick the pixel from each layer.
-    float4 color0 = sourceStereoTexture.Sample(sourceSampler, texcoord);
+// Contrast Adaptive Sharpening (sharpen-only variant of ffx_cas.h) evaluated on the filtered focus image. This is
+// only done for the pixels inside the focus view, and avoids a separate pass and an intermediate texture.
+float4 sampleFocus(Texture2DArray source, float2 coord, float2 texelSize, float4 uvClamp, bool sharpen) {
+    float4 e = source.Sample(sourceSampler, float3(clamp(coord, uvClamp.xy, uvClamp.zw), 0));
+    [branch] if (!sharpen) {
+        return e;
+    }
+
+#define TAP(x, y)                                                                                                     \
+    source.Sample(sourceSampler, float3(clamp(coord + float2(x, y) * texelSize, uvClamp.xy, uvClamp.zw), 0)).rgb
+    // a b c
+    // d e f
+    // g h i
+    float3 a = TAP(-1, -1);
+    float3 b = TAP(0, -1);
+    float3 c = TAP(1, -1);
+    float3 d = TAP(-1, 0);
+    float3 f = TAP(1, 0);
+    float3 g = TAP(-1, 1);
+    float3 h = TAP(0, 1);
+    float3 i = TAP(1, 1);
+#undef TAP
+
+    // Soft min and max.
+    float3 mn = min(min(min(d, e.rgb), min(f, b)), h);
+    float3 mn2 = min(mn, min(min(a, c), min(g, i)));
+    mn += mn2;
+    float3 mx = max(max(max(d, e.rgb), max(f, b)), h);
+    float3 mx2 = max(mx, max(max(a, c), max(g, i)));
+    mx += mx2;
+
+    // Smooth minimum distance to signal limit divided by smooth max.
+    float3 amp = sqrt(saturate(min(mn, 2.0 - mx) * rcp(max(mx, 1.0 / 65536.0))));
+
+    // Filter shape.
+    float3 w = amp * sharpeningPeak;
+    return float4(saturate(((b + d + f + h) * w + e.rgb) * rcp(1.0 + 4.0 * w)), e.a);
+}
+
+// Edge Adaptive Spatial Upsampling (FP32 variant of FsrEasuF() from ffx_fsr1.h) evaluated on the peripheral image.
+// The 12-tap kernel is laid out around 'f', the texel at the top-left of the output pixel:
+//    b c
+//  e f g h
+//  i j k l
+//    n o
+float easuLuma(float3 c) {
+    return c.b * 0.5 + (c.r * 0.5 + c.g);
+}
+
+void easuTap(inout float3 aC, inout float aW, float2 off, float2 dir, float2 len, float lob, float clp, float3 c) {
+    // Rotate and scale the offset into the direction of the edge.
+    float2 v = float2(off.x * dir.x + off.y * dir.y, off.x * -dir.y + off.y * dir.x) * len;
+    float d2 = min(v.x * v.x + v.y * v.y, clp);
+
+    // Approximation of lanczos2 without sin() or rcp(), or sqrt() to get x.
+    float wB = 2.0 / 5.0 * d2 - 1.0;
+    float wA = lob * d2 - 1.0;
+    wB *= wB;
+    wA *= wA;
+    wB = 25.0 / 16.0 * wB - (25.0 / 16.0 - 1.0);
+    float w = wB * wA;
+    aC += c * w;
+    aW += w;
+}
+
+// Accumulate the direction and length of the edge from one of the 4 bilinear quadrants:
+//    a
+//  b c d
+//    e
+void easuSet(inout float2 dir, inout float len, float w, float lA, float lB, float lC, float lD, float lE) {
+    float dc = lD - lC;
+    float cb = lC - lB;
+    float lenX = rcp(max(max(abs(dc), abs(cb)), 1.0 / 32768.0));
+    float dirX = lD - lB;
+    dir.x += dirX * w;
+    lenX = saturate(abs(dirX) * lenX);
+    len += lenX * lenX * w;
+
+    float ec = lE - lC;
+    float ca = lC - lA;
+    float lenY = rcp(max(max(abs(ec), abs(ca)), 1.0 / 32768.0));
+    float dirY = lE - lA;
+    dir.y += dirY * w;
+    lenY = saturate(abs(dirY) * lenY);
+    len += lenY * lenY * w;
+}
+
+float4 sampleStereoUpscaled(Texture2DArray source, float2 coord, float4 texelSize, float4 uvClamp) {
+    float2 pp = coord * texelSize.zw - 0.5;
+    float2 fp = floor(pp);
+    pp -= fp;
+
+#define TAP(x, y)                                                                                                     \
+    source.Sample(sourceSampler, float3(clamp((fp + float2(x, y) + 0.5) * texelSize.xy, uvClamp.xy, uvClamp.zw), 0))
+    float3 b = TAP(0, -1).rgb;
+    float3 c = TAP(1, -1).rgb;
+    float3 e = TAP(-1, 0).rgb;
+    float4 fa = TAP(0, 0);
+    float4 ga = TAP(1, 0);
+    float3 h = TAP(2, 0).rgb;
+    float3 i = TAP(-1, 1).rgb;
+    float4 ja = TAP(0, 1);
+    float4 ka = TAP(1, 1);
+    float3 l = TAP(2, 1).rgb;
+    float3 n = TAP(0, 2).rgb;
+    float3 o = TAP(1, 2).rgb;
+#undef TAP
+    float3 f = fa.rgb, g = ga.rgb, j = ja.rgb, k = ka.rgb;
+
+    float bL = easuLuma(b), cL = easuLuma(c), eL = easuLuma(e), fL = easuLuma(f), gL = easuLuma(g), hL = easuLuma(h);
+    float iL = easuLuma(i), jL = easuLuma(j), kL = easuLuma(k), lL = easuLuma(l), nL = easuLuma(n), oL = easuLuma(o);
+
+    // Direction and length of the edge, bilinearly weighted from the 4 quadrants around the output pixel.
+    float2 dir = 0;
+    float len = 0;
+    easuSet(dir, len, (1 - pp.x) * (1 - pp.y), bL, eL, fL, gL, jL);
+    easuSet(dir, len, pp.x * (1 - pp.y), cL, fL, gL, hL, kL);
+    easuSet(dir, len, (1 - pp.x) * pp.y, fL, iL, jL, kL, nL);
+    easuSet(dir, len, pp.x * pp.y, gL, jL, kL, lL, oL);
+
+    // Normalize the direction, defaulting to horizontal when there is no edge.
+    float dirR = dir.x * dir.x + dir.y * dir.y;
+    bool zro = dirR < 1.0 / 32768.0;
+    dirR = zro ? 1 : rsqrt(dirR);
+    dir.x = zro ? 1 : dir.x;
+    dir *= dirR;
+
+    // Shape the kernel: stretch along the edge and sharpen across it.
+    len = len * 0.5;
+    len *= len;
+    float stretch = (dir.x * dir.x + dir.y * dir.y) * rcp(max(abs(dir.x), abs(dir.y)));
+    float2 len2 = float2(1 + (stretch - 1) * len, 1 - 0.5 * len);
+    float lob = 0.5 + ((1.0 / 4.0 - 0.04) - 0.5) * len;
+    float clp = rcp(lob);
+
+    float3 aC = 0;
+    float aW = 0;
+    easuTap(aC, aW, float2(0, -1) - pp, dir, len2, lob, clp, b);
+    easuTap(aC, aW, float2(1, -1) - pp, dir, len2, lob, clp, c);
+    easuTap(aC, aW, float2(-1, 1) - pp, dir, len2, lob, clp, i);
+    easuTap(aC, aW, float2(0, 1) - pp, dir, len2, lob, clp, j);
+    easuTap(aC, aW, float2(0, 0) - pp, dir, len2, lob, clp, f);
+    easuTap(aC, aW, float2(-1, 0) - pp, dir, len2, lob, clp, e);
+    easuTap(aC, aW, float2(1, 1) - pp, dir, len2, lob, clp, k);
+    easuTap(aC, aW, float2(2, 1) - pp, dir, len2, lob, clp, l);
+    easuTap(aC, aW, float2(2, 0) - pp, dir, len2, lob, clp, h);
+    easuTap(aC, aW, float2(1, 0) - pp, dir, len2, lob, clp, g);
+    easuTap(aC, aW, float2(1, 2) - pp, dir, len2, lob, clp, o);
+    easuTap(aC, aW, float2(0, 2) - pp, dir, len2, lob, clp, n);
+
+    // Deringing against the 4 nearest texels.
+    float3 min4 = min(min(f, g), min(j, k));
+    float3 max4 = max(max(f, g), max(j, k));
+
+    // The alpha is not reconstructed, it is interpolated like a bilinear fetch would.
+    float alpha = lerp(lerp(fa.a, ga.a, pp.x), lerp(ja.a, ka.a, pp.x), pp.y);
 
+    return float4(min(max4, max(min4, aC * rcp(aW))), alpha);
+}
+
+float4 main(in float4 position : SV_POSITION, in float2 texcoord : PROJ_COORD0, in float3 projectedFocusCoord : PROJ_COORD1, in nointerpolation uint viewIndex : VIEW_INDEX) : SV_TARGET {
     float2 layer1ProjectedCoordNdc = projectedFocusCoord.xy / projectedFocusCoord.z;
     float2 layer1TexCoord = layer1ProjectedCoordNdc * float2(0.5f, -0.5f) + 0.5f;
-    // For pixels outside of the focus view, the sampler will give us a fully transparent pixel.
-    float4 color1 = sourceFocusTexture.Sample(sourceSampler, layer1TexCoord);
+    float isInside = all(abs(layer1ProjectedCoordNdc) < 1);
+
+    // Do a smooth transition with alpha-blending around the edges.
+    float focusAlpha;
+    if (smoothingArea) {
+        float2 s = smoothstep(float2(0, 0), float2(smoothingArea, smoothingArea), layer1TexCoord) -
+                   smoothstep(float2(1, 1) - float2(smoothingArea, smoothingArea), float2(1, 1), layer1TexCoord);
+        focusAlpha = isInside * max(0.5, s.x * s.y);
+    } else {
+        focusAlpha = isInside;
+    }
+
+    // Convert to texcoord and pick the pixel from each layer.
+    // The clamping prevents bleeding from neighboring content when the application uses a texture atlas.
+    float2 stereoTexCoord = clamp(texcoord, stereoUVClamp[viewIndex].xy, stereoUVClamp[viewIndex].zw);
+    float3 stereoCoord = float3(stereoTexCoord, 0);
+    // There is no peripheral pixel in the focus layer.
+    float4 color0 = float4(0, 0, 0, 1);
+    // Only reconstruct the pixels not fully covered by the focus view.
+    bool upscale = peripheralUpscaling && focusAlpha < 1 && !debugFocusView;
+    [branch] if (!focusLayer && upscale) {
+        [branch] if (viewIndex == 0) {
+            color0 = sampleStereoUpscaled(sourceStereoTexture[0], stereoTexCoord, stereoTexelSize[0], stereoUVClamp[0]);
+        } else {
+            color0 = sampleStereoUpscaled(sourceStereoTexture[1], stereoTexCoord, stereoTexelSize[1], stereoUVClamp[1]);
+        }
+    } else if (!focusLayer) {
+        [branch] if (viewIndex == 0) {
+            color0 = sourceStereoTexture[0].Sample(sourceSampler, stereoCoord);
+        } else {
+            color0 = sourceStereoTexture[1].Sample(sourceSampler, stereoCoord);
+        }
+    }
+
+    // For pixels outside of the focus view, the alpha computation below will make the pixel fully transparent.
+    float2 layer1ImageCoord = layer1TexCoord * focusUVScaleBias[viewIndex].xy + focusUVScaleBias[viewIndex].zw;
+    bool sharpen = sharpeningPeak && isInside;
+    float4 color1;
+    [branch] if (viewIndex == 0) {
+        color1 = sampleFocus(sourceFocusTexture[0], layer1ImageCoord, focusTexelSize[0].xy, focusUVClamp[0], sharpen);
+    } else {
+        color1 = sampleFocus(sourceFocusTexture[1], layer1ImageCoord, focusTexelSize[1].xy, focusUVClamp[1], sharpen);
+    }
 
     if (ignoreAlpha) {
         color0.a = color1.a = 1;
@@ -63,16 +277,14 @@ float4 main(in float4 position : SV_POSITION, in float2 texcoord : PROJ_COORD0,
         color1 = unpremultiplyAlpha(color1);
     }
 
-    // Do a smooth transition with alpha-blending around the edges.
-    float isInside = all(abs(layer1ProjectedCoordNdc) < 1);
-    if (smoothingArea) {
-        float2 s = smoothstep(float2(0, 0), float2(smoothingArea, smoothingArea), layer1TexCoord) -
-                   smoothstep(float2(1, 1) - float2(smoothingArea, smoothingArea), float2(1, 1), layer1TexCoord);
-        color1.a = isInside * max(0.5, s.x * s.y);
-    } else {
-        color1.a = isInside;
+    [branch] if (focusLayer) {
+        // Let the runtime blend the focus view over the stereo view.
+        color1.a = debugFocusView ? 1 : focusAlpha * color1.a;
+        return premultiplyAlpha(color1);
     }
 
+    color1.a = focusAlpha;
+
     color0 = premultiplyAlpha(color0);
     color1 = premultiplyAlpha(color1);
 
@@ -21,13 +21,18 @@
 // SOFTWARE.
 
 // A Vertex Shader that draws a full-screen quad and projects the coordinates of two layers.
+// Each instance draws one eye.
 
 cbuffer ConstantBuffer : register(b0) {
-    float4x4 focusProjection;
+    float4x4 focusProjection[2];
+    float4 stereoUVScaleBias[2];
 };
 
-void main(in uint id : SV_VertexID, out float4 position : SV_POSITION, out float2 texcoord : PROJ_COORD0, out float3 projectedFocusCoord : PROJ_COORD1) {
-    texcoord = float2((id == 1) ? 2.0 : 0.0, (id == 2) ? 2.0 : 0.0);
-    position = float4(texcoord * float2(2.0, -2.0) + float2(-1.0, 1.0), 0.0, 1.0);
-    projectedFocusCoord = mul(position, focusProjection).xyw;
+void main(in uint id : SV_VertexID, in uint instanceId : SV_InstanceID, out float4 position : SV_POSITION, out float2 texcoord : PROJ_COORD0, out float3 projectedFocusCoord : PROJ_COORD1, out nointerpolation uint viewIndex : VIEW_INDEX) {
+    float2 screenCoord = float2((id == 1) ? 2.0 : 0.0, (id == 2) ? 2.0 : 0.0);
+    position = float4(screenCoord * float2(2.0, -2.0) + float2(-1.0, 1.0), 0.0, 1.0);
+    // Remap to the sub-rect of the source image.
+    texcoord = screenCoord * stereoUVScaleBias[instanceId].xy + stereoUVScaleBias[instanceId].zw;
+    projectedFocusCoord = mul(position, focusProjection[instanceId]).xyw;
+    viewIndex = instanceId;
 }
@@ -20,9 +20,12 @@
 cbuffer cb : register(b0) {
     uint4 const0;
     uint4 const1;
+    // Offset (xy) and last pixel (zw) of the image rect to read from.
+    int4 inputRect;
 };
 
-Texture2D InputTexture : register(t0);
+// The view is created on the array slice used by the application, so we always read slice 0.
+Texture2DArray InputTexture : register(t0);
 RWTexture2D<float4> OutputTexture : register(u0);
 
 #define A_GPU 1
@@ -40,7 +43,7 @@ RWTexture2D<float4> OutputTexture : register(u0);
 #if CAS_SAMPLE_FP16
 
 AH3 CasLoadH(ASW2 p) {
-    return InputTexture.Load(ASU3(p, 0)).rgb;
+    return InputTexture.Load(int4(clamp(int2(p) + inputRect.xy, inputRect.xy, inputRect.zw), 0, 0)).rgb;
 }
 
 // Lets you transform input from the load into a linear color space between 0 and 1. See ffx_cas.h
@@ -51,7 +54,7 @@ void CasInputH(inout AH2 r, inout AH2 g, inout AH2 b) {
 #else
 
 AF3 CasLoad(ASU2 p) {
-    return InputTexture.Load(int3(p, 0)).rgb;
+    return InputTexture.Load(int4(clamp(int2(p) + inputRect.xy, inputRect.xy, inputRect.zw), 0, 0)).rgb;
 }
 
 // Lets you transform input from the load into a linear color space between 0 and 1. See ffx_cas.h
@@ -53,7 +53,8 @@ requested_functions = [
     "xrSyncActions",
     "xrCreateEyeTrackerFB",
     "xrGetEyeGazesFB",
+    "xrConvertWin32PerformanceCounterToTimeKHR",
 ]
 
 # The list of OpenXR extensions our layer will either override or use.
-extensions = ["XR_KHR_visibility_mask", "XR_FB_eye_tracking_social"]
+extensions = ["XR_KHR_visibility_mask", "XR_FB_eye_tracking_social", "XR_KHR_win32_convert_performance_counter_time"]
@@ -0,0 +1,1485 @@
+// MIT License
+//
+// Copyright(c) 2021-2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "mock_runtime.h"
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+namespace {
+
+    using namespace openxr_api_layer::benchmark;
+
+    constexpr XrSystemId MockSystemId = 1;
+    constexpr double Pi = 3.14159265358979323846;
+
+    // The handles are opaque values that the mock runtime never dereferences.
+    template <typename Handle>
+    Handle ToHandle(uint64_t value) {
+        return (Handle)(uintptr_t)value;
+    }
+
+    template <typename Handle>
+    uint64_t FromHandle(Handle handle) {
+        return (uint64_t)(uintptr_t)handle;
+    }
+
+    // Implement the two-call idiom for arrays.
+    template <typename T, typename Fill>
+    XrResult Enumerate(uint32_t size, uint32_t capacityInput, uint32_t* countOutput, T* items, Fill&& fill) {
+        if (!countOutput) {
+            return XR_ERROR_VALIDATION_FAILURE;
+        }
+        *countOutput = size;
+        if (capacityInput == 0) {
+            return XR_SUCCESS;
+        }
+        if (capacityInput < size) {
+            return XR_ERROR_SIZE_INSUFFICIENT;
+        }
+        if (!items) {
+            return XR_ERROR_VALIDATION_FAILURE;
+        }
+        for (uint32_t i = 0; i < size; i++) {
+            fill(items[i], i);
+        }
+        return XR_SUCCESS;
+    }
+
+    template <typename T>
+    const T* FindInChain(const void* next, XrStructureType type) {
+        const XrBaseInStructure* entry = reinterpret_cast<const XrBaseInStructure*>(next);
+        while (entry) {
+            if (entry->type == type) {
+                return reinterpret_cast<const T*>(entry);
+            }
+            entry = entry->next;
+        }
+        return nullptr;
+    }
+
+    template <typename T>
+    T* FindInChain(void* next, XrStructureType type) {
+        XrBaseOutStructure* entry = reinterpret_cast<XrBaseOutStructure*>(next);
+        while (entry) {
+            if (entry->type == type) {
+                return reinterpret_cast<T*>(entry);
+            }
+            entry = entry->next;
+        }
+        return nullptr;
+    }
+
+    XrQuaternionf Multiply(const XrQuaternionf& a, const XrQuaternionf& b) {
+        return {a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+                a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+                a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+                a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z};
+    }
+
+    XrQuaternionf YawRotation(float yaw) {
+        return {0.f, std::sin(yaw / 2), 0.f, std::cos(yaw / 2)};
+    }
+
+    // The rotation from the forward direction (-Z) to the given unit direction.
+    XrQuaternionf LookRotation(const XrVector3f& direction) {
+        XrQuaternionf q{direction.y, -direction.x, 0.f, 1.f - direction.z};
+        const float length = std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+        if (length < 1e-6f) {
+            return {0.f, 1.f, 0.f, 0.f};
+        }
+        return {q.x / length, q.y / length, q.z / length, q.w / length};
+    }
+
+    // A stateless pseudo-random number in [0, 1) (splitmix64), so that the gaze is a pure function of time.
+    double Hash(uint64_t value) {
+        value += 0x9e3779b97f4a7c15ull;
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+        value ^= value >> 31;
+        return (value >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    DXGI_FORMAT GetTypelessFormat(DXGI_FORMAT format) {
+        switch (format) {
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+        case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+            return DXGI_FORMAT_R8G8B8A8_TYPELESS;
+        case DXGI_FORMAT_B8G8R8A8_UNORM:
+        case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+            return DXGI_FORMAT_B8G8R8A8_TYPELESS;
+        case DXGI_FORMAT_R10G10B10A2_UNORM:
+            return DXGI_FORMAT_R10G10B10A2_TYPELESS;
+        case DXGI_FORMAT_R16G16B16A16_FLOAT:
+            return DXGI_FORMAT_R16G16B16A16_TYPELESS;
+        case DXGI_FORMAT_D32_FLOAT:
+            return DXGI_FORMAT_R32_TYPELESS;
+        case DXGI_FORMAT_D32_FLOAT_S8X24_UINT:
+            return DXGI_FORMAT_R32G8X24_TYPELESS;
+        case DXGI_FORMAT_D24_UNORM_S8_UINT:
+            return DXGI_FORMAT_R24G8_TYPELESS;
+        case DXGI_FORMAT_D16_UNORM:
+            return DXGI_FORMAT_R16_TYPELESS;
+        default:
+            return format;
+        }
+    }
+
+    // Like most runtimes, we create typeless textures and the views must specify their format.
+    const std::vector<int64_t> SupportedSwapchainFormats = {DXGI_FORMAT_R8G8B8A8_UNORM_SRGB,
+                                                            DXGI_FORMAT_B8G8R8A8_UNORM_SRGB,
+                                                            DXGI_FORMAT_R8G8B8A8_UNORM,
+                                                            DXGI_FORMAT_B8G8R8A8_UNORM,
+                                                            DXGI_FORMAT_R10G10B10A2_UNORM,
+                                                            DXGI_FORMAT_R16G16B16A16_FLOAT,
+                                                            DXGI_FORMAT_D32_FLOAT,
+                                                            DXGI_FORMAT_D24_UNORM_S8_UINT,
+                                                            DXGI_FORMAT_D32_FLOAT_S8X24_UINT,
+                                                            DXGI_FORMAT_D16_UNORM};
+
+    const std::vector<std::pair<const char*, uint32_t>> SupportedExtensions = {
+        {XR_KHR_D3D11_ENABLE_EXTENSION_NAME, 9},
+        {XR_KHR_COMPOSITION_LAYER_DEPTH_EXTENSION_NAME, 6},
+        {XR_KHR_VISIBILITY_MASK_EXTENSION_NAME, 2},
+        {XR_KHR_WIN32_CONVERT_PERFORMANCE_COUNTER_TIME_EXTENSION_NAME, 1},
+        {XR_FB_EYE_TRACKING_SOCIAL_EXTENSION_NAME, 1},
+    };
+
+    class MockRuntime {
+      public:
+        MockRuntime() {
+            LARGE_INTEGER frequency;
+            QueryPerformanceFrequency(&frequency);
+            m_qpcFrequency = frequency.QuadPart;
+
+            m_timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+            if (!m_timer) {
+                m_timer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+            }
+        }
+
+        ~MockRuntime() {
+            if (m_timer) {
+                CloseHandle(m_timer);
+            }
+        }
+
+        void configure(const MockRuntimeConfig& config) {
+            std::unique_lock lock(m_mutex);
+            m_config = config;
+            m_displayPeriod = static_cast<XrTime>(1e9 / config.displayRefreshRate);
+        }
+
+        void setEyeGaze(const XrVector3f& direction) {
+            std::unique_lock lock(m_mutex);
+            m_replayEyeGaze = direction;
+        }
+
+        MockRuntimeStatistics getStatistics() {
+            std::unique_lock lock(m_mutex);
+            return m_statistics;
+        }
+
+        XrResult xrGetInstanceProcAddr(XrInstance instance, const char* name, PFN_xrVoidFunction* function);
+
+        XrResult xrCreateInstance(const XrInstanceCreateInfo* createInfo, XrInstance* instance) {
+            if (!createInfo || createInfo->type != XR_TYPE_INSTANCE_CREATE_INFO || !instance) {
+                return XR_ERROR_VALIDATION_FAILURE;
+            }
+            if (createInfo->enabledApiLayerCount) {
+                return XR_ERROR_API_LAYER_NOT_PRESENT;
+            }
+            for (uint32_t i = 0; i < createInfo->enabledExtensionCount; i++) {
+                const std::string_view extensionName(createInfo->enabledExtensionNames[i]);
+                if (std::find_if(SupportedExtensions.cbegin(), SupportedExtensions.cend(), [&](const auto& extension) {
+                        return extensionName == extension.first;
+                    }) == SupportedExtensions.cend()) {
+                    return XR_ERROR_EXTENSION_NOT_PRESENT;
+                }
+            }
+
+            std::unique_lock lock(m_mutex);
+            const uint64_t handle = m_nextHandle++;
+            m_instances.insert(handle);
+            *instance = ToHandle<XrInstance>(handle);
+
+            return XR_SUCCESS;
+        }
+
+        XrResult xrDestroyInstance(XrInstance instance) {
+            std::unique_lock lock(m_mutex);
+            if (!m_instances.erase(FromHandle(instance))) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+            return XR_SUCCESS;
+        }
+
+        XrResult xrEnumerateInstanceExtensionProperties(const char* layerName,
+                                                        uint32_t propertyCapacityInput,
+                                                        uint32_t* propertyCountOutput,
+                                                        XrExtensionProperties* properties) {
+            if (layerName) {
+                return XR_ERROR_API_LAYER_NOT_PRESENT;
+            }
+            return Enumerate(static_cast<uint32_t>(SupportedExtensions.size()),
+                             propertyCapacityInput,
+                             propertyCountOutput,
+                             properties,
+                             [&](XrExtensionProperties& property, uint32_t i) {
+                                 strcpy_s(property.extensionName, SupportedExtensions[i].first);
+                                 property.extensionVersion = SupportedExtensions[i].second;
+                             });
+        }
+
+        XrResult xrGetInstanceProperties(XrInstance instance, XrInstanceProperties* instanceProperties) {
+            if (!isInstance(instance)) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+            if (!instanceProperties || instanceProperties->type != XR_TYPE_INSTANCE_PROPERTIES) {
+                return XR_ERROR_VALIDATION_FAILURE;
+            }
+            instanceProperties->runtimeVersion = XR_MAKE_VERSION(1, 0, 0);
+            strcpy_s(instanceProperties->runtimeName, "Mock Runtime");
+            return XR_SUCCESS;
+        }
+
+        XrResult xrPollEvent(XrInstance instance, XrEventDataBuffer* eventData) {
+            if (!isInstance(instance)) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+            if (!eventData) {
+                return XR_ERROR_VALIDATION_FAILURE;
+            }
+
+            std::unique_lock lock(m_mutex);
+            if (m_events.empty()) {
+                return XR_EVENT_UNAVAILABLE;
+            }
+            *eventData = m_events.front();
+            m_events.pop_front();
+            return XR_SUCCESS;
+        }
+
+        XrResult xrStringToPath(XrInstance instance, const char* pathString, XrPath* path) {
+            if (!isInstance(instance)) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+            if (!pathString || pathString[0] != '/' || !path) {
+                return XR_ERROR_PATH_FORMAT_INVALID;
+            }
+
+            std::unique_lock lock(m_mutex);
+            auto it = std::find(m_paths.cbegin(), m_paths.cend(), pathString);
+            if (it == m_paths.cend()) {
+                it = m_paths.insert(m_paths.cend(), pathString);
+            }
+            *path = static_cast<XrPath>(std::distance(m_paths.cbegin(), it) + 1);
+            return XR_SUCCESS;
+        }
+
+        XrResult xrPathToString(XrInstance instance,
+                                XrPath path,
+                                uint32_t bufferCapacityInput,
+                                uint32_t* bufferCountOutput,
+                                char* buffer) {
+            if (!isInstance(instance)) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+
+            std::unique_lock lock(m_mutex);
+            if (path == XR_NULL_PATH || path > m_paths.size()) {
+                return XR_ERROR_PATH_INVALID;
+            }
+            const std::string& string = m_paths[path - 1];
+            return Enumerate(static_cast<uint32_t>(string.size() + 1),
+                             bufferCapacityInput,
+                             bufferCountOutput,
+                             buffer,
+                             [&](char& c, uint32_t i) { c = string.c_str()[i]; });
+        }
+
+        XrResult xrGetSystem(XrInstance instance, const XrSystemGetInfo* getInfo, XrSystemId* systemId) {
+            if (!isInstance(instance)) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+            if (!getInfo || getInfo->type != XR_TYPE_SYSTEM_GET_INFO || !systemId) {
+                return XR_ERROR_VALIDATION_FAILURE;
+            }
+            if (getInfo->formFactor != XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY) {
+                return XR_ERROR_FORM_FACTOR_UNSUPPORTED;
+            }
+            *systemId = MockSystemId;
+            return XR_SUCCESS;
+        }
+
+        XrResult xrGetSystemProperties(XrInstance instance, XrSystemId systemId, XrSystemProperties* properties) {
+            if (!isInstance(instance)) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+            if (systemId != MockSystemId) {
+                return XR_ERROR_SYSTEM_INVALID;
+            }
+            if (!properties || properties->type != XR_TYPE_SYSTEM_PROPERTIES) {
+                return XR_ERROR_VALIDATION_FAILURE;
+            }
+
+            properties->systemId = systemId;
+            properties->vendorId = 0;
+            strcpy_s(properties->systemName, "Mock HMD");
+            properties->graphicsProperties.maxSwapchainImageWidth = D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION;
+            properties->graphicsProperties.maxSwapchainImageHeight = D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION;
+            properties->graphicsProperties.maxLayerCount = XR_MIN_COMPOSITION_LAYERS_SUPPORTED;
+            properties->trackingProperties.orientationTracking = XR_TRUE;
+            properties->trackingProperties.positionTracking = XR_TRUE;
+
+            auto eyeTrackingProperties = FindInChain<XrSystemEyeTrackingPropertiesFB>(
+                properties->next, XR_TYPE_SYSTEM_EYE_TRACKING_PROPERTIES_FB);
+            if (eyeTrackingProperties) {
+                eyeTrackingProperties->supportsEyeTracking = m_config.supportsEyeTracking ? XR_TRUE : XR_FALSE;
+            }
+            auto eyeGazeInteractionProperties = FindInChain<XrSystemEyeGazeInteractionPropertiesEXT>(
+                properties->next, XR_TYPE_SYSTEM_EYE_GAZE_INTERACTION_PROPERTIES_EXT);
+            if (eyeGazeInteractionProperties) {
+                eyeGazeInteractionProperties->supportsEyeGazeInteraction = XR_FALSE;
+            }
+
+            return XR_SUCCESS;
+        }
+
+        XrResult xrEnumerateEnvironmentBlendModes(XrInstance instance,
+                                                  XrSystemId systemId,
+                                                  XrViewConfigurationType viewConfigurationType,
+                                                  uint32_t environmentBlendModeCapacityInput,
+                                                  uint32_t* environmentBlendModeCountOutput,
+                                                  XrEnvironmentBlendMode* environmentBlendModes) {
+            const XrResult result = checkViewConfiguration(instance, systemId, viewConfigurationType);
+            if (XR_FAILED(result)) {
+                return result;
+            }
+            return Enumerate(1,
+                             environmentBlendModeCapacityInput,
+                             environmentBlendModeCountOutput,
+                             environmentBlendModes,
+                             [&](XrEnvironmentBlendMode& mode, uint32_t) { mode = XR_ENVIRONMENT_BLEND_MODE_OPAQUE; });
+        }
+
+        XrResult xrEnumerateViewConfigurations(XrInstance instance,
+                                               XrSystemId systemId,
+                                               uint32_t viewConfigurationTypeCapacityInput,
+                                               uint32_t* viewConfigurationTypeCountOutput,
+                                               XrViewConfigurationType* viewConfigurationTypes) {
+            if (!isInstance(instance)) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+            if (systemId != MockSystemId) {
+                return XR_ERROR_SYSTEM_INVALID;
+            }
+            return Enumerate(1,
+                             viewConfigurationTypeCapacityInput,
+                             viewConfigurationTypeCountOutput,
+                             viewConfigurationTypes,
+                             [&](XrViewConfigurationType& type, uint32_t) {
+                                 type = XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO;
+                             });
+        }
+
+        XrResult xrGetViewConfigurationProperties(XrInstance instance,
+                                                  XrSystemId systemId,
+                                                  XrViewConfigurationType viewConfigurationType,
+                                                  XrViewConfigurationProperties* configurationProperties) {
+            const XrResult result = checkViewConfiguration(instance, systemId, viewConfigurationType);
+            if (XR_FAILED(result)) {
+                return result;
+            }
+            if (!configurationProperties || configurationProperties->type != XR_TYPE_VIEW_CONFIGURATION_PROPERTIES) {
+                return XR_ERROR_VALIDATION_FAILURE;
+            }
+            configurationProperties->viewConfigurationType = viewConfigurationType;
+            configurationProperties->fovMutable = XR_TRUE;
+            return XR_SUCCESS;
+        }
+
+        XrResult xrEnumerateViewConfigurationViews(XrInstance instance,
+                                                   XrSystemId systemId,
+                                                   XrViewConfigurationType viewConfigurationType,
+                                                   uint32_t viewCapacityInput,
+                                                   uint32_t* viewCountOutput,
+                                                   XrViewConfigurationView* views) {
+            const XrResult result = checkViewConfiguration(instance, systemId, viewConfigurationType);
+            if (XR_FAILED(result)) {
+                return result;
+            }
+            const auto fillView = [&](XrViewConfigurationView& view, uint32_t) {
+                view.recommendedImageRectWidth = static_cast<uint32_t>(m_config.recommendedResolution.width);
+                view.recommendedImageRectHeight = static_cast<uint32_t>(m_config.recommendedResolution.height);
+                view.maxImageRectWidth = D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION;
+                view.maxImageRectHeight = D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION;
+                view.recommendedSwapchainSampleCount = 1;
+                view.maxSwapchainSampleCount = 4;
+            };
+            return Enumerate(2, viewCapacityInput, viewCountOutput, views, fillView);
+        }
+
+        XrResult xrCreateSession(XrInstance instance, const XrSessionCreateInfo* createInfo, XrSession* session) {
+            if (!isInstance(instance)) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+            if (!createInfo || createInfo->type != XR_TYPE_SESSION_CREATE_INFO || !session) {
+                return XR_ERROR_VALIDATION_FAILURE;
+            }
+            if (createInfo->systemId != MockSystemId) {
+                return XR_ERROR_SYSTEM_INVALID;
+            }
+            const auto d3d11Bindings =
+                FindInChain<XrGraphicsBindingD3D11KHR>(createInfo->next, XR_TYPE_GRAPHICS_BINDING_D3D11_KHR);
+            if (!d3d11Bindings || !d3d11Bindings->device) {
+                return XR_ERROR_GRAPHICS_DEVICE_INVALID;
+            }
+
+            std::unique_lock lock(m_mutex);
+            if (m_session) {
+                return XR_ERROR_LIMIT_REACHED;
+            }
+            m_session = m_nextHandle++;
+            m_device = d3d11Bindings->device;
+            m_sessionRunning = false;
+            m_framesWaited = m_framesBegun = 0;
+            m_frameInProgress = false;
+            *session = ToHandle<XrSession>(m_session);
+
+            queueSessionState(XR_SESSION_STATE_IDLE);
+            queueSessionState(XR_SESSION_STATE_READY);
+
+            return XR_SUCCESS;
+        }
+
+        XrResult xrDestroySession(XrSession session) {
+            std::unique_lock lock(m_mutex);
+            if (!isSession(session)) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+            m_session = 0;
+            m_sessionRunning = false;
+            m_frameCondition.notify_all();
+            m_swapchains.clear();
+            m_spaces.clear();
+            m_eyeTrackers.clear();
+            m_device.Reset();
+            return XR_SUCCESS;
+        }
+
+        XrResult xrBeginSession(XrSession session, const XrSessionBeginInfo* beginInfo) {
+            if (!beginInfo || beginInfo->type != XR_TYPE_SESSION_BEGIN_INFO) {
+                return XR_ERROR_VALIDATION_FAILURE;
+            }
+            // The layer must have translated the quad views down to stereo.
+            if (beginInfo->primaryViewConfigurationType != XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO) {
+                return XR_ERROR_VIEW_CONFIGURATION_TYPE_UNSUPPORTED;
+            }
+
+            std::unique_lock lock(m_mutex);
+            if (!isSession(session)) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+            if (m_sessionRunning) {
+                return XR_ERROR_SESSION_RUNNING;
+            }
+            m_sessionRunning = true;
+            m_lastVsync = getTime();
+
+            queueSessionState(XR_SESSION_STATE_SYNCHRONIZED);
+            queueSessionState(XR_SESSION_STATE_VISIBLE);
+            queueSessionState(XR_SESSION_STATE_FOCUSED);
+
+            return XR_SUCCESS;
+        }
+
+        XrResult xrEndSession(XrSession session) {
+            std::unique_lock lock(m_mutex);
+            if (!isSession(session)) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+            if (!m_sessionRunning) {
+                return XR_ERROR_SESSION_NOT_RUNNING;
+            }
+            m_sessionRunning = false;
+            m_frameCondition.notify_all();
+
+            queueSessionState(XR_SESSION_STATE_IDLE);
+            queueSessionState(XR_SESSION_STATE_EXITING);
+
+            return XR_SUCCESS;
+        }
+
+        XrResult xrRequestExitSession(XrSession session) {
+            std::unique_lock lock(m_mutex);
+            if (!isSession(session)) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+            if (!m_sessionRunning) {
+                return XR_ERROR_SESSION_NOT_RUNNING;
+            }
+
+            queueSessionState(XR_SESSION_STATE_STOPPING);
+
+            return XR_SUCCESS;
+        }
+
+        XrResult xrGetVisibilityMaskKHR(XrSession session,
+                                        XrViewConfigurationType viewConfigurationType,
+                                        uint32_t viewIndex,
+                                        XrVisibilityMaskTypeKHR visibilityMaskType,
+                                        XrVisibilityMaskKHR* visibilityMask) {
+            std::unique_lock lock(m_mutex);
+            if (!isSession(session)) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+            if (viewConfigurationType != XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO) {
+                return XR_ERROR_VIEW_CONFIGURATION_TYPE_UNSUPPORTED;
+            }
+            if (viewIndex >= 2 || !visibilityMask || visibilityMask->type != XR_TYPE_VISIBILITY_MASK_KHR) {
+                return XR_ERROR_VALIDATION_FAILURE;
+            }
+
+            // The whole rectangle of the view is visible.
+            const XrFovf& fov = m_config.eyeFov[viewIndex];
+            const XrVector2f corners[] = {{std::tan(fov.angleLeft), std::tan(fov.angleDown)},
+                                          {std::tan(fov.angleRight), std::tan(fov.angleDown)},
+                                          {std::tan(fov.angleRight), std::tan(fov.angleUp)},
+                                          {std::tan(fov.angleLeft), std::tan(fov.angleUp)}};
+            std::vector<XrVector2f> vertices;
+            std::vector<uint32_t> indices;
+            switch (visibilityMaskType) {
+            case XR_VISIBILITY_MASK_TYPE_HIDDEN_TRIANGLE_MESH_KHR:
+                break;
+            case XR_VISIBILITY_MASK_TYPE_VISIBLE_TRIANGLE_MESH_KHR:
+                vertices.assign(std::begin(corners), std::end(corners));
+                indices = {0, 1, 2, 0, 2, 3};
+                break;
+            case XR_VISIBILITY_MASK_TYPE_LINE_LOOP_KHR:
+                vertices.assign(std::begin(corners), std::end(corners));
+                indices = {0, 1, 2, 3};
+                break;
+            default:
+                return XR_ERROR_VALIDATION_FAILURE;
+            }
+
+            // Both arrays follow the two-call idiom independently.
+            XrResult result = Enumerate(static_cast<uint32_t>(vertices.size()),
+                                        visibilityMask->vertexCapacityInput,
+                                        &visibilityMask->vertexCountOutput,
+                                        visibilityMask->vertices,
+                                        [&](XrVector2f& vertex, uint32_t i) { vertex = vertices[i]; });
+            if (XR_SUCCEEDED(result)) {
+                result = Enumerate(static_cast<uint32_t>(indices.size()),
+                                   visibilityMask->indexCapacityInput,
+                                   &visibilityMask->indexCountOutput,
+                                   visibilityMask->indices,
+                                   [&](uint32_t& index, uint32_t i) { index = indices[i]; });
+            }
+            return result;
+        }
+
+        XrResult xrCreateReferenceSpace(XrSession session,
+                                        const XrReferenceSpaceCreateInfo* createInfo,
+                                        XrSpace* space) {
+            if (!createInfo || createInfo->type != XR_TYPE_REFERENCE_SPACE_CREATE_INFO || !space) {
+                return XR_ERROR_VALIDATION_FAILURE;
+            }
+            if (createInfo->referenceSpaceType != XR_REFERENCE_SPACE_TYPE_VIEW &&
+                createInfo->referenceSpaceType != XR_REFERENCE_SPACE_TYPE_LOCAL &&
+                createInfo->referenceSpaceType != XR_REFERENCE_SPACE_TYPE_STAGE) {
+                return XR_ERROR_REFERENCE_SPACE_UNSUPPORTED;
+            }
+
+            std::unique_lock lock(m_mutex);
+            if (!isSession(session)) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+            const uint64_t handle = m_nextHandle++;
+            m_spaces.insert_or_assign(handle, createInfo->referenceSpaceType == XR_REFERENCE_SPACE_TYPE_VIEW);
+            *space = ToHandle<XrSpace>(handle);
+            return XR_SUCCESS;
+        }
+
+        XrResult xrCreateActionSpace(XrSession session, const XrActionSpaceCreateInfo* createInfo, XrSpace* space) {
+            if (!createInfo || createInfo->type != XR_TYPE_ACTION_SPACE_CREATE_INFO || !space) {
+                return XR_ERROR_VALIDATION_FAILURE;
+            }
+
+            std::unique_lock lock(m_mutex);
+            if (!isSession(session)) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+            if (!m_actions.count(FromHandle(createInfo->action))) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+            // Action spaces are head-locked.
+            const uint64_t handle = m_nextHandle++;
+            m_spaces.insert_or_assign(handle, true);
+            *space = ToHandle<XrSpace>(handle);
+            return XR_SUCCESS;
+        }
+
+        XrResult xrDestroySpace(XrSpace space) {
+            std::unique_lock lock(m_mutex);
+            if (!m_spaces.erase(FromHandle(space))) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+            return XR_SUCCESS;
+        }
+
+        XrResult xrLocateSpace(XrSpace space, XrSpace baseSpace, XrTime time, XrSpaceLocation* location) {
+            if (!location || location->type != XR_TYPE_SPACE_LOCATION) {
+                return XR_ERROR_VALIDATION_FAILURE;
+            }
+            if (time <= 0) {
+                return XR_ERROR_TIME_INVALID;
+            }
+
+            std::unique_lock lock(m_mutex);
+            const auto it = m_spaces.find(FromHandle(space));
+            const auto baseIt = m_spaces.find(FromHandle(baseSpace));
+            if (it == m_spaces.cend() || baseIt == m_spaces.cend()) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+
+            const double t = time * 1e-9;
+            const float yaw = (it->second ? getHeadYaw(t) : 0.f) - (baseIt->second ? getHeadYaw(t) : 0.f);
+            location->pose.orientation = YawRotation(yaw);
+            location->pose.position = {0.f, 0.f, 0.f};
+            location->locationFlags = XR_SPACE_LOCATION_ORIENTATION_VALID_BIT | XR_SPACE_LOCATION_POSITION_VALID_BIT |
+                                      XR_SPACE_LOCATION_ORIENTATION_TRACKED_BIT |
+                                      XR_SPACE_LOCATION_POSITION_TRACKED_BIT;
+
+            auto velocity = FindInChain<XrSpaceVelocity>(location->next, XR_TYPE_SPACE_VELOCITY);
+            if (velocity) {
+                const float yawRate =
+                    (it->second ? getHeadYawRate(t) : 0.f) - (baseIt->second ? getHeadYawRate(t) : 0.f);
+                velocity->linearVelocity = {0.f, 0.f, 0.f};
+                velocity->angularVelocity = {0.f, yawRate, 0.f};
+                velocity->velocityFlags = XR_SPACE_VELOCITY_LINEAR_VALID_BIT | XR_SPACE_VELOCITY_ANGULAR_VALID_BIT;
+            }
+
+            return XR_SUCCESS;
+        }
+
+        XrResult xrLocateViews(XrSession session,
+                               const XrViewLocateInfo* viewLocateInfo,
+                               XrViewState* viewState,
+                               uint32_t viewCapacityInput,
+                               uint32_t* viewCountOutput,
+                               XrView* views) {
+            if (!viewLocateInfo || viewLocateInfo->type != XR_TYPE_VIEW_LOCATE_INFO || !viewState ||
+                viewState->type != XR_TYPE_VIEW_STATE) {
+                return XR_ERROR_VALIDATION_FAILURE;
+            }
+            if (viewLocateInfo->viewConfigurationType != XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO) {
+                return XR_ERROR_VIEW_CONFIGURATION_TYPE_UNSUPPORTED;
+            }
+            if (viewLocateInfo->displayTime <= 0) {
+                return XR_ERROR_TIME_INVALID;
+            }
+
+            std::unique_lock lock(m_mutex);
+            if (!isSession(session)) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+            const auto it = m_spaces.find(FromHandle(viewLocateInfo->space));
+            if (it == m_spaces.cend()) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+
+            const float yaw = it->second ? 0.f : getHeadYaw(viewLocateInfo->displayTime * 1e-9);
+            viewState->viewStateFlags = XR_VIEW_STATE_ORIENTATION_VALID_BIT | XR_VIEW_STATE_POSITION_VALID_BIT |
+                                        XR_VIEW_STATE_ORIENTATION_TRACKED_BIT | XR_VIEW_STATE_POSITION_TRACKED_BIT;
+            return Enumerate(2, viewCapacityInput, viewCountOutput, views, [&](XrView& view, uint32_t i) {
+                const float offset = (i ? 0.5f : -0.5f) * m_config.ipd;
+                view.pose.orientation = YawRotation(yaw);
+                view.pose.position = {offset * std::cos(yaw), 0.f, -offset * std::sin(yaw)};
+                view.fov = m_config.eyeFov[i];
+            });
+        }
+
+        XrResult xrWaitFrame(XrSession session, const XrFrameWaitInfo* frameWaitInfo, XrFrameState* frameState) {
+            if ((frameWaitInfo && frameWaitInfo->type != XR_TYPE_FRAME_WAIT_INFO) || !frameState ||
+                frameState->type != XR_TYPE_FRAME_STATE) {
+                return XR_ERROR_VALIDATION_FAILURE;
+            }
+
+            // Calls to xrWaitFrame() are serialized like a runtime would.
+            std::unique_lock waitLock(m_waitFrameMutex);
+
+            XrTime nextVsync;
+            {
+                std::unique_lock lock(m_mutex);
+                if (!isSession(session)) {
+                    return XR_ERROR_HANDLE_INVALID;
+                }
+
+                // Block until the previous frame was begun.
+                m_frameCondition.wait(lock, [&] { return !m_sessionRunning || m_framesBegun == m_framesWaited; });
+                if (!m_sessionRunning) {
+                    return XR_ERROR_SESSION_NOT_RUNNING;
+                }
+
+                // Throttle to the next vsync, skipping the ones that were missed.
+                const XrTime now = getTime();
+                nextVsync = m_lastVsync + m_displayPeriod;
+                if (nextVsync < now) {
+                    nextVsync += ((now - nextVsync) / m_displayPeriod + 1) * m_displayPeriod;
+                }
+                m_lastVsync = nextVsync;
+            }
+
+            sleepUntil(nextVsync);
+
+            std::unique_lock lock(m_mutex);
+            m_framesWaited++;
+            m_statistics.framesWaited++;
+            frameState->predictedDisplayPeriod = m_displayPeriod;
+            frameState->predictedDisplayTime = nextVsync + 2 * m_displayPeriod;
+            frameState->shouldRender = XR_TRUE;
+
+            return XR_SUCCESS;
+        }
+
+        XrResult xrBeginFrame(XrSession session, const XrFrameBeginInfo* frameBeginInfo) {
+            if (frameBeginInfo && frameBeginInfo->type != XR_TYPE_FRAME_BEGIN_INFO) {
+                return XR_ERROR_VALIDATION_FAILURE;
+            }
+
+            std::unique_lock lock(m_mutex);
+            if (!isSession(session)) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+            if (!m_sessionRunning) {
+                return XR_ERROR_SESSION_NOT_RUNNING;
+            }
+            if (m_framesBegun == m_framesWaited) {
+                return XR_ERROR_CALL_ORDER_INVALID;
+            }
+
+            XrResult result = XR_SUCCESS;
+            if (m_frameInProgress) {
+                m_statistics.framesDiscarded++;
+                result = XR_FRAME_DISCARDED;
+            }
+            m_framesBegun++;
+            m_statistics.framesBegun++;
+            m_frameInProgress = true;
+            m_frameCondition.notify_all();
+
+            return result;
+        }
+
+        XrResult xrEndFrame(XrSession session, const XrFrameEndInfo* frameEndInfo) {
+            if (!frameEndInfo || frameEndInfo->type != XR_TYPE_FRAME_END_INFO) {
+                return XR_ERROR_VALIDATION_FAILURE;
+            }
+            if (frameEndInfo->displayTime <= 0) {
+                return XR_ERROR_TIME_INVALID;
+            }
+            if (frameEndInfo->environmentBlendMode != XR_ENVIRONMENT_BLEND_MODE_OPAQUE) {
+                return XR_ERROR_ENVIRONMENT_BLEND_MODE_UNSUPPORTED;
+            }
+            if (frameEndInfo->layerCount > XR_MIN_COMPOSITION_LAYERS_SUPPORTED) {
+                return XR_ERROR_LAYER_LIMIT_EXCEEDED;
+            }
+
+            std::unique_lock lock(m_mutex);
+            if (!isSession(session)) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+            if (!m_frameInProgress) {
+                return XR_ERROR_CALL_ORDER_INVALID;
+            }
+
+            for (uint32_t i = 0; i < frameEndInfo->layerCount; i++) {
+                const XrCompositionLayerBaseHeader* layer = frameEndInfo->layers[i];
+                if (!layer) {
+                    return XR_ERROR_LAYER_INVALID;
+                }
+                XrResult result = XR_SUCCESS;
+                if (layer->type == XR_TYPE_COMPOSITION_LAYER_PROJECTION) {
+                    // The layer must have translated the quad views down to stereo.
+                    const auto projection = reinterpret_cast<const XrCompositionLayerProjection*>(layer);
+                    if (projection->viewCount != 2) {
+                        return XR_ERROR_VALIDATION_FAILURE;
+                    }
+                    for (uint32_t eye = 0; eye < projection->viewCount && XR_SUCCEEDED(result); eye++) {
+                        result = checkSubImage(projection->views[eye].subImage);
+                        const auto depthInfo = FindInChain<XrCompositionLayerDepthInfoKHR>(
+                            projection->views[eye].next, XR_TYPE_COMPOSITION_LAYER_DEPTH_INFO_KHR);
+                        if (XR_SUCCEEDED(result) && depthInfo) {
+                            result = checkSubImage(depthInfo->subImage);
+                        }
+                    }
+                } else if (layer->type == XR_TYPE_COMPOSITION_LAYER_QUAD) {
+                    result = checkSubImage(reinterpret_cast<const XrCompositionLayerQuad*>(layer)->subImage);
+                }
+                if (XR_FAILED(result)) {
+                    return result;
+                }
+            }
+
+            m_frameInProgress = false;
+            m_statistics.framesSubmitted++;
+            m_statistics.layersSubmitted += frameEndInfo->layerCount;
+
+            return XR_SUCCESS;
+        }
+
+        XrResult xrEnumerateSwapchainFormats(XrSession session,
+                                             uint32_t formatCapacityInput,
+                                             uint32_t* formatCountOutput,
+                                             int64_t* formats) {
+            std::unique_lock lock(m_mutex);
+            if (!isSession(session)) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+            return Enumerate(static_cast<uint32_t>(SupportedSwapchainFormats.size()),
+                             formatCapacityInput,
+                             formatCountOutput,
+                             formats,
+                             [&](int64_t& format, uint32_t i) { format = SupportedSwapchainFormats[i]; });
+        }
+
+        XrResult xrCreateSwapchain(XrSession session, const XrSwapchainCreateInfo* createInfo, XrSwapchain* swapchain) {
+            if (!createInfo || createInfo->type != XR_TYPE_SWAPCHAIN_CREATE_INFO || !swapchain) {
+                return XR_ERROR_VALIDATION_FAILURE;
+            }
+            if (std::find(SupportedSwapchainFormats.cbegin(), SupportedSwapchainFormats.cend(), createInfo->format) ==
+                SupportedSwapchainFormats.cend()) {
+                return XR_ERROR_SWAPCHAIN_FORMAT_UNSUPPORTED;
+            }
+            if (!createInfo->width || !createInfo->height || !createInfo->arraySize || !createInfo->mipCount ||
+                !createInfo->sampleCount || createInfo->faceCount != 1) {
+                return XR_ERROR_VALIDATION_FAILURE;
+            }
+
+            std::unique_lock lock(m_mutex);
+            if (!isSession(session)) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+
+            D3D11_TEXTURE2D_DESC desc{};
+            desc.Width = createInfo->width;
+            desc.Height = createInfo->height;
+            desc.MipLevels = createInfo->mipCount;
+            desc.ArraySize = createInfo->arraySize;
+            desc.Format = GetTypelessFormat(static_cast<DXGI_FORMAT>(createInfo->format));
+            desc.SampleDesc.Count = createInfo->sampleCount;
+            desc.Usage = D3D11_USAGE_DEFAULT;
+            if (createInfo->usageFlags & XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT) {
+                desc.BindFlags |= D3D11_BIND_RENDER_TARGET;
+            }
+            if (createInfo->usageFlags & XR_SWAPCHAIN_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT) {
+                desc.BindFlags |= D3D11_BIND_DEPTH_STENCIL;
+            }
+            if (createInfo->usageFlags & XR_SWAPCHAIN_USAGE_SAMPLED_BIT) {
+                desc.BindFlags |= D3D11_BIND_SHADER_RESOURCE;
+            }
+            if (createInfo->usageFlags & XR_SWAPCHAIN_USAGE_UNORDERED_ACCESS_BIT) {
+                desc.BindFlags |= D3D11_BIND_UNORDERED_ACCESS;
+            }
+
+            auto newSwapchain = std::make_unique<Swapchain>();
+            newSwapchain->createInfo = *createInfo;
+            newSwapchain->createInfo.next = nullptr;
+            newSwapchain->images.resize(m_config.swapchainImageCount);
+            for (auto& image : newSwapchain->images) {
+                const HRESULT hr = m_device->CreateTexture2D(&desc, nullptr, image.ReleaseAndGetAddressOf());
+                if (FAILED(hr)) {
+                    return hr == E_OUTOFMEMORY ? XR_ERROR_OUT_OF_MEMORY : XR_ERROR_RUNTIME_FAILURE;
+                }
+            }
+
+            const uint64_t handle = m_nextHandle++;
+            m_swapchains.insert_or_assign(handle, std::move(newSwapchain));
+            *swapchain = ToHandle<XrSwapchain>(handle);
+
+            return XR_SUCCESS;
+        }
+
+        XrResult xrDestroySwapchain(XrSwapchain swapchain) {
+            std::unique_lock lock(m_mutex);
+            if (!m_swapchains.erase(FromHandle(swapchain))) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+            return XR_SUCCESS;
+        }
+
+        XrResult xrEnumerateSwapchainImages(XrSwapchain swapchain,
+                                            uint32_t imageCapacityInput,
+                                            uint32_t* imageCountOutput,
+                                            XrSwapchainImageBaseHeader* images) {
+            std::unique_lock lock(m_mutex);
+            Swapchain* const swapchainState = getSwapchain(swapchain);
+            if (!swapchainState) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+            if (imageCapacityInput && images && images->type != XR_TYPE_SWAPCHAIN_IMAGE_D3D11_KHR) {
+                return XR_ERROR_VALIDATION_FAILURE;
+            }
+            return Enumerate(static_cast<uint32_t>(swapchainState->images.size()),
+                             imageCapacityInput,
+                             imageCountOutput,
+                             reinterpret_cast<XrSwapchainImageD3D11KHR*>(images),
+                             [&](XrSwapchainImageD3D11KHR& image, uint32_t i) {
+                                 image.texture = swapchainState->images[i].Get();
+                             });
+        }
+
+        XrResult xrAcquireSwapchainImage(XrSwapchain swapchain,
+                                         const XrSwapchainImageAcquireInfo* acquireInfo,
+                                         uint32_t* index) {
+            if ((acquireInfo && acquireInfo->type != XR_TYPE_SWAPCHAIN_IMAGE_ACQUIRE_INFO) || !index) {
+                return XR_ERROR_VALIDATION_FAILURE;
+            }
+
+            std::unique_lock lock(m_mutex);
+            Swapchain* const swapchainState = getSwapchain(swapchain);
+            if (!swapchainState) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+            if (swapchainState->acquired.size() == swapchainState->images.size()) {
+                return XR_ERROR_CALL_ORDER_INVALID;
+            }
+            *index = swapchainState->nextIndex;
+            swapchainState->acquired.push_back(*index);
+            swapchainState->nextIndex = (swapchainState->nextIndex + 1) % swapchainState->images.size();
+
+            return XR_SUCCESS;
+        }
+
+        XrResult xrWaitSwapchainImage(XrSwapchain swapchain, const XrSwapchainImageWaitInfo* waitInfo) {
+            if (!waitInfo || waitInfo->type != XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO) {
+                return XR_ERROR_VALIDATION_FAILURE;
+            }
+
+            // There is no compositor holding the images, so they are always immediately available.
+            std::unique_lock lock(m_mutex);
+            Swapchain* const swapchainState = getSwapchain(swapchain);
+            if (!swapchainState) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+            if (swapchainState->acquired.empty() || swapchainState->waited) {
+                return XR_ERROR_CALL_ORDER_INVALID;
+            }
+            swapchainState->waited = true;
+
+            return XR_SUCCESS;
+        }
+
+        XrResult xrReleaseSwapchainImage(XrSwapchain swapchain, const XrSwapchainImageReleaseInfo* releaseInfo) {
+            if (releaseInfo && releaseInfo->type != XR_TYPE_SWAPCHAIN_IMAGE_RELEASE_INFO) {
+                return XR_ERROR_VALIDATION_FAILURE;
+            }
+
+            std::unique_lock lock(m_mutex);
+            Swapchain* const swapchainState = getSwapchain(swapchain);
+            if (!swapchainState) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+            if (!swapchainState->waited) {
+                return XR_ERROR_CALL_ORDER_INVALID;
+            }
+            swapchainState->acquired.pop_front();
+            swapchainState->waited = false;
+            swapchainState->hasReleasedImage = true;
+
+            return XR_SUCCESS;
+        }
+
+        XrResult xrCreateActionSet(XrInstance instance,
+                                   const XrActionSetCreateInfo* createInfo,
+                                   XrActionSet* actionSet) {
+            if (!isInstance(instance)) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+            if (!createInfo || createInfo->type != XR_TYPE_ACTION_SET_CREATE_INFO || !actionSet) {
+                return XR_ERROR_VALIDATION_FAILURE;
+            }
+
+            std::unique_lock lock(m_mutex);
+            const uint64_t handle = m_nextHandle++;
+            m_actionSets.insert(handle);
+            *actionSet = ToHandle<XrActionSet>(handle);
+            return XR_SUCCESS;
+        }
+
+        XrResult xrCreateAction(XrActionSet actionSet, const XrActionCreateInfo* createInfo, XrAction* action) {
+            if (!createInfo || createInfo->type != XR_TYPE_ACTION_CREATE_INFO || !action) {
+                return XR_ERROR_VALIDATION_FAILURE;
+            }
+
+            std::unique_lock lock(m_mutex);
+            if (!m_actionSets.count(FromHandle(actionSet))) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+            const uint64_t handle = m_nextHandle++;
+            m_actions.insert(handle);
+            *action = ToHandle<XrAction>(handle);
+            return XR_SUCCESS;
+        }
+
+        XrResult xrSuggestInteractionProfileBindings(XrInstance instance,
+                                                     const XrInteractionProfileSuggestedBinding* suggestedBindings) {
+            if (!isInstance(instance)) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+            if (!suggestedBindings || suggestedBindings->type != XR_TYPE_INTERACTION_PROFILE_SUGGESTED_BINDING) {
+                return XR_ERROR_VALIDATION_FAILURE;
+            }
+            return XR_SUCCESS;
+        }
+
+        XrResult xrAttachSessionActionSets(XrSession session, const XrSessionActionSetsAttachInfo* attachInfo) {
+            std::unique_lock lock(m_mutex);
+            if (!isSession(session)) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+            if (!attachInfo || attachInfo->type != XR_TYPE_SESSION_ACTION_SETS_ATTACH_INFO) {
+                return XR_ERROR_VALIDATION_FAILURE;
+            }
+            return XR_SUCCESS;
+        }
+
+        XrResult xrSyncActions(XrSession session, const XrActionsSyncInfo* syncInfo) {
+            std::unique_lock lock(m_mutex);
+            if (!isSession(session)) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+            if (!syncInfo || syncInfo->type != XR_TYPE_ACTIONS_SYNC_INFO) {
+                return XR_ERROR_VALIDATION_FAILURE;
+            }
+            return XR_SUCCESS;
+        }
+
+        XrResult xrGetActionStatePose(XrSession session,
+                                      const XrActionStateGetInfo* getInfo,
+                                      XrActionStatePose* state) {
+            std::unique_lock lock(m_mutex);
+            if (!isSession(session)) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+            if (!getInfo || getInfo->type != XR_TYPE_ACTION_STATE_GET_INFO || !state ||
+                state->type != XR_TYPE_ACTION_STATE_POSE) {
+                return XR_ERROR_VALIDATION_FAILURE;
+            }
+            // There is no eye gaze interaction profile.
+            state->isActive = XR_FALSE;
+            return XR_SUCCESS;
+        }
+
+        XrResult xrCreateEyeTrackerFB(XrSession session,
+                                      const XrEyeTrackerCreateInfoFB* createInfo,
+                                      XrEyeTrackerFB* eyeTracker) {
+            if (!createInfo || createInfo->type != XR_TYPE_EYE_TRACKER_CREATE_INFO_FB || !eyeTracker) {
+                return XR_ERROR_VALIDATION_FAILURE;
+            }
+            if (!m_config.supportsEyeTracking) {
+                return XR_ERROR_FEATURE_UNSUPPORTED;
+            }
+
+            std::unique_lock lock(m_mutex);
+            if (!isSession(session)) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+            const uint64_t handle = m_nextHandle++;
+            m_eyeTrackers.insert(handle);
+            *eyeTracker = ToHandle<XrEyeTrackerFB>(handle);
+            return XR_SUCCESS;
+        }
+
+        XrResult xrDestroyEyeTrackerFB(XrEyeTrackerFB eyeTracker) {
+            std::unique_lock lock(m_mutex);
+            if (!m_eyeTrackers.erase(FromHandle(eyeTracker))) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+            return XR_SUCCESS;
+        }
+
+        XrResult xrGetEyeGazesFB(XrEyeTrackerFB eyeTracker, const XrEyeGazesInfoFB* gazeInfo, XrEyeGazesFB* eyeGazes) {
+            if (!gazeInfo || gazeInfo->type != XR_TYPE_EYE_GAZES_INFO_FB || !eyeGazes ||
+                eyeGazes->type != XR_TYPE_EYE_GAZES_FB) {
+                return XR_ERROR_VALIDATION_FAILURE;
+            }
+            if (gazeInfo->time <= 0) {
+                return XR_ERROR_TIME_INVALID;
+            }
+
+            std::unique_lock lock(m_mutex);
+            if (!m_eyeTrackers.count(FromHandle(eyeTracker))) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+            const auto it = m_spaces.find(FromHandle(gazeInfo->baseSpace));
+            if (it == m_spaces.cend()) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+
+            const double t = gazeInfo->time * 1e-9;
+            const float yaw = it->second ? 0.f : getHeadYaw(t);
+            const XrQuaternionf gazeOrientation = Multiply(YawRotation(yaw), LookRotation(getEyeGaze(t)));
+            for (uint32_t eye = 0; eye < 2; eye++) {
+                const float offset = (eye ? 0.5f : -0.5f) * m_config.ipd;
+                eyeGazes->gaze[eye].isValid = XR_TRUE;
+                eyeGazes->gaze[eye].gazeConfidence = 1.f;
+                eyeGazes->gaze[eye].gazePose.orientation = gazeOrientation;
+                eyeGazes->gaze[eye].gazePose.position = {offset * std::cos(yaw), 0.f, -offset * std::sin(yaw)};
+            }
+            eyeGazes->time = gazeInfo->time;
+            m_statistics.eyeGazeQueries++;
+
+            return XR_SUCCESS;
+        }
+
+        XrResult xrConvertWin32PerformanceCounterToTimeKHR(XrInstance instance,
+                                                          const LARGE_INTEGER* performanceCounter,
+                                                          XrTime* time) {
+            if (!isInstance(instance)) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+            if (!performanceCounter || !time) {
+                return XR_ERROR_VALIDATION_FAILURE;
+            }
+            *time = toXrTime(performanceCounter->QuadPart);
+            return XR_SUCCESS;
+        }
+
+      private:
+        struct Swapchain {
+            XrSwapchainCreateInfo createInfo{};
+            std::vector<ComPtr<ID3D11Texture2D>> images;
+            std::deque<uint32_t> acquired;
+            uint32_t nextIndex{0};
+            bool waited{false};
+            bool hasReleasedImage{false};
+        };
+
+        bool isInstance(XrInstance instance) {
+            std::unique_lock lock(m_mutex);
+            return m_instances.count(FromHandle(instance));
+        }
+
+        // Must be called with the lock held.
+        bool isSession(XrSession session) const {
+            return m_session && FromHandle(session) == m_session;
+        }
+
+        // Must be called with the lock held.
+        Swapchain* getSwapchain(XrSwapchain swapchain) {
+            const auto it = m_swapchains.find(FromHandle(swapchain));
+            return it != m_swapchains.end() ? it->second.get() : nullptr;
+        }
+
+        XrResult checkViewConfiguration(XrInstance instance,
+                                        XrSystemId systemId,
+                                        XrViewConfigurationType viewConfigurationType) {
+            if (!isInstance(instance)) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+            if (systemId != MockSystemId) {
+                return XR_ERROR_SYSTEM_INVALID;
+            }
+            if (viewConfigurationType != XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO) {
+                return XR_ERROR_VIEW_CONFIGURATION_TYPE_UNSUPPORTED;
+            }
+            return XR_SUCCESS;
+        }
+
+        // Must be called with the lock held.
+        XrResult checkSubImage(const XrSwapchainSubImage& subImage) {
+            const Swapchain* const swapchainState = getSwapchain(subImage.swapchain);
+            if (!swapchainState || !swapchainState->hasReleasedImage) {
+                return XR_ERROR_LAYER_INVALID;
+            }
+            const XrRect2Di& rect = subImage.imageRect;
+            if (rect.offset.x < 0 || rect.offset.y < 0 || rect.extent.width <= 0 || rect.extent.height <= 0 ||
+                rect.offset.x + rect.extent.width > static_cast<int32_t>(swapchainState->createInfo.width) ||
+                rect.offset.y + rect.extent.height > static_cast<int32_t>(swapchainState->createInfo.height)) {
+                return XR_ERROR_SWAPCHAIN_RECT_INVALID;
+            }
+            if (subImage.imageArrayIndex >= swapchainState->createInfo.arraySize) {
+                return XR_ERROR_VALIDATION_FAILURE;
+            }
+            return XR_SUCCESS;
+        }
+
+        // Must be called with the lock held.
+        void queueSessionState(XrSessionState state) {
+            XrEventDataBuffer buffer{XR_TYPE_EVENT_DATA_BUFFER};
+            XrEventDataSessionStateChanged& event = *reinterpret_cast<XrEventDataSessionStateChanged*>(&buffer);
+            event.type = XR_TYPE_EVENT_DATA_SESSION_STATE_CHANGED;
+            event.next = nullptr;
+            event.session = ToHandle<XrSession>(m_session);
+            event.state = state;
+            event.time = getTime();
+            m_events.push_back(buffer);
+        }
+
+        float getHeadYaw(double t) const {
+            return m_config.headMotionAmplitude * static_cast<float>(std::sin(2 * Pi * HeadMotionFrequency * t));
+        }
+
+        float getHeadYawRate(double t) const {
+            return m_config.headMotionAmplitude *
+                   static_cast<float>(2 * Pi * HeadMotionFrequency * std::cos(2 * Pi * HeadMotionFrequency * t));
+        }
+
+        // Must be called with the lock held.
+        XrVector3f getEyeGaze(double t) const {
+            double yaw = 0, pitch = 0;
+            switch (m_config.gazePattern) {
+            case GazePattern::Center:
+                break;
+
+            case GazePattern::Saccades: {
+                static constexpr double FixationDuration = 0.35;
+                static constexpr double SaccadeDuration = 0.04;
+                const auto fixationYaw = [](uint64_t k) { return (Hash(2 * k) * 2 - 1) * 0.35; };
+                const auto fixationPitch = [](uint64_t k) { return (Hash(2 * k + 1) * 2 - 1) * 0.25; };
+
+                const uint64_t fixation = static_cast<uint64_t>(t / FixationDuration);
+                const double phase = std::fmod(t, FixationDuration);
+                yaw = fixationYaw(fixation);
+                pitch = fixationPitch(fixation);
+                if (phase < SaccadeDuration && fixation) {
+                    const double alpha = phase / SaccadeDuration;
+                    yaw = fixationYaw(fixation - 1) + alpha * (yaw - fixationYaw(fixation - 1));
+                    pitch = fixationPitch(fixation - 1) + alpha * (pitch - fixationPitch(fixation - 1));
+                }
+                break;
+            }
+
+            case GazePattern::Sweep:
+                yaw = 0.4 * std::sin(2 * Pi * 0.25 * t);
+                pitch = 0.25 * std::sin(2 * Pi * 0.5 * t);
+                break;
+
+            case GazePattern::Replay:
+                return m_replayEyeGaze;
+            }
+
+            return {static_cast<float>(std::sin(yaw) * std::cos(pitch)),
+                    static_cast<float>(std::sin(pitch)),
+                    static_cast<float>(-std::cos(yaw) * std::cos(pitch))};
+        }
+
+        XrTime getTime() const {
+            LARGE_INTEGER counter;
+            QueryPerformanceCounter(&counter);
+            return toXrTime(counter.QuadPart);
+        }
+
+        XrTime toXrTime(int64_t counter) const {
+            return (counter / m_qpcFrequency) * 1'000'000'000 +
+                   (counter % m_qpcFrequency) * 1'000'000'000 / m_qpcFrequency;
+        }
+
+        void sleepUntil(XrTime time) const {
+            const XrTime now = getTime();
+            if (time <= now) {
+                return;
+            }
+
+            LARGE_INTEGER dueTime;
+            dueTime.QuadPart = -static_cast<LONGLONG>((time - now) / 100);
+            if (m_timer && SetWaitableTimer(m_timer, &dueTime, 0, nullptr, nullptr, FALSE)) {
+                WaitForSingleObject(m_timer, INFINITE);
+            }
+
+            // Spin for the remainder that the timer could not resolve.
+            while (getTime() < time) {
+                std::this_thread::yield();
+            }
+        }
+
+        static constexpr double HeadMotionFrequency = 0.3;
+
+        MockRuntimeConfig m_config;
+        int64_t m_qpcFrequency{1};
+        HANDLE m_timer{nullptr};
+
+        std::mutex m_mutex;
+        uint64_t m_nextHandle{1};
+        std::set<uint64_t> m_instances;
+        std::vector<std::string> m_paths;
+        std::deque<XrEventDataBuffer> m_events;
+        std::set<uint64_t> m_actionSets;
+        std::set<uint64_t> m_actions;
+
+        uint64_t m_session{0};
+        ComPtr<ID3D11Device> m_device;
+        bool m_sessionRunning{false};
+        // The value is whether the space is head-locked.
+        std::map<uint64_t, bool> m_spaces;
+        std::map<uint64_t, std::unique_ptr<Swapchain>> m_swapchains;
+        std::set<uint64_t> m_eyeTrackers;
+        XrVector3f m_replayEyeGaze{0.f, 0.f, -1.f};
+
+        std::mutex m_waitFrameMutex;
+        std::condition_variable m_frameCondition;
+        XrTime m_displayPeriod{11'111'111};
+        XrTime m_lastVsync{0};
+        uint64_t m_framesWaited{0};
+        uint64_t m_framesBegun{0};
+        bool m_frameInProgress{false};
+
+        MockRuntimeStatistics m_statistics;
+    };
+
+    MockRuntime& GetMockRuntime() {
+        static MockRuntime runtime;
+        return runtime;
+    }
+
+    // Turn a member function into an OpenXR entry point that cannot throw.
+    template <typename Method, Method method>
+    struct Entry;
+
+    template <typename... Args, XrResult (MockRuntime::*method)(Args...)>
+    struct Entry<XrResult (MockRuntime::*)(Args...), method> {
+        static XrResult XRAPI_CALL Invoke(Args... args) {
+            try {
+                return (GetMockRuntime().*method)(args...);
+            } catch (std::exception&) {
+                return XR_ERROR_RUNTIME_FAILURE;
+            }
+        }
+    };
+
+#define MOCK_ENTRY(name)                                                                                               \
+    {                                                                                                                  \
+        #name, reinterpret_cast<PFN_xrVoidFunction>(&Entry<decltype(&MockRuntime::name), &MockRuntime::name>::Invoke) \
+    }
+
+    const std::map<std::string_view, PFN_xrVoidFunction> MockFunctions = {
+        MOCK_ENTRY(xrGetInstanceProcAddr),
+        MOCK_ENTRY(xrDestroyInstance),
+        MOCK_ENTRY(xrEnumerateInstanceExtensionProperties),
+        MOCK_ENTRY(xrGetInstanceProperties),
+        MOCK_ENTRY(xrPollEvent),
+        MOCK_ENTRY(xrStringToPath),
+        MOCK_ENTRY(xrPathToString),
+        MOCK_ENTRY(xrGetSystem),
+        MOCK_ENTRY(xrGetSystemProperties),
+        MOCK_ENTRY(xrEnumerateEnvironmentBlendModes),
+        MOCK_ENTRY(xrEnumerateViewConfigurations),
+        MOCK_ENTRY(xrGetViewConfigurationProperties),
+        MOCK_ENTRY(xrEnumerateViewConfigurationViews),
+        MOCK_ENTRY(xrCreateSession),
+        MOCK_ENTRY(xrDestroySession),
+        MOCK_ENTRY(xrBeginSession),
+        MOCK_ENTRY(xrEndSession),
+        MOCK_ENTRY(xrRequestExitSession),
+        MOCK_ENTRY(xrGetVisibilityMaskKHR),
+        MOCK_ENTRY(xrCreateReferenceSpace),
+        MOCK_ENTRY(xrCreateActionSpace),
+        MOCK_ENTRY(xrDestroySpace),
+        MOCK_ENTRY(xrLocateSpace),
+        MOCK_ENTRY(xrLocateViews),
+        MOCK_ENTRY(xrWaitFrame),
+        MOCK_ENTRY(xrBeginFrame),
+        MOCK_ENTRY(xrEndFrame),
+        MOCK_ENTRY(xrEnumerateSwapchainFormats),
+        MOCK_ENTRY(xrCreateSwapchain),
+        MOCK_ENTRY(xrDestroySwapchain),
+        MOCK_ENTRY(xrEnumerateSwapchainImages),
+        MOCK_ENTRY(xrAcquireSwapchainImage),
+        MOCK_ENTRY(xrWaitSwapchainImage),
+        MOCK_ENTRY(xrReleaseSwapchainImage),
+        MOCK_ENTRY(xrCreateActionSet),
+        MOCK_ENTRY(xrCreateAction),
+        MOCK_ENTRY(xrSuggestInteractionProfileBindings),
+        MOCK_ENTRY(xrAttachSessionActionSets),
+        MOCK_ENTRY(xrSyncActions),
+        MOCK_ENTRY(xrGetActionStatePose),
+        MOCK_ENTRY(xrCreateEyeTrackerFB),
+        MOCK_ENTRY(xrDestroyEyeTrackerFB),
+        MOCK_ENTRY(xrGetEyeGazesFB),
+        MOCK_ENTRY(xrConvertWin32PerformanceCounterToTimeKHR),
+    };
+
+#undef MOCK_ENTRY
+
+    XrResult MockRuntime::xrGetInstanceProcAddr(XrInstance instance, const char* name, PFN_xrVoidFunction* function) {
+        if (!name || !function) {
+            return XR_ERROR_VALIDATION_FAILURE;
+        }
+        *function = nullptr;
+
+        const std::string_view functionName(name);
+        if (instance == XR_NULL_HANDLE && functionName != "xrEnumerateInstanceExtensionProperties" &&
+            functionName != "xrGetInstanceProcAddr") {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+        if (instance != XR_NULL_HANDLE && !isInstance(instance)) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+
+        const auto it = MockFunctions.find(functionName);
+        if (it == MockFunctions.cend()) {
+            return XR_ERROR_FUNCTION_UNSUPPORTED;
+        }
+        *function = it->second;
+
+        return XR_SUCCESS;
+    }
+
+} // namespace
+
+namespace openxr_api_layer::benchmark {
+
+    void ConfigureMockRuntime(const MockRuntimeConfig& config) {
+        GetMockRuntime().configure(config);
+    }
+
+    void SetMockEyeGaze(const XrVector3f& direction) {
+        GetMockRuntime().setEyeGaze(direction);
+    }
+
+    MockRuntimeStatistics GetMockRuntimeStatistics() {
+        return GetMockRuntime().getStatistics();
+    }
+
+    XrResult XRAPI_CALL MockGetInstanceProcAddr(XrInstance instance, const char* name, PFN_xrVoidFunction* function) {
+        return Entry<decltype(&MockRuntime::xrGetInstanceProcAddr), &MockRuntime::xrGetInstanceProcAddr>::Invoke(
+            instance, name, function);
+    }
+
+    XrResult XRAPI_CALL MockCreateApiLayerInstance(const XrInstanceCreateInfo* createInfo,
+                                                   const XrApiLayerCreateInfo* apiLayerInfo,
+                                                   XrInstance* instance) {
+        // We are the end of the chain.
+        if (!apiLayerInfo || apiLayerInfo->nextInfo) {
+            return XR_ERROR_INITIALIZATION_FAILED;
+        }
+        return Entry<decltype(&MockRuntime::xrCreateInstance), &MockRuntime::xrCreateInstance>::Invoke(createInfo,
+                                                                                                     instance);
+    }
+
+} // namespace openxr_api_layer::benchmark
@@ -0,0 +1,82 @@
+// MIT License
+//
+// Copyright(c) 2021-2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+namespace openxr_api_layer::benchmark {
+
+    // The mock runtime stands in for the OpenXR runtime at the bottom of the chain. It exposes a stereo headset with
+    // D3D11 swapchains and social eye tracking, and it paces xrWaitFrame() to the display refresh rate. It only
+    // implements what the layer and the synthetic app need, with the validation a runtime would do on these calls.
+
+    // How the simulated eye gaze moves.
+    enum class GazePattern {
+        // Always looking straight ahead.
+        Center,
+
+        // Fixations at pseudo-random points, with short saccades in between.
+        Saccades,
+
+        // A smooth figure-eight pursuit.
+        Sweep,
+
+        // The direction given to SetMockEyeGaze().
+        Replay,
+    };
+
+    struct MockRuntimeConfig {
+        float displayRefreshRate{90.f};
+        XrExtent2Di recommendedResolution{2064, 2208};
+        XrFovf eyeFov[2]{{-0.942478f, 0.698132f, 0.767945f, -0.942478f},
+                         {-0.698132f, 0.942478f, 0.767945f, -0.942478f}};
+        float ipd{0.063f};
+        uint32_t swapchainImageCount{3};
+        bool supportsEyeTracking{true};
+        GazePattern gazePattern{GazePattern::Saccades};
+        // The amplitude of the head yaw oscillation (in radians), which drives the adaptive sharpening.
+        float headMotionAmplitude{0.f};
+    };
+
+    struct MockRuntimeStatistics {
+        uint64_t framesWaited{0};
+        uint64_t framesBegun{0};
+        uint64_t framesDiscarded{0};
+        uint64_t framesSubmitted{0};
+        uint64_t layersSubmitted{0};
+        uint64_t eyeGazeQueries{0};
+    };
+
+    // Must be called while no instance exists.
+    void ConfigureMockRuntime(const MockRuntimeConfig& config);
+
+    // Used with GazePattern::Replay. The direction is in view space, with -Z forward.
+    void SetMockEyeGaze(const XrVector3f& direction);
+
+    MockRuntimeStatistics GetMockRuntimeStatistics();
+
+    // The entry points to give to the layer in its XrApiLayerNextInfo.
+    XrResult XRAPI_CALL MockGetInstanceProcAddr(XrInstance instance, const char* name, PFN_xrVoidFunction* function);
+    XrResult XRAPI_CALL MockCreateApiLayerInstance(const XrInstanceCreateInfo* createInfo,
+                                                   const XrApiLayerCreateInfo* apiLayerInfo,
+                                                   XrInstance* instance);
+
+} // namespace openxr_api_layer::benchmark
@@ -0,0 +1,567 @@
+// MIT License
+//
+// Copyright(c) 2021-2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "mock_runtime.h"
+#include "synthetic_app.h"
+
+namespace {
+
+    using namespace openxr_api_layer::benchmark;
+
+    constexpr DXGI_FORMAT DepthFormat = DXGI_FORMAT_D32_FLOAT;
+
+    class SyntheticApp {
+      public:
+        SyntheticApp(const LoadedLayer& layer, const SyntheticAppConfig& config, FrameSource* frameSource)
+            : m_layer(layer), m_config(config), m_frameSource(frameSource) {
+            m_results.calls = {{"xrWaitFrame"},
+                               {"xrBeginFrame"},
+                               {"xrLocateViews"},
+                               {"xrAcquireSwapchainImage"},
+                               {"xrWaitSwapchainImage"},
+                               {"xrReleaseSwapchainImage"},
+                               {"xrEndFrame"}};
+            m_results.frameInterval.name = "frame interval";
+        }
+
+        ~SyntheticApp() {
+            for (auto& view : m_views) {
+                if (view.colorSwapchain != XR_NULL_HANDLE) {
+                    m_xrDestroySwapchain(view.colorSwapchain);
+                }
+                if (view.depthSwapchain != XR_NULL_HANDLE) {
+                    m_xrDestroySwapchain(view.depthSwapchain);
+                }
+            }
+            if (m_localSpace != XR_NULL_HANDLE) {
+                m_xrDestroySpace(m_localSpace);
+            }
+            // This is where the layer logs its statistics.
+            if (m_session != XR_NULL_HANDLE) {
+                m_xrDestroySession(m_session);
+            }
+            if (m_instance != XR_NULL_HANDLE) {
+                m_xrDestroyInstance(m_instance);
+            }
+        }
+
+        SyntheticAppResults run() {
+            createDevice();
+            createInstance();
+            createSession();
+            createSwapchains();
+            if (m_frameSource) {
+                m_frameSource->initialize(m_device.Get(), m_results.views, m_colorFormat);
+            }
+
+            // Wait for the runtime to let us begin the session.
+            while (!m_sessionRunning) {
+                pollEvents();
+            }
+
+            for (uint32_t i = 0; i < m_config.warmUpFrameCount + m_config.frameCount; i++) {
+                m_recording = i >= m_config.warmUpFrameCount;
+                renderFrame(i);
+                pollEvents();
+            }
+
+            CHECK_XRCMD(m_xrRequestExitSession(m_session));
+            while (!m_exitRequested) {
+                pollEvents();
+            }
+
+            return std::move(m_results);
+        }
+
+      private:
+        struct View {
+            XrSwapchain colorSwapchain{XR_NULL_HANDLE};
+            std::vector<ComPtr<ID3D11Texture2D>> colorImages;
+            std::vector<ComPtr<ID3D11RenderTargetView>> renderTargetViews;
+            XrSwapchain depthSwapchain{XR_NULL_HANDLE};
+            std::vector<ComPtr<ID3D11DepthStencilView>> depthStencilViews;
+        };
+
+        void createDevice() {
+            const D3D_FEATURE_LEVEL featureLevels[] = {D3D_FEATURE_LEVEL_11_1, D3D_FEATURE_LEVEL_11_0};
+            CHECK_HRCMD(D3D11CreateDevice(nullptr,
+                                          m_config.useWarpDevice ? D3D_DRIVER_TYPE_WARP : D3D_DRIVER_TYPE_HARDWARE,
+                                          nullptr,
+                                          0,
+                                          featureLevels,
+                                          static_cast<UINT>(std::size(featureLevels)),
+                                          D3D11_SDK_VERSION,
+                                          m_device.ReleaseAndGetAddressOf(),
+                                          nullptr,
+                                          m_context.ReleaseAndGetAddressOf()));
+        }
+
+        void createInstance() {
+            std::vector<const char*> extensions{XR_KHR_D3D11_ENABLE_EXTENSION_NAME,
+                                                XR_KHR_VISIBILITY_MASK_EXTENSION_NAME};
+            if (m_config.submitDepth) {
+                extensions.push_back(XR_KHR_COMPOSITION_LAYER_DEPTH_EXTENSION_NAME);
+            }
+            if (m_config.useQuadViews) {
+                extensions.push_back(XR_VARJO_QUAD_VIEWS_EXTENSION_NAME);
+                if (m_config.useFoveatedRendering) {
+                    extensions.push_back(XR_VARJO_FOVEATED_RENDERING_EXTENSION_NAME);
+                }
+            }
+
+            XrInstanceCreateInfo createInfo{XR_TYPE_INSTANCE_CREATE_INFO};
+            strcpy_s(createInfo.applicationInfo.applicationName, "SyntheticApp");
+            strcpy_s(createInfo.applicationInfo.engineName, "SyntheticApp");
+            createInfo.applicationInfo.apiVersion = XR_CURRENT_API_VERSION;
+            createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+            createInfo.enabledExtensionNames = extensions.data();
+
+            // The loader would pass the layer the next element in the chain, which is the runtime.
+            XrApiLayerNextInfo nextInfo{XR_LOADER_INTERFACE_STRUCT_API_LAYER_NEXT_INFO,
+                                        XR_API_LAYER_NEXT_INFO_STRUCT_VERSION,
+                                        sizeof(XrApiLayerNextInfo)};
+            strcpy_s(nextInfo.layerName, LAYER_NAME);
+            nextInfo.nextGetInstanceProcAddr = MockGetInstanceProcAddr;
+            nextInfo.nextCreateApiLayerInstance = MockCreateApiLayerInstance;
+            nextInfo.next = nullptr;
+
+            XrApiLayerCreateInfo apiLayerInfo{XR_LOADER_INTERFACE_STRUCT_API_LAYER_CREATE_INFO,
+                                              XR_API_LAYER_CREATE_INFO_STRUCT_VERSION,
+                                              sizeof(XrApiLayerCreateInfo)};
+            apiLayerInfo.loaderInstance = nullptr;
+            apiLayerInfo.settings_file_location[0] = '\0';
+            apiLayerInfo.nextInfo = &nextInfo;
+
+            CHECK_XRCMD(m_layer.createApiLayerInstance(&createInfo, &apiLayerInfo, &m_instance));
+
+            // Resolve the functions through the layer, which hooks the ones it overrides as they are queried.
+            const auto resolve = [&](const char* name, auto& function) {
+                CHECK_XRCMD(m_layer.getInstanceProcAddr(
+                    m_instance, name, reinterpret_cast<PFN_xrVoidFunction*>(&function)));
+            };
+            resolve("xrDestroyInstance", m_xrDestroyInstance);
+            resolve("xrPollEvent", m_xrPollEvent);
+            resolve("xrGetSystem", m_xrGetSystem);
+            resolve("xrGetSystemProperties", m_xrGetSystemProperties);
+            resolve("xrEnumerateViewConfigurationViews", m_xrEnumerateViewConfigurationViews);
+            resolve("xrCreateSession", m_xrCreateSession);
+            resolve("xrDestroySession", m_xrDestroySession);
+            resolve("xrBeginSession", m_xrBeginSession);
+            resolve("xrEndSession", m_xrEndSession);
+            resolve("xrRequestExitSession", m_xrRequestExitSession);
+            resolve("xrCreateReferenceSpace", m_xrCreateReferenceSpace);
+            resolve("xrDestroySpace", m_xrDestroySpace);
+            resolve("xrEnumerateSwapchainFormats", m_xrEnumerateSwapchainFormats);
+            resolve("xrCreateSwapchain", m_xrCreateSwapchain);
+            resolve("xrDestroySwapchain", m_xrDestroySwapchain);
+            resolve("xrEnumerateSwapchainImages", m_xrEnumerateSwapchainImages);
+            resolve("xrAcquireSwapchainImage", m_xrAcquireSwapchainImage);
+            resolve("xrWaitSwapchainImage", m_xrWaitSwapchainImage);
+            resolve("xrReleaseSwapchainImage", m_xrReleaseSwapchainImage);
+            resolve("xrLocateViews", m_xrLocateViews);
+            resolve("xrWaitFrame", m_xrWaitFrame);
+            resolve("xrBeginFrame", m_xrBeginFrame);
+            resolve("xrEndFrame", m_xrEndFrame);
+        }
+
+        void createSession() {
+            XrSystemGetInfo getInfo{XR_TYPE_SYSTEM_GET_INFO};
+            getInfo.formFactor = XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY;
+            CHECK_XRCMD(m_xrGetSystem(m_instance, &getInfo, &m_systemId));
+
+            XrSystemFoveatedRenderingPropertiesVARJO foveatedRenderingProperties{
+                XR_TYPE_SYSTEM_FOVEATED_RENDERING_PROPERTIES_VARJO};
+            XrSystemProperties systemProperties{XR_TYPE_SYSTEM_PROPERTIES};
+            if (m_config.useQuadViews && m_config.useFoveatedRendering) {
+                systemProperties.next = &foveatedRenderingProperties;
+            }
+            CHECK_XRCMD(m_xrGetSystemProperties(m_instance, m_systemId, &systemProperties));
+            m_useFoveatedRendering = m_config.useQuadViews && m_config.useFoveatedRendering &&
+                                     foveatedRenderingProperties.supportsFoveatedRendering;
+
+            m_viewConfigurationType = m_config.useQuadViews ? XR_VIEW_CONFIGURATION_TYPE_PRIMARY_QUAD_VARJO
+                                                            : XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO;
+            uint32_t viewCount = 0;
+            CHECK_XRCMD(m_xrEnumerateViewConfigurationViews(
+                m_instance, m_systemId, m_viewConfigurationType, 0, &viewCount, nullptr));
+            std::vector<XrFoveatedViewConfigurationViewVARJO> foveatedViews(
+                viewCount, {XR_TYPE_FOVEATED_VIEW_CONFIGURATION_VIEW_VARJO, nullptr, XR_TRUE});
+            m_results.views.resize(viewCount, {XR_TYPE_VIEW_CONFIGURATION_VIEW});
+            if (m_useFoveatedRendering) {
+                for (uint32_t i = 0; i < viewCount; i++) {
+                    m_results.views[i].next = &foveatedViews[i];
+                }
+            }
+            CHECK_XRCMD(m_xrEnumerateViewConfigurationViews(
+                m_instance, m_systemId, m_viewConfigurationType, viewCount, &viewCount, m_results.views.data()));
+            for (auto& view : m_results.views) {
+                view.next = nullptr;
+            }
+
+            XrGraphicsBindingD3D11KHR d3d11Bindings{XR_TYPE_GRAPHICS_BINDING_D3D11_KHR};
+            d3d11Bindings.device = m_device.Get();
+            XrSessionCreateInfo createInfo{XR_TYPE_SESSION_CREATE_INFO};
+            createInfo.next = &d3d11Bindings;
+            createInfo.systemId = m_systemId;
+            CHECK_XRCMD(m_xrCreateSession(m_instance, &createInfo, &m_session));
+
+            XrReferenceSpaceCreateInfo spaceCreateInfo{XR_TYPE_REFERENCE_SPACE_CREATE_INFO};
+            spaceCreateInfo.referenceSpaceType = XR_REFERENCE_SPACE_TYPE_LOCAL;
+            spaceCreateInfo.poseInReferenceSpace.orientation.w = 1.f;
+            CHECK_XRCMD(m_xrCreateReferenceSpace(m_session, &spaceCreateInfo, &m_localSpace));
+        }
+
+        void createSwapchains() {
+            uint32_t formatCount = 0;
+            CHECK_XRCMD(m_xrEnumerateSwapchainFormats(m_session, 0, &formatCount, nullptr));
+            std::vector<int64_t> formats(formatCount);
+            CHECK_XRCMD(m_xrEnumerateSwapchainFormats(m_session, formatCount, &formatCount, formats.data()));
+            const auto colorFormat =
+                std::find_first_of(formats.cbegin(),
+                                   formats.cend(),
+                                   std::cbegin(PreferredColorFormats),
+                                   std::cend(PreferredColorFormats));
+            if (colorFormat == formats.cend()) {
+                throw std::runtime_error("No supported color format");
+            }
+            m_colorFormat = static_cast<DXGI_FORMAT>(*colorFormat);
+
+            m_views.resize(m_results.views.size());
+            for (uint32_t i = 0; i < m_views.size(); i++) {
+                View& view = m_views[i];
+
+                XrSwapchainCreateInfo createInfo{XR_TYPE_SWAPCHAIN_CREATE_INFO};
+                createInfo.usageFlags = XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT | XR_SWAPCHAIN_USAGE_SAMPLED_BIT |
+                                        XR_SWAPCHAIN_USAGE_TRANSFER_DST_BIT;
+                createInfo.format = m_colorFormat;
+                createInfo.sampleCount = 1;
+                createInfo.width = m_results.views[i].recommendedImageRectWidth;
+                createInfo.height = m_results.views[i].recommendedImageRectHeight;
+                createInfo.faceCount = createInfo.arraySize = createInfo.mipCount = 1;
+                CHECK_XRCMD(m_xrCreateSwapchain(m_session, &createInfo, &view.colorSwapchain));
+                for (const auto& image : enumerateImages(view.colorSwapchain)) {
+                    D3D11_RENDER_TARGET_VIEW_DESC desc{};
+                    desc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
+                    desc.Format = m_colorFormat;
+                    ComPtr<ID3D11RenderTargetView> renderTargetView;
+                    CHECK_HRCMD(m_device->CreateRenderTargetView(image, &desc, renderTargetView.GetAddressOf()));
+                    view.colorImages.push_back(image);
+                    view.renderTargetViews.push_back(renderTargetView);
+                }
+
+                if (m_config.submitDepth) {
+                    createInfo.usageFlags =
+                        XR_SWAPCHAIN_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | XR_SWAPCHAIN_USAGE_SAMPLED_BIT;
+                    createInfo.format = DepthFormat;
+                    CHECK_XRCMD(m_xrCreateSwapchain(m_session, &createInfo, &view.depthSwapchain));
+                    for (const auto& image : enumerateImages(view.depthSwapchain)) {
+                        D3D11_DEPTH_STENCIL_VIEW_DESC desc{};
+                        desc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
+                        desc.Format = DepthFormat;
+                        ComPtr<ID3D11DepthStencilView> depthStencilView;
+                        CHECK_HRCMD(m_device->CreateDepthStencilView(image, &desc, depthStencilView.GetAddressOf()));
+                        view.depthStencilViews.push_back(depthStencilView);
+                    }
+                }
+            }
+        }
+
+        std::vector<ID3D11Texture2D*> enumerateImages(XrSwapchain swapchain) {
+            uint32_t imageCount = 0;
+            CHECK_XRCMD(m_xrEnumerateSwapchainImages(swapchain, 0, &imageCount, nullptr));
+            std::vector<XrSwapchainImageD3D11KHR> images(imageCount, {XR_TYPE_SWAPCHAIN_IMAGE_D3D11_KHR});
+            CHECK_XRCMD(m_xrEnumerateSwapchainImages(
+                swapchain, imageCount, &imageCount, reinterpret_cast<XrSwapchainImageBaseHeader*>(images.data())));
+
+            std::vector<ID3D11Texture2D*> textures;
+            for (const auto& image : images) {
+                textures.push_back(image.texture);
+            }
+            return textures;
+        }
+
+        void pollEvents() {
+            while (true) {
+                XrEventDataBuffer event{XR_TYPE_EVENT_DATA_BUFFER};
+                const XrResult result = m_xrPollEvent(m_instance, &event);
+                CHECK_XRCMD(result);
+                if (result == XR_EVENT_UNAVAILABLE) {
+                    break;
+                }
+                if (event.type != XR_TYPE_EVENT_DATA_SESSION_STATE_CHANGED) {
+                    continue;
+                }
+
+                switch (reinterpret_cast<const XrEventDataSessionStateChanged&>(event).state) {
+                case XR_SESSION_STATE_READY: {
+                    XrSessionBeginInfo beginInfo{XR_TYPE_SESSION_BEGIN_INFO};
+                    beginInfo.primaryViewConfigurationType = m_viewConfigurationType;
+                    CHECK_XRCMD(m_xrBeginSession(m_session, &beginInfo));
+                    m_sessionRunning = true;
+                    break;
+                }
+
+                case XR_SESSION_STATE_STOPPING:
+                    CHECK_XRCMD(m_xrEndSession(m_session));
+                    m_sessionRunning = false;
+                    break;
+
+                case XR_SESSION_STATE_EXITING:
+                case XR_SESSION_STATE_LOSS_PENDING:
+                    m_exitRequested = true;
+                    break;
+
+                default:
+                    break;
+                }
+            }
+        }
+
+        void renderFrame(uint32_t frameIndex) {
+            XrFrameState frameState{XR_TYPE_FRAME_STATE};
+            CHECK_XRCMD(timeCall(0, [&] { return m_xrWaitFrame(m_session, nullptr, &frameState); }));
+            const auto now = std::chrono::steady_clock::now();
+            if (m_recording && m_lastWaitFrame) {
+                m_results.frameInterval.samples.push_back(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(now - *m_lastWaitFrame).count());
+            }
+            m_lastWaitFrame = now;
+
+            const XrResult beginResult = timeCall(1, [&] { return m_xrBeginFrame(m_session, nullptr); });
+            CHECK_XRCMD(beginResult);
+            if (beginResult == XR_FRAME_DISCARDED && m_recording) {
+                m_results.framesDiscarded++;
+            }
+
+            if (m_frameSource) {
+                m_frameSource->beginFrame(frameIndex);
+            }
+
+            XrViewLocateFoveatedRenderingVARJO foveatedLocate{XR_TYPE_VIEW_LOCATE_FOVEATED_RENDERING_VARJO};
+            foveatedLocate.foveatedRenderingActive = XR_TRUE;
+            XrViewLocateInfo locateInfo{XR_TYPE_VIEW_LOCATE_INFO};
+            locateInfo.next = m_useFoveatedRendering ? &foveatedLocate : nullptr;
+            locateInfo.viewConfigurationType = m_viewConfigurationType;
+            locateInfo.displayTime = frameState.predictedDisplayTime;
+            locateInfo.space = m_localSpace;
+            XrViewState viewState{XR_TYPE_VIEW_STATE};
+            std::vector<XrView> views(m_views.size(), {XR_TYPE_VIEW});
+            uint32_t viewCount = 0;
+            CHECK_XRCMD(timeCall(2, [&] {
+                return m_xrLocateViews(m_session,
+                                       &locateInfo,
+                                       &viewState,
+                                       static_cast<uint32_t>(views.size()),
+                                       &viewCount,
+                                       views.data());
+            }));
+
+            std::vector<XrCompositionLayerProjectionView> projectionViews(m_views.size(),
+                                                                          {XR_TYPE_COMPOSITION_LAYER_PROJECTION_VIEW});
+            std::vector<XrCompositionLayerDepthInfoKHR> depthInfo(m_views.size(),
+                                                                  {XR_TYPE_COMPOSITION_LAYER_DEPTH_INFO_KHR});
+            for (uint32_t i = 0; i < m_views.size() && frameState.shouldRender; i++) {
+                View& view = m_views[i];
+                const XrRect2Di imageRect{{0, 0},
+                                          {static_cast<int32_t>(m_results.views[i].recommendedImageRectWidth),
+                                           static_cast<int32_t>(m_results.views[i].recommendedImageRectHeight)}};
+
+                const uint32_t colorIndex = acquireAndWait(view.colorSwapchain);
+                if (m_frameSource) {
+                    m_frameSource->renderView(frameIndex,
+                                              i,
+                                              views[i],
+                                              m_context.Get(),
+                                              view.colorImages[colorIndex].Get(),
+                                              view.renderTargetViews[colorIndex].Get());
+                } else {
+                    const float clearColor[] = {i * 0.25f, 0.5f, 1.f - i * 0.25f, 1.f};
+                    m_context->ClearRenderTargetView(view.renderTargetViews[colorIndex].Get(), clearColor);
+                }
+                release(view.colorSwapchain);
+
+                projectionViews[i].pose = views[i].pose;
+                projectionViews[i].fov = views[i].fov;
+                projectionViews[i].subImage.swapchain = view.colorSwapchain;
+                projectionViews[i].subImage.imageRect = imageRect;
+
+                if (m_config.submitDepth) {
+                    const uint32_t depthIndex = acquireAndWait(view.depthSwapchain);
+                    m_context->ClearDepthStencilView(
+                        view.depthStencilViews[depthIndex].Get(), D3D11_CLEAR_DEPTH, 1.f, 0);
+                    release(view.depthSwapchain);
+
+                    depthInfo[i].subImage.swapchain = view.depthSwapchain;
+                    depthInfo[i].subImage.imageRect = imageRect;
+                    depthInfo[i].minDepth = 0.f;
+                    depthInfo[i].maxDepth = 1.f;
+                    depthInfo[i].nearZ = 0.1f;
+                    depthInfo[i].farZ = 100.f;
+                    projectionViews[i].next = &depthInfo[i];
+                }
+            }
+
+            XrCompositionLayerProjection layer{XR_TYPE_COMPOSITION_LAYER_PROJECTION};
+            layer.space = m_localSpace;
+            layer.viewCount = static_cast<uint32_t>(projectionViews.size());
+            layer.views = projectionViews.data();
+            const XrCompositionLayerBaseHeader* layers[] = {
+                reinterpret_cast<const XrCompositionLayerBaseHeader*>(&layer)};
+
+            XrFrameEndInfo endInfo{XR_TYPE_FRAME_END_INFO};
+            endInfo.displayTime = frameState.predictedDisplayTime;
+            endInfo.environmentBlendMode = XR_ENVIRONMENT_BLEND_MODE_OPAQUE;
+            endInfo.layerCount = frameState.shouldRender ? 1 : 0;
+            endInfo.layers = layers;
+            CHECK_XRCMD(timeCall(6, [&] { return m_xrEndFrame(m_session, &endInfo); }));
+        }
+
+        uint32_t acquireAndWait(XrSwapchain swapchain) {
+            uint32_t index;
+            CHECK_XRCMD(timeCall(3, [&] { return m_xrAcquireSwapchainImage(swapchain, nullptr, &index); }));
+            XrSwapchainImageWaitInfo waitInfo{XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO};
+            waitInfo.timeout = XR_INFINITE_DURATION;
+            CHECK_XRCMD(timeCall(4, [&] { return m_xrWaitSwapchainImage(swapchain, &waitInfo); }));
+            return index;
+        }
+
+        void release(XrSwapchain swapchain) {
+            CHECK_XRCMD(timeCall(5, [&] { return m_xrReleaseSwapchainImage(swapchain, nullptr); }));
+        }
+
+        // Record the time spent in a call into the statistics of m_results.calls at the given index.
+        template <typename Call>
+        XrResult timeCall(size_t index, Call&& call) {
+            const auto start = std::chrono::steady_clock::now();
+            const XrResult result = call();
+            if (m_recording) {
+                m_results.calls[index].samples.push_back(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start)
+                        .count());
+            }
+            return result;
+        }
+
+        static constexpr int64_t PreferredColorFormats[] = {DXGI_FORMAT_R8G8B8A8_UNORM_SRGB,
+                                                            DXGI_FORMAT_B8G8R8A8_UNORM_SRGB};
+
+        const LoadedLayer m_layer;
+        const SyntheticAppConfig m_config;
+        FrameSource* const m_frameSource;
+        SyntheticAppResults m_results;
+
+        ComPtr<ID3D11Device> m_device;
+        ComPtr<ID3D11DeviceContext> m_context;
+
+        XrInstance m_instance{XR_NULL_HANDLE};
+        XrSystemId m_systemId{XR_NULL_SYSTEM_ID};
+        XrSession m_session{XR_NULL_HANDLE};
+        XrSpace m_localSpace{XR_NULL_HANDLE};
+        XrViewConfigurationType m_viewConfigurationType{XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO};
+        bool m_useFoveatedRendering{false};
+        DXGI_FORMAT m_colorFormat{DXGI_FORMAT_UNKNOWN};
+        std::vector<View> m_views;
+
+        bool m_sessionRunning{false};
+        bool m_exitRequested{false};
+        bool m_recording{false};
+        std::optional<std::chrono::steady_clock::time_point> m_lastWaitFrame;
+
+        PFN_xrDestroyInstance m_xrDestroyInstance{nullptr};
+        PFN_xrPollEvent m_xrPollEvent{nullptr};
+        PFN_xrGetSystem m_xrGetSystem{nullptr};
+        PFN_xrGetSystemProperties m_xrGetSystemProperties{nullptr};
+        PFN_xrEnumerateViewConfigurationViews m_xrEnumerateViewConfigurationViews{nullptr};
+        PFN_xrCreateSession m_xrCreateSession{nullptr};
+        PFN_xrDestroySession m_xrDestroySession{nullptr};
+        PFN_xrBeginSession m_xrBeginSession{nullptr};
+        PFN_xrEndSession m_xrEndSession{nullptr};
+        PFN_xrRequestExitSession m_xrRequestExitSession{nullptr};
+        PFN_xrCreateReferenceSpace m_xrCreateReferenceSpace{nullptr};
+        PFN_xrDestroySpace m_xrDestroySpace{nullptr};
+        PFN_xrEnumerateSwapchainFormats m_xrEnumerateSwapchainFormats{nullptr};
+        PFN_xrCreateSwapchain m_xrCreateSwapchain{nullptr};
+        PFN_xrDestroySwapchain m_xrDestroySwapchain{nullptr};
+        PFN_xrEnumerateSwapchainImages m_xrEnumerateSwapchainImages{nullptr};
+        PFN_xrAcquireSwapchainImage m_xrAcquireSwapchainImage{nullptr};
+        PFN_xrWaitSwapchainImage m_xrWaitSwapchainImage{nullptr};
+        PFN_xrReleaseSwapchainImage m_xrReleaseSwapchainImage{nullptr};
+        PFN_xrLocateViews m_xrLocateViews{nullptr};
+        PFN_xrWaitFrame m_xrWaitFrame{nullptr};
+        PFN_xrBeginFrame m_xrBeginFrame{nullptr};
+        PFN_xrEndFrame m_xrEndFrame{nullptr};
+    };
+
+} // namespace
+
+namespace openxr_api_layer::benchmark {
+
+    LoadedLayer LoadLayer(const std::filesystem::path& path) {
+        LoadedLayer layer;
+        layer.module = LoadLibraryW(path.c_str());
+        if (!layer.module) {
+            throw std::runtime_error(fmt::format("Failed to load {}: {}", path.string(), GetLastError()));
+        }
+
+        const auto xrNegotiateLoaderApiLayerInterface = reinterpret_cast<PFN_xrNegotiateLoaderApiLayerInterface>(
+            GetProcAddress(layer.module, "xrNegotiateLoaderApiLayerInterface"));
+        if (!xrNegotiateLoaderApiLayerInterface) {
+            throw std::runtime_error("Not an API layer");
+        }
+
+        XrNegotiateLoaderInfo loaderInfo{XR_LOADER_INTERFACE_STRUCT_LOADER_INFO,
+                                         XR_LOADER_INFO_STRUCT_VERSION,
+                                         sizeof(XrNegotiateLoaderInfo)};
+        loaderInfo.minInterfaceVersion = 1;
+        loaderInfo.maxInterfaceVersion = XR_CURRENT_LOADER_API_LAYER_VERSION;
+        loaderInfo.minApiVersion = XR_MAKE_VERSION(1, 0, 0);
+        loaderInfo.maxApiVersion = XR_CURRENT_API_VERSION;
+
+        XrNegotiateApiLayerRequest apiLayerRequest{XR_LOADER_INTERFACE_STRUCT_API_LAYER_REQUEST,
+                                                   XR_API_LAYER_INFO_STRUCT_VERSION,
+                                                   sizeof(XrNegotiateApiLayerRequest)};
+        CHECK_XRCMD(xrNegotiateLoaderApiLayerInterface(&loaderInfo, LAYER_NAME, &apiLayerRequest));
+        layer.getInstanceProcAddr = apiLayerRequest.getInstanceProcAddr;
+        layer.createApiLayerInstance = apiLayerRequest.createApiLayerInstance;
+
+        return layer;
+    }
+
+    uint64_t LatencyStatistics::percentile(uint32_t rank) const {
+        if (samples.empty()) {
+            return 0;
+        }
+        std::vector<uint64_t> sorted(samples);
+        const size_t index = std::min(sorted.size() - 1, sorted.size() * rank / 100);
+        std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+        return sorted[index];
+    }
+
+    SyntheticAppResults RunSyntheticApp(const LoadedLayer& layer,
+                                        const SyntheticAppConfig& config,
+                                        FrameSource* frameSource) {
+        return SyntheticApp(layer, config, frameSource).run();
+    }
+
+} // namespace openxr_api_layer::benchmark
@@ -0,0 +1,93 @@
+// MIT License
+//
+// Copyright(c) 2021-2023 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+namespace openxr_api_layer::benchmark {
+
+    // The synthetic app drives a headless D3D11 frame loop through the layer, which sits on top of the mock runtime.
+    // It goes through the same negotiation and instance creation as the OpenXR loader would do.
+
+    // The entry points of the layer, as returned by xrNegotiateLoaderApiLayerInterface().
+    struct LoadedLayer {
+        HMODULE module{nullptr};
+        PFN_xrGetInstanceProcAddr getInstanceProcAddr{nullptr};
+        PFN_xrCreateApiLayerInstance createApiLayerInstance{nullptr};
+    };
+
+    LoadedLayer LoadLayer(const std::filesystem::path& path);
+
+    // Produces the content of the views. Without a frame source, the views are cleared.
+    struct FrameSource {
+        virtual ~FrameSource() = default;
+
+        // Called once the device is created and the resolution and color format of the views are known.
+        virtual void initialize(ID3D11Device* device,
+                                const std::vector<XrViewConfigurationView>& views,
+                                DXGI_FORMAT colorFormat) = 0;
+
+        // Called before the views of a frame are located.
+        virtual void beginFrame(uint32_t frameIndex) = 0;
+
+        // Fill the swapchain image of a view. The image rect is the entire texture.
+        virtual void renderView(uint32_t frameIndex,
+                                uint32_t viewIndex,
+                                const XrView& view,
+                                ID3D11DeviceContext* context,
+                                ID3D11Texture2D* texture,
+                                ID3D11RenderTargetView* renderTargetView) = 0;
+    };
+
+    struct SyntheticAppConfig {
+        bool useQuadViews{true};
+        bool useFoveatedRendering{true};
+        bool submitDepth{false};
+        bool useWarpDevice{false};
+        uint32_t frameCount{600};
+        // The first frames are not recorded in the statistics.
+        uint32_t warmUpFrameCount{90};
+    };
+
+    struct LatencyStatistics {
+        std::string name;
+        // In nanoseconds.
+        std::vector<uint64_t> samples;
+
+        uint64_t percentile(uint32_t rank) const;
+    };
+
+    struct SyntheticAppResults {
+        // The time spent in each OpenXR call, as seen by the app.
+        std::vector<LatencyStatistics> calls;
+        // The time between the returns of consecutive xrWaitFrame().
+        LatencyStatistics frameInterval;
+        uint32_t framesDiscarded{0};
+        std::vector<XrViewConfigurationView> views;
+    };
+
+    // Create an instance and a session through the layer, run the frame loop, then tear everything down. The mock
+    // runtime must be configured beforehand. Throws when any call fails.
+    SyntheticAppResults RunSyntheticApp(const LoadedLayer& layer,
+                                        const SyntheticAppConfig& config,
+                                        FrameSource* frameSource = nullptr);
+
+} // namespace openxr_api_layer::benchmark
@@ -36,8 +36,11 @@
 #include "views.h"
 
 #include <ProjectionVS.h>
+#include <ProjectionGS.h>
 #include <ProjectionPS.h>
+#include <DepthProjectionPS.h>
 #include <SharpeningCS.h>
+#include <SharpeningFP16CS.h>
 
 namespace openxr_api_layer {
 
@@ -53,10 +56,13 @@ namespace openxr_api_layer {
     const std::vector<std::string> blockedExtensions = {XR_VARJO_QUAD_VIEWS_EXTENSION_NAME,
                                                         XR_VARJO_FOVEATED_RENDERING_EXTENSION_NAME};
     const std::vector<std::string> implicitExtensions = {XR_EXT_EYE_GAZE_INTERACTION_EXTENSION_NAME,
-                                                         XR_FB_EYE_TRACKING_SOCIAL_EXTENSION_NAME};
+                                                         XR_FB_EYE_TRACKING_SOCIAL_EXTENSION_NAME,
+                                                         XR_KHR_WIN32_CONVERT_PERFORMANCE_COUNTER_TIME_EXTENSION_NAME};
 
+    // The projection constants hold the values for both eyes, indexed by view index.
     struct ProjectionVSConstants {
-        alignas(16) DirectX::XMFLOAT4X4 focusProjection;
+        alignas(16) DirectX::XMFLOAT4X4 focusProjection[xr::StereoView::Count];
+        alignas(16) DirectX::XMFLOAT4 stereoUVScaleBias[xr::StereoView::Count];
     };
 
     struct ProjectionPSConstants {
@@ -64,18 +70,81 @@ namespace openxr_api_layer {
         alignas(4) bool ignoreAlpha;
         alignas(4) bool isUnpremultipliedAlpha;
         alignas(4) bool debugFocusView;
+        alignas(4) float sharpeningPeak;
+        alignas(4) bool peripheralUpscaling;
+        alignas(4) bool focusLayer;
+        alignas(16) DirectX::XMFLOAT4 focusUVScaleBias[xr::StereoView::Count];
+        alignas(16) DirectX::XMFLOAT4 stereoUVClamp[xr::StereoView::Count];
+        alignas(16) DirectX::XMFLOAT4 focusUVClamp[xr::StereoView::Count];
+        alignas(16) DirectX::XMFLOAT4 focusTexelSize[xr::StereoView::Count];
+        alignas(16) DirectX::XMFLOAT4 stereoTexelSize[xr::StereoView::Count];
     };
 
     struct SharpeningCSConstants {
         alignas(4) uint32_t Const0[4];
         alignas(4) uint32_t Const1[4];
+        alignas(4) int32_t InputRect[4];
     };
 
+    // Compute the scale (xy) and bias (zw) to map normalized texture coordinates onto the image rect of a texture.
+    template <typename TextureDesc>
+    static DirectX::XMFLOAT4 GetUVScaleBias(const XrRect2Di& imageRect, const TextureDesc& desc) {
+        return {(float)imageRect.extent.width / desc.Width,
+                (float)imageRect.extent.height / desc.Height,
+                (float)imageRect.offset.x / desc.Width,
+                (float)imageRect.offset.y / desc.Height};
+    }
+
+    // Compute the min (xy) and max (zw) texture coordinates to sample within the image rect of a texture without
+    // filtering texels outside of the image rect.
+    template <typename TextureDesc>
+    static DirectX::XMFLOAT4 GetUVClamp(const XrRect2Di& imageRect, const TextureDesc& desc) {
+        return {(imageRect.offset.x + 0.5f) / desc.Width,
+                (imageRect.offset.y + 0.5f) / desc.Height,
+                (imageRect.offset.x + imageRect.extent.width - 0.5f) / desc.Width,
+                (imageRect.offset.y + imageRect.extent.height - 0.5f) / desc.Height};
+    }
+
+    // Depth formats must be reinterpreted as color formats for sampling.
+    static DXGI_FORMAT GetDepthShaderResourceFormat(DXGI_FORMAT format) {
+        switch (format) {
+        case DXGI_FORMAT_D32_FLOAT:
+            return DXGI_FORMAT_R32_FLOAT;
+        case DXGI_FORMAT_D32_FLOAT_S8X24_UINT:
+            return DXGI_FORMAT_R32_FLOAT_X8X24_TYPELESS;
+        case DXGI_FORMAT_D24_UNORM_S8_UINT:
+            return DXGI_FORMAT_R24_UNORM_X8_TYPELESS;
+        case DXGI_FORMAT_D16_UNORM:
+            return DXGI_FORMAT_R16_UNORM;
+        default:
+            return format;
+        }
+    }
+
+    static D3D12_RESOURCE_BARRIER GetTransitionBarrier(ID3D12Resource* resource,
+                                                       D3D12_RESOURCE_STATES stateBefore,
+                                                       D3D12_RESOURCE_STATES stateAfter) {
+        D3D12_RESOURCE_BARRIER barrier{};
+        barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+        barrier.Transition.pResource = resource;
+        barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+        barrier.Transition.StateBefore = stateBefore;
+        barrier.Transition.StateAfter = stateAfter;
+        return barrier;
+    }
+
     // This class implements our API layer.
     class OpenXrLayer : public openxr_api_layer::OpenXrApi {
       public:
         OpenXrLayer() = default;
-        ~OpenXrLayer() = default;
+        ~OpenXrLayer() {
+            stopAsyncWaitThread();
+            stopEyeTrackingThread();
+            stopConfigurationWatcher();
+            if (m_compositionWarmUpThread.joinable()) {
+                m_compositionWarmUpThread.join();
+            }
+        }
 
         // https://www.khronos.org/registry/OpenXR/specs/1.0/html/xrspec.html#xrGetInstanceProcAddr
         XrResult xrGetInstanceProcAddr(XrInstance instance, const char* name, PFN_xrVoidFunction* function) override {
@@ -139,8 +208,12 @@ namespace openxr_api_layer {
                     m_requestedFoveatedRendering = true;
                 } else if (ext == XR_KHR_COMPOSITION_LAYER_DEPTH_EXTENSION_NAME) {
                     m_requestedDepthSubmission = true;
+                } else if (ext == XR_KHR_VISIBILITY_MASK_EXTENSION_NAME) {
+                    m_requestedVisibilityMask = true;
                 } else if (ext == XR_KHR_D3D11_ENABLE_EXTENSION_NAME) {
                     m_requestedD3D11 = true;
+                } else if (ext == XR_KHR_D3D12_ENABLE_EXTENSION_NAME) {
+                    m_requestedD3D12 = true;
                 }
             }
 
@@ -148,8 +221,8 @@ namespace openxr_api_layer {
                 m_requestedFoveatedRendering = false;
             }
 
-            // We only support D3D11 at the moment.
-            m_bypassApiLayer = !m_requestedD3D11;
+            // We only support D3D11 and D3D12 at the moment.
+            m_bypassApiLayer = !m_requestedD3D11 && !m_requestedD3D12;
             if (m_bypassApiLayer) {
                 Log(fmt::format("{} layer will be bypassed\n", LayerName));
                 return XR_SUCCESS;
@@ -166,11 +239,16 @@ namespace openxr_api_layer {
             TraceLoggingWrite(g_traceProvider, "xrCreateInstance", TLArg(runtimeName.c_str(), "RuntimeName"));
             Log(fmt::format("Using OpenXR runtime: {}\n", runtimeName));
 
-            // Platform-specific quirks.
-            m_needDeferredSwapchainReleaseQuirk = runtimeName.find("Varjo") != std::string::npos;
+            // Needed to timestamp the gaze samples taken outside of the frame loop.
+            const auto& grantedExtensions = GetGrantedExtensions();
+            m_hasPerformanceCounterTime =
+                std::find(grantedExtensions.cbegin(),
+                          grantedExtensions.cend(),
+                          XR_KHR_WIN32_CONVERT_PERFORMANCE_COUNTER_TIME_EXTENSION_NAME) != grantedExtensions.cend();
 
-            // Game-specific quirks.
-            m_needFocusFovCorrectionQuirk = GetApplicationName() == "DCS World" || GetApplicationName() == "DCS";
+            // Platform-specific quirks. The game-specific quirks are in the per-application sections of the
+            // configuration file.
+            m_needDeferredSwapchainReleaseQuirk = runtimeName.find("Varjo") != std::string::npos;
 
             return XR_SUCCESS;
         }
@@ -212,12 +290,21 @@ namespace openxr_api_layer {
                     LoadConfiguration(dllHome / "settings.cfg");
                     LoadConfiguration(localAppData / "settings.cfg");
                     m_useFovTangent = m_fovTangentX != 1.f || m_fovTangentY != 1.f;
+                    if (m_useHotReload) {
+                        startConfigurationWatcher();
+                    }
 
                     if (m_needDeferredSwapchainReleaseQuirk && m_useTurboMode) {
                         Log("Denying Turbo Mode due to deferred swapchain release!\n");
                         m_useTurboMode = false;
                     }
 
+                    // The visibility mask events would not be expected by the application.
+                    if (!m_requestedVisibilityMask && m_useFocusVisibilityMask) {
+                        Log("Denying focus visibility mask since the application does not use visibility masks\n");
+                        m_useFocusVisibilityMask = false;
+                    }
+
                     TraceLoggingWrite(g_traceProvider,
                                       "xrGetSystem",
                                       TLArg(m_peripheralPixelDensity, "PeripheralResolutionFactor"),
@@ -237,9 +324,29 @@ namespace openxr_api_layer {
                                       TLArg(m_forceNoEyeTracking, "ForceNoEyeTracking"),
                                       TLArg(m_smoothenFocusViewEdges, "SmoothenEdges"),
                                       TLArg(m_sharpenFocusView, "SharpenFocusView"),
+                                      TLArg(m_useFusedSharpening, "FusedSharpening"),
+                                      TLArg(m_useAdaptiveSharpening, "AdaptiveSharpening"),
+                                      TLArg(m_usePeripheralUpscaling, "PeripheralUpscaling"),
+                                      TLArg(m_useFocusLayer, "FocusLayer"),
+                                      TLArg(m_useDepthComposition, "DepthComposition"),
+                                      TLArg(m_depthCompositionScale, "DepthCompositionScale"),
+                                      TLArg(m_useFocusVisibilityMask, "FocusVisibilityMask"),
+                                      TLArg(m_useEyeGazePrediction, "EyeGazePrediction"),
+                                      TLArg(m_eyeGazePredictionLatency, "EyeGazePredictionLatency"),
+                                      TLArg(m_useEyeTrackingThread, "EyeTrackingThread"),
+                                      TLArg(m_eyeTrackingThreadRate, "EyeTrackingThreadRate"),
+                                      TLArg(m_useFrameStatistics, "FrameStatistics"),
+                                      TLArg(m_frameStatisticsInterval.count(), "FrameStatisticsInterval"),
+                                      TLArg(m_useAsyncComposition, "AsyncComposition"),
+                                      TLArg(m_useDynamicResolution, "DynamicResolution"),
+                                      TLArg(m_dynamicResolutionMinScale, "DynamicResolutionMinScale"),
+                                      TLArg(m_dynamicResolutionCompositionBudget, "DynamicResolutionCompositionBudget"),
                                       TLArg(m_fovTangentX, "FovTangentX"),
                                       TLArg(m_fovTangentY, "FovTangentY"),
-                                      TLArg(m_useTurboMode, "TurboMode"));
+                                      TLArg(m_useTurboMode, "TurboMode"),
+                                      TLArg(m_usePreacquireOutput, "PreacquireOutput"),
+                                      TLArg(m_useStereoViewCache, "StereoViewCache"),
+                                      TLArg(m_useHotReload, "HotReload"));
 
                     m_trackerType = Tracker::None;
                     if (m_requestedQuadViews) {
@@ -482,6 +589,15 @@ namespace openxr_api_layer {
                                 std::min(AlignTo<2>((uint32_t)newHeight), views[i].maxImageRectHeight);
                         }
 
+                        if (viewConfigurationType == XR_VIEW_CONFIGURATION_TYPE_PRIMARY_QUAD_VARJO) {
+                            m_recommendedFocusResolution.width =
+                                std::max(m_recommendedFocusResolution.width,
+                                         (int32_t)views[xr::QuadView::FocusLeft].recommendedImageRectWidth);
+                            m_recommendedFocusResolution.height =
+                                std::max(m_recommendedFocusResolution.height,
+                                         (int32_t)views[xr::QuadView::FocusLeft].recommendedImageRectHeight);
+                        }
+
                         if (!m_loggedResolution) {
                             if (viewConfigurationType == XR_VIEW_CONFIGURATION_TYPE_PRIMARY_QUAD_VARJO) {
                                 Log(fmt::format("Recommended peripheral resolution: {}x{} ({:.3f}x density)\n",
@@ -654,7 +770,32 @@ namespace openxr_api_layer {
                               TLArg((int)createInfo->systemId, "SystemId"),
                               TLArg(createInfo->createFlags, "CreateFlags"));
 
-            const XrResult result = OpenXrApi::xrCreateSession(instance, createInfo, session);
+            XrSessionCreateInfo chainCreateInfo = *createInfo;
+            XrGraphicsBindingD3D12KHR chainD3D12Bindings{};
+            if (isSystemHandled(createInfo->systemId) && m_useAsyncComposition &&
+                (m_requestedQuadViews || m_useFovTangent)) {
+                // In async composition mode, the runtime synchronizes with the composition queue instead of the
+                // application queue, so that only the consumption of the output images waits for the composition.
+                const XrBaseInStructure* const entry = reinterpret_cast<const XrBaseInStructure*>(createInfo->next);
+                if (m_requestedD3D12 && entry && entry->type == XR_TYPE_GRAPHICS_BINDING_D3D12_KHR) {
+                    chainD3D12Bindings = *reinterpret_cast<const XrGraphicsBindingD3D12KHR*>(entry);
+                    initializeAsyncCompositionQueue(chainD3D12Bindings.device);
+                    chainD3D12Bindings.queue = m_d3d12CompositionQueue.Get();
+                    chainCreateInfo.next = &chainD3D12Bindings;
+                    Log("Async composition: Enabled\n");
+                } else if (m_requestedD3D12) {
+                    Log("Async composition: Disabled (the graphics bindings must come first in the chain)\n");
+                } else {
+                    Log("Async composition: Not supported with D3D11\n");
+                }
+            }
+
+            const XrResult result = OpenXrApi::xrCreateSession(instance, &chainCreateInfo, session);
+
+            if (XR_FAILED(result)) {
+                m_d3d12CompositionQueue.Reset();
+                m_d3d12ApplicationFence.Reset();
+            }
 
             if (XR_SUCCEEDED(result)) {
                 TraceLoggingWrite(g_traceProvider, "xrCreateSession", TLXArg(*session, "Session"));
@@ -669,10 +810,21 @@ namespace openxr_api_layer {
                             initializeDeviceContext(d3dBindings->device);
                             m_isSupportedGraphicsApi = true;
                             break;
+                        } else if (m_requestedD3D12 && entry->type == XR_TYPE_GRAPHICS_BINDING_D3D12_KHR) {
+                            const XrGraphicsBindingD3D12KHR* d3dBindings =
+                                reinterpret_cast<const XrGraphicsBindingD3D12KHR*>(entry);
+                            initializeDeviceContext(d3dBindings->device, d3dBindings->queue);
+                            m_isSupportedGraphicsApi = true;
+                            break;
                         }
                         entry = entry->next;
                     }
 
+                    // Compile the composition shaders in the background while the application is loading.
+                    if (m_isSupportedGraphicsApi && (m_requestedQuadViews || m_useFovTangent)) {
+                        startCompositionWarmUp(*session);
+                    }
+
                     // Initialize the resources for the eye tracker.
                     if (m_trackerType != Tracker::None) {
                         switch (m_trackerType) {
@@ -684,12 +836,22 @@ namespace openxr_api_layer {
                             initializeEyeGazeInteraction(*session);
                             break;
                         }
+                    }
 
+                    // The eye tracker is located relative to the head, and the head motion drives the adaptive
+                    // sharpening.
+                    if (m_trackerType != Tracker::None || m_useAdaptiveSharpening) {
                         XrReferenceSpaceCreateInfo spaceCreateInfo{XR_TYPE_REFERENCE_SPACE_CREATE_INFO};
                         spaceCreateInfo.referenceSpaceType = XR_REFERENCE_SPACE_TYPE_VIEW;
                         spaceCreateInfo.poseInReferenceSpace = Pose::Identity();
                         CHECK_XRCMD(OpenXrApi::xrCreateReferenceSpace(*session, &spaceCreateInfo, &m_viewSpace));
                     }
+                    if (m_useAdaptiveSharpening) {
+                        XrReferenceSpaceCreateInfo spaceCreateInfo{XR_TYPE_REFERENCE_SPACE_CREATE_INFO};
+                        spaceCreateInfo.referenceSpaceType = XR_REFERENCE_SPACE_TYPE_LOCAL;
+                        spaceCreateInfo.poseInReferenceSpace = Pose::Identity();
+                        CHECK_XRCMD(OpenXrApi::xrCreateReferenceSpace(*session, &spaceCreateInfo, &m_localSpace));
+                    }
 
                     m_needPollEvent = m_needAttachActionSets = m_needSyncActions = true;
 
@@ -705,14 +867,23 @@ namespace openxr_api_layer {
             TraceLoggingWrite(g_traceProvider, "xrDestroySession", TLXArg(session, "Session"));
 
             // Wait for deferred frames to finish before teardown.
-            if (isSessionHandled(session) && m_asyncWaitPromise.valid()) {
+            if (isSessionHandled(session) && m_asyncWaitPending) {
                 TraceLocalActivity(local);
 
                 TraceLoggingWriteStart(local, "xrDestroySession_AsyncWaitNow");
-                m_asyncWaitPromise.wait_for(5s);
+                waitForAsyncWaitFrame(5s);
                 TraceLoggingWriteStop(local, "xrDestroySession_AsyncWaitNow");
 
-                m_asyncWaitPromise = {};
+                m_asyncWaitPending = false;
+            }
+            if (isSessionHandled(session)) {
+                stopAsyncWaitThread();
+                stopEyeTrackingThread();
+            }
+
+            if (isSessionHandled(session)) {
+                waitForCompositionWarmUp();
+                waitForD3D12Composition(m_d3d12CompositionFenceValue);
             }
 
             const XrResult result = OpenXrApi::xrDestroySession(session);
@@ -721,19 +892,41 @@ namespace openxr_api_layer {
                 if (isSessionHandled(session)) {
                     for (uint32_t i = 0; i < std::size(m_compositionTimer); i++) {
                         m_compositionTimer[i].reset();
+                        m_sharpeningTimer[i].reset();
+                        m_projectionTimer[i].reset();
+                        m_sharpeningTimerStarted[i] = false;
                     }
                     for (uint32_t i = 0; i < std::size(m_appFrameGpuTimer); i++) {
                         m_appFrameGpuTimer[i].reset();
                     }
                     m_appFrameCpuTimer.reset();
                     m_appRenderCpuTimer.reset();
+                    if (m_useFrameStatistics) {
+                        logFrameStatistics();
+                    }
+                    m_appCpuTimeStats.reset();
+                    m_appRenderCpuTimeStats.reset();
+                    m_appGpuTimeStats.reset();
+                    m_compositionGpuTimeStats.reset();
+                    m_sharpeningGpuTimeStats.reset();
+                    m_projectionGpuTimeStats.reset();
+                    m_waitFrameTimeStats.reset();
+                    m_outputWaitTimeStats.reset();
+                    m_waitFrameOverheadStats.reset();
+                    m_locateViewsOverheadStats.reset();
+                    m_endFrameOverheadStats.reset();
+                    m_acquireSwapchainImageOverheadStats.reset();
+                    m_releaseSwapchainImageOverheadStats.reset();
                     m_layerContextState.Reset();
                     m_linearClampSampler.Reset();
                     m_noDepthRasterizer.Reset();
                     m_projectionVSConstants.Reset();
                     m_projectionPSConstants.Reset();
                     m_projectionVS.Reset();
+                    m_projectionGS.Reset();
                     m_projectionPS.Reset();
+                    m_depthWriteState.Reset();
+                    m_depthProjectionPS.Reset();
                     m_sharpeningCSConstants.Reset();
                     m_sharpeningCS.Reset();
                     m_blankTexture.Reset();
@@ -742,8 +935,36 @@ namespace openxr_api_layer {
                     m_applicationDevice.Reset();
                     m_renderContext.Reset();
 
+                    m_d3d12ProjectionRootSignature.Reset();
+                    m_d3d12ProjectionPSO.clear();
+                    m_d3d12DepthProjectionPSO.clear();
+                    m_d3d12SharpeningRootSignature.Reset();
+                    m_d3d12SharpeningPSO.Reset();
+                    m_d3d12ConstantsBuffer.Reset();
+                    m_d3d12MappedConstants = nullptr;
+                    m_d3d12ResourceHeap.Reset();
+                    m_d3d12TimestampQueryHeap.Reset();
+                    m_d3d12TimestampReadback.Reset();
+                    m_d3d12BlankTexture.Reset();
+                    m_d3d12SrvBlankTexture.Reset();
+                    for (uint32_t i = 0; i < std::size(m_d3d12CompositionContext); i++) {
+                        m_d3d12CompositionContext[i] = {};
+                    }
+                    m_d3d12CompositionFence.reset();
+                    m_d3d12CompositionQueue.Reset();
+                    m_d3d12ApplicationFence.Reset();
+                    m_d3d12ApplicationDevice.Reset();
+                    m_d3d12ApplicationQueue.Reset();
+
                     m_gazeSpaces.clear();
-                    m_swapchains.clear();
+                    clearSwapchains();
+                    // The pooled swapchains were destroyed along with the session.
+                    {
+                        std::unique_lock lock(m_swapchainPoolMutex);
+                        m_swapchainPool.clear();
+                        m_swapchainPoolFrame = 0;
+                    }
+                    m_sharpenedImages.reset();
 
                     m_session = XR_NULL_HANDLE;
                 }
@@ -803,15 +1024,44 @@ namespace openxr_api_layer {
                             Log("Edge smoothing: Disabled\n");
                         }
                         if (m_sharpenFocusView) {
-                            Log(fmt::format("Sharpening: {:.2f}\n", m_sharpenFocusView));
+                            Log(fmt::format("Sharpening: {:.2f}{}{}\n",
+                                            m_sharpenFocusView,
+                                            m_useFusedSharpening ? " (fused)" : "",
+                                            m_useAdaptiveSharpening ? " (adaptive)" : ""));
                         } else {
                             Log("Sharpening: Disabled\n");
                         }
+                        Log(fmt::format("Peripheral upscaling: {}\n", m_usePeripheralUpscaling ? "EASU" : "Bilinear"));
+                        if (m_useDepthComposition) {
+                            Log(fmt::format("Depth composition: {:.2f}\n", m_depthCompositionScale));
+                        } else {
+                            Log("Depth composition: Disabled\n");
+                        }
+                        if (m_useDynamicResolution) {
+                            Log(fmt::format("Dynamic resolution (composition only): {:.0f}% budget, down to {:.2f}x\n",
+                                            m_dynamicResolutionCompositionBudget * 100,
+                                            m_dynamicResolutionMinScale));
+                        } else {
+                            Log("Dynamic resolution: Disabled\n");
+                        }
                         Log(fmt::format("Turbo: {}\n", m_useTurboMode ? "Enabled" : "Disabled"));
+                        Log(fmt::format("Output pre-acquire: {}\n", m_usePreacquireOutput ? "Enabled" : "Disabled"));
+                        if (m_trackerType != Tracker::None && m_useEyeTrackingThread) {
+                            if (m_hasPerformanceCounterTime) {
+                                Log(fmt::format("Eye tracking thread: {} Hz\n", m_eyeTrackingThreadRate));
+                                m_eyeTrackingLatestSample.reset();
+                                startEyeTrackingThread();
+                            } else {
+                                Log("Eye tracking thread: Not supported\n");
+                            }
+                        }
+
+                        preallocateCompositionResources(session);
                     }
 
                     m_lastGoodEyeTrackingData = std::chrono::steady_clock::now();
                     m_lastGoodEyeGaze.reset();
+                    m_eyeGazeSampleCount = 0;
                     m_loggedEyeTrackingWarning = false;
                     m_framesElapsed = 0;
 
@@ -898,6 +1148,8 @@ namespace openxr_api_layer {
                               TLXArg(viewLocateInfo->space, "Space"),
                               TLArg(viewCapacityInput, "ViewCapacityInput"));
 
+            LayerOverheadScope overhead(m_locateViewsOverheadStats, m_useFrameStatistics);
+
             XrResult result = XR_ERROR_RUNTIME_FAILURE;
             if (isSessionHandled(session)) {
                 if ((m_useQuadViews &&
@@ -914,12 +1166,14 @@ namespace openxr_api_layer {
 
                     if (viewCapacityInput) {
                         if (viewCapacityInput >= viewCount) {
-                            result = OpenXrApi::xrLocateViews(session,
-                                                              &chainViewLocateInfo,
-                                                              viewState,
-                                                              xr::StereoView::Count,
-                                                              viewCountOutput,
-                                                              views);
+                            result = overhead.chain([&] {
+                                return OpenXrApi::xrLocateViews(session,
+                                                                &chainViewLocateInfo,
+                                                                viewState,
+                                                                xr::StereoView::Count,
+                                                                viewCountOutput,
+                                                                views);
+                            });
                         } else {
                             result = XR_ERROR_SIZE_INSUFFICIENT;
                         }
@@ -935,6 +1189,12 @@ namespace openxr_api_layer {
 
                             if (viewState->viewStateFlags &
                                 (XR_VIEW_STATE_POSITION_VALID_BIT | XR_VIEW_STATE_ORIENTATION_VALID_BIT)) {
+                                std::shared_lock settingsLock(m_liveSettingsMutex);
+
+                                if (m_needRefreshStereoView) {
+                                    refreshStereoView(session, viewLocateInfo->displayTime, views);
+                                }
+
                                 // Override default to specify whether foveated rendering is desired when the
                                 // application does not specify.
                                 bool foveatedRenderingActive =
@@ -966,6 +1226,30 @@ namespace openxr_api_layer {
                                         viewLocateInfo->displayTime, false /* getStateOnly */, gazeUnitVector);
                                 }
 
+                                // Project the gaze for both eyes at once. The precomputed projection is only valid
+                                // for the FOV it was computed from.
+                                XrVector2f projectedGaze[xr::StereoView::Count]{};
+                                bool isProjectedGazeValid[xr::StereoView::Count]{};
+                                if (isGazeValid) {
+                                    if (isSameFov(views[xr::StereoView::Left].fov,
+                                                  m_stereoProjection.fov[xr::StereoView::Left],
+                                                  0.f) &&
+                                        isSameFov(views[xr::StereoView::Right].fov,
+                                                  m_stereoProjection.fov[xr::StereoView::Right],
+                                                  0.f)) {
+                                        ProjectPoint(
+                                            m_stereoProjection, gazeUnitVector, projectedGaze, isProjectedGazeValid);
+                                    } else {
+                                        for (uint32_t eye = 0; eye < xr::StereoView::Count; eye++) {
+                                            XrView viewForGazeProjection{};
+                                            viewForGazeProjection.pose = m_cachedEyePoses[eye];
+                                            viewForGazeProjection.fov = views[eye].fov;
+                                            isProjectedGazeValid[eye] =
+                                                ProjectPoint(viewForGazeProjection, gazeUnitVector, projectedGaze[eye]);
+                                        }
+                                    }
+                                }
+
                                 // Set up the focus view or FOV tangent.
                                 for (uint32_t i = viewLocateInfo->viewConfigurationType ==
                                                           XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO
@@ -980,12 +1264,7 @@ namespace openxr_api_layer {
 
                                     views[i].pose = views[stereoViewIndex].pose;
 
-                                    XrView viewForGazeProjection{};
-                                    viewForGazeProjection.pose = m_cachedEyePoses[stereoViewIndex];
-                                    viewForGazeProjection.fov = views[stereoViewIndex].fov;
-                                    XrVector2f projectedGaze;
-                                    if (!isGazeValid ||
-                                        !ProjectPoint(viewForGazeProjection, gazeUnitVector, projectedGaze)) {
+                                    if (!isProjectedGazeValid[stereoViewIndex]) {
                                         views[i].fov = viewLocateInfo->viewConfigurationType ==
                                                                XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO
                                                            ? m_cachedEyeFov[xr::StereoView::Count + i]
@@ -998,8 +1277,9 @@ namespace openxr_api_layer {
                                         TraceLoggingWrite(g_traceProvider,
                                                           "xrLocateViews",
                                                           TLArg(i, "ViewIndex"),
-                                                          TLArg(xr::ToString(projectedGaze).c_str(), "ProjectedGaze"));
-                                        m_eyeGaze[stereoViewIndex] = projectedGaze;
+                                                          TLArg(xr::ToString(projectedGaze[stereoViewIndex]).c_str(),
+                                                                "ProjectedGaze"));
+                                        m_eyeGaze[stereoViewIndex] = projectedGaze[stereoViewIndex];
                                         m_eyeGaze[stereoViewIndex] = m_eyeGaze[stereoViewIndex] +
                                                                      XrVector2f{stereoViewIndex == xr::StereoView::Left
                                                                                     ? -m_horizontalFocusOffset
@@ -1027,39 +1307,49 @@ namespace openxr_api_layer {
                                                           TLArg(xr::ToString(min).c_str(), "FocusTopLeft"),
                                                           TLArg(xr::ToString(max).c_str(), "FocusBottomRight"));
                                         views[i].fov =
-                                            xr::math::ComputeBoundingFov(m_cachedEyeFov[stereoViewIndex], min, max);
+                                            ComputeBoundingFov(m_stereoProjection, stereoViewIndex, min, max);
                                     }
                                 }
 
+                                if (m_useFocusVisibilityMask && viewLocateInfo->viewConfigurationType ==
+                                                                    XR_VIEW_CONFIGURATION_TYPE_PRIMARY_QUAD_VARJO) {
+                                    updateFocusVisibilityMask(views[xr::QuadView::FocusLeft].fov,
+                                                              views[xr::QuadView::FocusRight].fov,
+                                                              !foveatedRenderingActive);
+                                }
+
                                 // Quirk for DCS World: the application does not pass the correct FOV for the focus
                                 // views in xrEndFrame(). We must keep track of the correct values for each frame.
                                 if (m_useQuadViews && m_needFocusFovCorrectionQuirk) {
                                     TraceLocalActivity(local);
                                     TraceLoggingWriteStart(local, "xrLocateViews_StoreFovForQuirk");
-                                    std::unique_lock lock(m_focusFovMutex);
-
-                                    m_focusFovForDisplayTime.insert_or_assign(
-                                        viewLocateInfo->displayTime,
-                                        std::make_pair(views[xr::QuadView::FocusLeft].fov,
-                                                       views[xr::QuadView::FocusRight].fov));
+                                    storeFocusFovForQuirk(viewLocateInfo->displayTime,
+                                                          views[xr::QuadView::FocusLeft].fov,
+                                                          views[xr::QuadView::FocusRight].fov);
                                     TraceLoggingWriteStop(local, "xrLocateViews_StoreFovForQuirk");
                                 }
                             }
                         }
                     } else {
-                        result = OpenXrApi::xrLocateViews(
-                            session, &chainViewLocateInfo, viewState, 0, viewCountOutput, nullptr);
+                        result = overhead.chain([&] {
+                            return OpenXrApi::xrLocateViews(
+                                session, &chainViewLocateInfo, viewState, 0, viewCountOutput, nullptr);
+                        });
                         if (XR_SUCCEEDED(result)) {
                             *viewCountOutput = viewCount;
                         }
                     }
                 } else {
-                    result = OpenXrApi::xrLocateViews(
-                        session, viewLocateInfo, viewState, viewCapacityInput, viewCountOutput, views);
+                    result = overhead.chain([&] {
+                        return OpenXrApi::xrLocateViews(
+                            session, viewLocateInfo, viewState, viewCapacityInput, viewCountOutput, views);
+                    });
                 }
             } else {
-                result = OpenXrApi::xrLocateViews(
-                    session, viewLocateInfo, viewState, viewCapacityInput, viewCountOutput, views);
+                result = overhead.chain([&] {
+                    return OpenXrApi::xrLocateViews(
+                        session, viewLocateInfo, viewState, viewCapacityInput, viewCountOutput, views);
+                });
             }
 
             if (XR_SUCCEEDED(result)) {
@@ -1100,16 +1390,36 @@ namespace openxr_api_layer {
                               TLArg(createInfo->sampleCount, "SampleCount"),
                               TLArg(createInfo->usageFlags, "UsageFlags"));
 
-            const XrResult result = OpenXrApi::xrCreateSwapchain(session, createInfo, swapchain);
+            XrSwapchainCreateInfo chainCreateInfo = *createInfo;
+            if (isSessionHandled(session) &&
+                (!(createInfo->usageFlags & XR_SWAPCHAIN_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT) ||
+                 m_useDepthComposition)) {
+                // We will sample the application's images directly during composition.
+                chainCreateInfo.usageFlags |= XR_SWAPCHAIN_USAGE_SAMPLED_BIT;
+            }
+
+            const XrResult result = OpenXrApi::xrCreateSwapchain(session, &chainCreateInfo, swapchain);
 
             if (XR_SUCCEEDED(result)) {
                 TraceLoggingWrite(g_traceProvider, "xrCreateSwapchain", TLXArg(*swapchain, "Swapchain"));
 
                 if (isSessionHandled(session)) {
-                    std::unique_lock lock(m_swapchainsMutex);
-                    Swapchain newEntry{};
-                    newEntry.createInfo = *createInfo;
-                    m_swapchains.insert_or_assign(*swapchain, std::move(newEntry));
+                    auto newEntry = std::make_unique<Swapchain>();
+                    newEntry->createInfo = chainCreateInfo;
+                    CHECK_XRCMD(OpenXrApi::xrEnumerateSwapchainImages(*swapchain, 0, &newEntry->imageCount, nullptr));
+                    newEntry->compositionFenceValues = std::make_unique<std::atomic<uint64_t>[]>(newEntry->imageCount);
+                    newEntry->acquiredIndex = std::make_unique<uint32_t[]>(newEntry->imageCount);
+                    if (!insertSwapchain(*swapchain, std::move(newEntry))) {
+                        ErrorLog(fmt::format("xrCreateSwapchain: Exceeded {} swapchains\n", MaxSwapchains));
+                        OpenXrApi::xrDestroySwapchain(*swapchain);
+                        *swapchain = XR_NULL_HANDLE;
+                        return XR_ERROR_LIMIT_REACHED;
+                    }
+
+                    // Swapchains created after the session began are not covered by xrBeginSession().
+                    if (m_useQuadViews) {
+                        reservePooledSwapchain(session, chainCreateInfo);
+                    }
                 }
             }
 
@@ -1124,30 +1434,23 @@ namespace openxr_api_layer {
             {
                 std::unique_lock lock(m_frameMutex);
 
-                if (m_asyncWaitPromise.valid()) {
+                if (m_asyncWaitPending) {
                     TraceLocalActivity(local);
 
                     TraceLoggingWriteStart(local, "xrDestroySwapchain_AsyncWaitNow");
-                    m_asyncWaitPromise.wait();
+                    waitForAsyncWaitFrame();
                     TraceLoggingWriteStop(local, "xrDestroySwapchain_AsyncWaitNow");
                 }
             }
 
+            // With D3D12, make sure there is no pending composition that may reference the swapchain images.
+            waitForD3D12Composition(m_d3d12CompositionFenceValue);
+
             const XrResult result = OpenXrApi::xrDestroySwapchain(swapchain);
 
             if (XR_SUCCEEDED(result)) {
-                std::unique_lock lock(m_swapchainsMutex);
-
-                auto it = m_swapchains.find(swapchain);
-                if (it != m_swapchains.end()) {
-                    Swapchain& entry = it->second;
-                    for (uint32_t i = 0; i < xr::StereoView::Count; i++) {
-                        if (entry.fullFovSwapchain[i] != XR_NULL_HANDLE) {
-                            OpenXrApi::xrDestroySwapchain(entry.fullFovSwapchain[i]);
-                        }
-                    }
-                    m_swapchains.erase(it);
-                }
+                // Destroying the entry releases all its persistent views. The pooled output swapchains are kept.
+                removeSwapchain(swapchain);
             }
 
             return result;
@@ -1159,33 +1462,39 @@ namespace openxr_api_layer {
                                          uint32_t* index) override {
             TraceLoggingWrite(g_traceProvider, "xrAcquireSwapchainImage", TLXArg(swapchain, "Swapchain"));
 
-            if ((m_useQuadViews || m_useFovTangent) && m_needDeferredSwapchainReleaseQuirk) {
-                std::unique_lock lock(m_swapchainsMutex);
+            LayerOverheadScope overhead(m_acquireSwapchainImageOverheadStats, m_useFrameStatistics);
 
-                auto it = m_swapchains.find(swapchain);
-                if (it != m_swapchains.end()) {
-                    if (it->second.deferredRelease) {
-                        // Release the previous image before acquiring a new one.
-                        TraceLoggingWrite(g_traceProvider,
-                                          "xrAcquireSwapchainImage_DeferredSwapchainRelease",
-                                          TLXArg(swapchain, "Swapchain"));
-                        CHECK_XRCMD(OpenXrApi::xrReleaseSwapchainImage(swapchain, nullptr));
-                        it->second.deferredRelease = false;
+            Swapchain* const entry = findSwapchain(swapchain);
+            if ((m_useQuadViews || m_useFovTangent) && m_needDeferredSwapchainReleaseQuirk && entry) {
+                if (entry->deferredRelease.exchange(false)) {
+                    // Release the previous image before acquiring a new one.
+                    TraceLoggingWrite(g_traceProvider,
+                                      "xrAcquireSwapchainImage_DeferredSwapchainRelease",
+                                      TLXArg(swapchain, "Swapchain"));
+                    if (m_d3d12CompositionQueue) {
+                        synchronizeCompositionQueue();
                     }
+                    CHECK_XRCMD(
+                        overhead.chain([&] { return OpenXrApi::xrReleaseSwapchainImage(swapchain, nullptr); }));
                 }
             }
 
-            const XrResult result = OpenXrApi::xrAcquireSwapchainImage(swapchain, acquireInfo, index);
+            // All the images are already acquired, there is no room left to track another one.
+            if (entry && entry->isAcquiredIndexRingFull()) {
+                return XR_ERROR_CALL_ORDER_INVALID;
+            }
+
+            const XrResult result =
+                overhead.chain([&] { return OpenXrApi::xrAcquireSwapchainImage(swapchain, acquireInfo, index); });
 
             if (XR_SUCCEEDED(result)) {
                 TraceLoggingWrite(g_traceProvider, "xrAcquireSwapchainImage", TLArg(*index, "Index"));
 
-                std::unique_lock lock(m_swapchainsMutex);
-
-                auto it = m_swapchains.find(swapchain);
-                if (it != m_swapchains.end()) {
-                    Swapchain& entry = it->second;
-                    entry.acquiredIndex.push_back(*index);
+                if (entry) {
+                    entry->pushAcquiredIndex(*index);
+                    if (m_d3d12CompositionQueue) {
+                        waitForCompositionOfImage(*entry, *index);
+                    }
                 }
             }
 
@@ -1197,34 +1506,28 @@ namespace openxr_api_layer {
                                          const XrSwapchainImageReleaseInfo* releaseInfo) override {
             TraceLoggingWrite(g_traceProvider, "xrReleaseSwapchainImage", TLXArg(swapchain, "Swapchain"));
 
-            bool deferRelease = false;
-            if ((m_useQuadViews || m_useFovTangent) && m_needDeferredSwapchainReleaseQuirk) {
-                std::unique_lock lock(m_swapchainsMutex);
+            LayerOverheadScope overhead(m_releaseSwapchainImageOverheadStats, m_useFrameStatistics);
 
-                auto it = m_swapchains.find(swapchain);
-                if (it != m_swapchains.end()) {
-                    // Defer release to ensure that xrEndFrame() can sample the image written by the application.
-                    deferRelease = it->second.deferredRelease = true;
-                }
+            Swapchain* const entry = findSwapchain(swapchain);
+            bool deferRelease = false;
+            if ((m_useQuadViews || m_useFovTangent) && m_needDeferredSwapchainReleaseQuirk && entry) {
+                // Defer release to ensure that xrEndFrame() can sample the image written by the application.
+                entry->deferredRelease = deferRelease = true;
             }
 
             XrResult result = XR_ERROR_RUNTIME_FAILURE;
             if (!deferRelease) {
-                result = OpenXrApi::xrReleaseSwapchainImage(swapchain, releaseInfo);
+                if (m_d3d12CompositionQueue && entry) {
+                    synchronizeCompositionQueue();
+                }
+                result = overhead.chain([&] { return OpenXrApi::xrReleaseSwapchainImage(swapchain, releaseInfo); });
             } else {
                 TraceLoggingWrite(g_traceProvider, "xrReleaseSwapchainImage_Defer");
                 result = XR_SUCCESS;
             }
 
-            if (XR_SUCCEEDED(result)) {
-                std::unique_lock lock(m_swapchainsMutex);
-
-                auto it = m_swapchains.find(swapchain);
-                if (it != m_swapchains.end()) {
-                    Swapchain& entry = it->second;
-                    entry.lastReleasedIndex = entry.acquiredIndex.front();
-                    entry.acquiredIndex.pop_front();
-                }
+            if (XR_SUCCEEDED(result) && entry) {
+                entry->popAcquiredIndex();
             }
 
             return result;
@@ -1236,49 +1539,67 @@ namespace openxr_api_layer {
                              XrFrameState* frameState) override {
             TraceLoggingWrite(g_traceProvider, "xrWaitFrame", TLXArg(session, "Session"));
 
+            LayerOverheadScope overhead(m_waitFrameOverheadStats, m_useFrameStatistics);
+
             XrResult result = XR_ERROR_RUNTIME_FAILURE;
 
             if (isSessionHandled(session)) {
-                const auto lastFrameWaitTimestamp = m_lastFrameWaitTimestamp;
-                m_lastFrameWaitTimestamp = std::chrono::steady_clock::now();
-
                 {
                     std::unique_lock lock(m_frameMutex);
 
                     // Roundup frame statistics.
-                    if (IsTraceEnabled() && m_appFrameCpuTimer) {
+                    if (isFrameTimingEnabled() && m_appFrameCpuTimer) {
                         m_appFrameCpuTimer->stop();
+                        const uint64_t appCpuTime = m_appFrameCpuTimer->query();
 
                         TraceLoggingWrite(g_traceProvider,
                                           "AppStatistics",
-                                          TLArg(m_frameTimes.size(), "Fps"),
-                                          TLArg(m_appFrameCpuTimer->query(), "AppCpuTime"),
+                                          TLArg(m_fps, "Fps"),
+                                          TLArg(appCpuTime, "AppCpuTime"),
                                           TLArg(m_lastAppRenderCpuTime, "RenderCpuTime"),
                                           TLArg(m_lastAppFrameGpuTime, "AppGpuTime"));
+
+                        if (m_useFrameStatistics) {
+                            m_appCpuTimeStats.add(appCpuTime);
+                        }
                     }
 
-                    if (m_asyncWaitPromise.valid()) {
+                    if (m_asyncWaitPending) {
                         TraceLoggingWrite(g_traceProvider, "xrWaitFrame_AsyncWaitMode");
 
-                        // In Turbo mode, we accept pipelining of exactly one frame.
+                        // In Turbo mode, we accept pipelining of exactly one frame. This cannot be any deeper: the
+                        // runtime's next xrWaitFrame() does not return before the xrBeginFrame() of the frame it
+                        // follows, which we only issue once the application submits that frame.
+                        uint64_t waitTime = 0;
                         if (m_asyncWaitPolled) {
                             TraceLocalActivity(local);
 
                             // On second frame poll, we must wait.
                             TraceLoggingWriteStart(local, "xrWaitFrame_AsyncWaitNow");
-                            m_asyncWaitPromise.wait();
+                            const auto waitStart = std::chrono::steady_clock::now();
+                            overhead.chain([&] { waitForAsyncWaitFrame(); });
+                            waitTime = std::chrono::duration_cast<std::chrono::microseconds>(
+                                           std::chrono::steady_clock::now() - waitStart)
+                                           .count();
                             TraceLoggingWriteStop(local, "xrWaitFrame_AsyncWaitNow");
+                        } else {
+                            m_turboPipelinedFrames++;
                         }
                         m_asyncWaitPolled = true;
+                        m_turboFrames++;
+
+                        if (m_useFrameStatistics) {
+                            m_waitFrameTimeStats.add(waitTime);
+                        }
 
-                        // In Turbo mode, we don't actually wait, we make up a predicted time.
+                        // In Turbo mode, we don't actually wait, we make up a predicted time. The pending wait is
+                        // for the next display period, so we use the runtime's period to predict it.
                         {
                             std::unique_lock lock(m_asyncWaitMutex);
 
                             frameState->predictedDisplayTime =
                                 m_asyncWaitCompleted ? m_lastPredictedDisplayTime
-                                                     : (m_lastPredictedDisplayTime +
-                                                        (m_lastFrameWaitTimestamp - lastFrameWaitTimestamp).count());
+                                                     : (m_lastPredictedDisplayTime + m_lastPredictedDisplayPeriod);
                             frameState->predictedDisplayPeriod = m_lastPredictedDisplayPeriod;
                         }
                         frameState->shouldRender = m_lastShouldRender ? XR_TRUE : XR_FALSE;
@@ -1287,14 +1608,22 @@ namespace openxr_api_layer {
 
                     } else {
                         lock.unlock();
+                        const auto waitStart = std::chrono::steady_clock::now();
                         {
                             TraceLocalActivity(local);
                             TraceLoggingWriteStart(local, "xrWaitFrame_WaitFrame");
-                            result = OpenXrApi::xrWaitFrame(session, frameWaitInfo, frameState);
+                            result = overhead.chain(
+                                [&] { return OpenXrApi::xrWaitFrame(session, frameWaitInfo, frameState); });
                             TraceLoggingWriteStop(local, "xrWaitFrame_WaitFrame");
                         }
+                        const auto waitEnd = std::chrono::steady_clock::now();
                         lock.lock();
 
+                        if (m_useFrameStatistics) {
+                            m_waitFrameTimeStats.add(
+                                std::chrono::duration_cast<std::chrono::microseconds>(waitEnd - waitStart).count());
+                        }
+
                         if (XR_SUCCEEDED(result)) {
                             // We must always store those values to properly handle transitions into Turbo Mode.
                             m_lastPredictedDisplayTime = frameState->predictedDisplayTime;
@@ -1304,7 +1633,7 @@ namespace openxr_api_layer {
                     }
                 }
             } else {
-                result = OpenXrApi::xrWaitFrame(session, frameWaitInfo, frameState);
+                result = overhead.chain([&] { return OpenXrApi::xrWaitFrame(session, frameWaitInfo, frameState); });
             }
 
             if (XR_SUCCEEDED(result)) {
@@ -1325,7 +1654,7 @@ namespace openxr_api_layer {
                     {
                         std::unique_lock lock(m_frameMutex);
 
-                        if (IsTraceEnabled() && m_appFrameCpuTimer) {
+                        if (isFrameTimingEnabled() && m_appFrameCpuTimer) {
                             m_appFrameCpuTimer->start();
                         }
                     }
@@ -1343,7 +1672,7 @@ namespace openxr_api_layer {
             if (isSessionHandled(session)) {
                 std::unique_lock lock(m_frameMutex);
 
-                if (m_asyncWaitPromise.valid()) {
+                if (m_asyncWaitPending) {
                     // In turbo mode, we do nothing here.
                     TraceLoggingWrite(g_traceProvider, "xrBeginFrame_AsyncWaitMode");
                     result = XR_SUCCESS;
@@ -1359,6 +1688,11 @@ namespace openxr_api_layer {
 
             if (XR_SUCCEEDED(result)) {
                 if (isSessionHandled(session)) {
+                    // Apply the settings edited while the application is running, in between frames.
+                    if (m_configurationChanged.exchange(false)) {
+                        reloadConfiguration();
+                    }
+
                     if (m_useQuadViews && m_trackerType == Tracker::EyeGazeInteraction) {
                         // Give the app 100 frames to tell us what it intends to do regarding the action system.
                         if (m_framesElapsed > 100) {
@@ -1412,7 +1746,7 @@ namespace openxr_api_layer {
                     {
                         std::unique_lock lock(m_frameMutex);
 
-                        if (IsTraceEnabled() && m_appFrameCpuTimer) {
+                        if (isFrameTimingEnabled() && m_appFrameCpuTimer) {
                             m_appRenderCpuTimer->start();
                             m_appFrameGpuTimer[m_appFrameGpuTimerIndex]->start();
                         }
@@ -1435,11 +1769,15 @@ namespace openxr_api_layer {
                               TLArg(frameEndInfo->displayTime, "DisplayTime"),
                               TLArg(xr::ToCString(frameEndInfo->environmentBlendMode), "EnvironmentBlendMode"));
 
+            LayerOverheadScope overhead(m_endFrameOverheadStats, m_useFrameStatistics);
+
             if (isSessionHandled(session)) {
+                // The debug keys and the dynamic resolution modify the live options.
+                std::unique_lock settingsLock(m_liveSettingsMutex);
                 std::unique_lock lock(m_frameMutex);
 
                 // Stop app timers.
-                if (IsTraceEnabled() && m_appFrameCpuTimer) {
+                if (isFrameTimingEnabled() && m_appFrameCpuTimer) {
                     m_appRenderCpuTimer->stop();
                     m_lastAppRenderCpuTime = m_appRenderCpuTimer->query();
 
@@ -1447,34 +1785,65 @@ namespace openxr_api_layer {
                     m_appFrameGpuTimerIndex = (m_appFrameGpuTimerIndex + 1) % std::size(m_appFrameGpuTimer);
                     // Latency is 3 frames.
                     m_lastAppFrameGpuTime = m_appFrameGpuTimer[m_appFrameGpuTimerIndex]->query();
+
+                    if (m_useFrameStatistics) {
+                        m_appRenderCpuTimeStats.add(m_lastAppRenderCpuTime);
+                        m_appGpuTimeStats.add(m_lastAppFrameGpuTime);
+                        m_compositionGpuTimeStats.add(m_lastCompositionGpuTime);
+                        if (m_lastSharpeningGpuTime) {
+                            m_sharpeningGpuTimeStats.add(*m_lastSharpeningGpuTime);
+                        }
+                        m_projectionGpuTimeStats.add(m_lastProjectionGpuTime);
+                        m_outputWaitTimeStats.add(m_outputWaitTime);
+                    }
                 }
 
                 const auto now = std::chrono::steady_clock::now();
-                m_frameTimes.push_back(now);
-                while ((now - m_frameTimes.front()).count() >= 1'000'000'000) {
-                    m_frameTimes.pop_front();
+                m_framesInFpsWindow++;
+                if ((now - m_fpsWindowStart).count() >= 1'000'000'000) {
+                    m_fps = m_framesInFpsWindow;
+                    m_framesInFpsWindow = 0;
+                    m_fpsWindowStart = now;
+                }
+
+                if (m_useDynamicResolution) {
+                    updateDynamicResolution();
+                }
+
+                if (m_useFrameStatistics && (now - m_lastFrameStatisticsLog) >= m_frameStatisticsInterval) {
+                    logFrameStatistics();
+                    m_lastFrameStatisticsLog = now;
                 }
 
                 handleDebugKeys();
             }
 
-            // We will allocate structures to pass to the real xrEndFrame().
-            std::vector<XrCompositionLayerProjection> projectionAllocator;
-            std::vector<std::array<XrCompositionLayerProjectionView, xr::StereoView::Count>> projectionViewAllocator;
-            std::vector<const XrCompositionLayerBaseHeader*> layers;
-
-            // Ensure pointers within the collections remain stable.
-            projectionAllocator.reserve(frameEndInfo->layerCount);
-            projectionViewAllocator.reserve(frameEndInfo->layerCount);
+            // We will use the frame arena to store the structures passed to the real xrEndFrame().
+            auto& projectionAllocator = m_frameArena.projections;
+            auto& projectionViewAllocator = m_frameArena.projectionViews;
+            auto& depthInfoAllocator = m_frameArena.depthInfos;
+            auto& layers = m_frameArena.layers;
+            auto& swapchainsToRelease = m_frameArena.swapchainsToRelease;
+            m_frameArena.reset();
+
+            // Ensure pointers within the collections remain stable. The focus layer composition mode submits two
+            // projection layers for each projection layer of the application.
+            const uint32_t maxLayerCount = frameEndInfo->layerCount * (m_useFocusLayer ? 2 : 1);
+            projectionAllocator.reserve(maxLayerCount);
+            projectionViewAllocator.reserve(maxLayerCount);
+            depthInfoAllocator.reserve(maxLayerCount * xr::StereoView::Count);
+            layers.reserve(maxLayerCount);
 
             XrFrameEndInfo chainFrameEndInfo = *frameEndInfo;
 
             XrResult result = XR_ERROR_RUNTIME_FAILURE;
             if (isSessionHandled(session)) {
                 if (m_useQuadViews || m_useFovTangent) {
+                    std::shared_lock settingsLock(m_liveSettingsMutex);
+
                     // Save the application context state.
                     ComPtr<ID3DDeviceContextState> applicationContextState;
-                    {
+                    if (m_renderContext) {
                         TraceLocalActivity(local);
                         TraceLoggingWriteStart(local, "xrEndFrame_SwapDeviceContextState");
                         m_renderContext->SwapDeviceContextState(m_layerContextState.Get(),
@@ -1485,13 +1854,17 @@ namespace openxr_api_layer {
 
                     // Restore the application context state upon leaving this scope.
                     auto scopeGuard = MakeScopeGuard([&] {
-                        TraceLocalActivity(local);
-                        TraceLoggingWriteStart(local, "xrEndFrame_SwapDeviceContextState");
-                        m_renderContext->SwapDeviceContextState(applicationContextState.Get(), nullptr);
-                        TraceLoggingWriteStop(local, "xrEndFrame_SwapDeviceContextState");
+                        if (m_renderContext) {
+                            TraceLocalActivity(local);
+                            TraceLoggingWriteStart(local, "xrEndFrame_SwapDeviceContextState");
+                            m_renderContext->SwapDeviceContextState(applicationContextState.Get(), nullptr);
+                            TraceLoggingWriteStop(local, "xrEndFrame_SwapDeviceContextState");
+                        }
                     });
 
-                    std::set<XrSwapchain> swapchainsToRelease;
+                    beginSwapchainPoolFrame();
+                    updateSharpeningStrength(frameEndInfo->displayTime);
+                    m_outputWaitTime = 0;
 
                     for (uint32_t i = 0; i < frameEndInfo->layerCount; i++) {
                         if (!frameEndInfo->layers[i]) {
@@ -1515,6 +1888,9 @@ namespace openxr_api_layer {
                             projectionViewAllocator.push_back(
                                 {proj->views[xr::StereoView::Left], proj->views[xr::StereoView::Right]});
 
+                            XrCompositionLayerProjectionView focusViews[xr::StereoView::Count];
+                            Swapchain* swapchainsForStereoView[xr::StereoView::Count];
+                            Swapchain* swapchainsForFocusView[xr::StereoView::Count];
                             for (uint32_t viewIndex = 0; viewIndex < xr::StereoView::Count; viewIndex++) {
                                 if (m_useQuadViews) {
                                     for (uint32_t i = viewIndex; i < xr::QuadView::Count; i += xr::StereoView::Count) {
@@ -1534,77 +1910,114 @@ namespace openxr_api_layer {
                                 const uint32_t focusViewIndex =
                                     m_useQuadViews ? (viewIndex + xr::StereoView::Count) : viewIndex;
 
-                                std::unique_lock lock(m_swapchainsMutex);
-
-                                const auto it = m_swapchains.find(proj->views[viewIndex].subImage.swapchain);
-                                const auto it2 = m_swapchains.find(proj->views[focusViewIndex].subImage.swapchain);
-                                if (it == m_swapchains.end() || it2 == m_swapchains.end()) {
+                                swapchainsForStereoView[viewIndex] =
+                                    findSwapchain(proj->views[viewIndex].subImage.swapchain);
+                                swapchainsForFocusView[viewIndex] =
+                                    findSwapchain(proj->views[focusViewIndex].subImage.swapchain);
+                                if (!swapchainsForStereoView[viewIndex] || !swapchainsForFocusView[viewIndex]) {
                                     return XR_ERROR_HANDLE_INVALID;
                                 }
 
-                                Swapchain& swapchainForStereoView = it->second;
-                                Swapchain& swapchainForFocusView = it2->second;
-
-                                if (swapchainForStereoView.deferredRelease) {
-                                    swapchainsToRelease.insert(proj->views[viewIndex].subImage.swapchain);
-                                    swapchainForStereoView.deferredRelease = false;
-                                }
-                                if (swapchainForFocusView.deferredRelease) {
-                                    swapchainsToRelease.insert(proj->views[focusViewIndex].subImage.swapchain);
-                                    swapchainForFocusView.deferredRelease = false;
+                                if (swapchainsForStereoView[viewIndex]->deferredRelease.exchange(false)) {
+                                    m_frameArena.markForRelease(proj->views[viewIndex].subImage.swapchain);
                                 }
-
-                                // Allocate a destination swapchain.
-                                if (swapchainForStereoView.fullFovSwapchain[viewIndex] == XR_NULL_HANDLE) {
-                                    XrSwapchainCreateInfo createInfo = swapchainForStereoView.createInfo;
-                                    createInfo.arraySize = 1;
-                                    createInfo.width = m_fullFovResolution.width;
-                                    createInfo.height = m_fullFovResolution.height;
-                                    // We will use a Pixel Shader for rendering into this swapchain.
-                                    createInfo.usageFlags |= XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT;
-                                    TraceLoggingWrite(g_traceProvider,
-                                                      "xrEndFrame_CreateSwapchain",
-                                                      TLArg(m_fullFovResolution.width, "Width"),
-                                                      TLArg(m_fullFovResolution.height, "Height"));
-                                    CHECK_XRCMD(OpenXrApi::xrCreateSwapchain(
-                                        session, &createInfo, &swapchainForStereoView.fullFovSwapchain[viewIndex]));
+                                if (swapchainsForFocusView[viewIndex]->deferredRelease.exchange(false)) {
+                                    m_frameArena.markForRelease(proj->views[focusViewIndex].subImage.swapchain);
                                 }
 
-                                XrCompositionLayerProjectionView focusView = proj->views[focusViewIndex];
+                                focusViews[viewIndex] = proj->views[focusViewIndex];
                                 if (m_useQuadViews && m_needFocusFovCorrectionQuirk) {
                                     // Quirk for DCS World: the application does not pass the correct FOV for the
                                     // focus views in xrEndFrame(). We must keep track of the correct values for
                                     // each frame.
                                     TraceLocalActivity(local);
                                     TraceLoggingWriteStart(local, "xrEndFrame_LookupFovForQuirk");
-                                    std::unique_lock lock(m_focusFovMutex);
-
-                                    bool found = false;
-                                    const auto& cit = m_focusFovForDisplayTime.find(frameEndInfo->displayTime);
-                                    if (cit != m_focusFovForDisplayTime.cend()) {
-                                        focusView.fov = focusViewIndex == xr::QuadView::FocusLeft ? cit->second.first
-                                                                                                  : cit->second.second;
-                                        found = true;
+                                    XrFovf focusFov[xr::StereoView::Count];
+                                    const bool found = lookupFocusFovForQuirk(frameEndInfo->displayTime, focusFov);
+                                    if (found) {
+                                        focusViews[viewIndex].fov = focusFov[viewIndex];
                                     }
                                     TraceLoggingWriteStop(local, "xrEndFrame_LookupFovForQuirk", TLArg(found, "Found"));
                                 }
+                            }
+
+                            // With the focus layer composition mode, the application's stereo views are submitted
+                            // untouched and only the focus views are composited, into a swapchain on top.
+                            const bool useFocusLayer = m_useFocusLayer && m_useQuadViews;
+
+                            // Pick a destination swapchain with one array slice per eye.
+                            const XrSwapchainCreateInfo& outputCreateInfo =
+                                swapchainsForStereoView[xr::StereoView::Left]->createInfo;
+                            PooledSwapchain& output =
+                                useFocusLayer ? acquireFocusLayerSwapchain(session, outputCreateInfo, focusViews)
+                                              : acquirePooledSwapchain(session,
+                                                                       getFullFovSwapchainCreateInfo(outputCreateInfo),
+                                                                       m_fullFovRenderResolution);
+
+                            // The depth of the focus views is composited along with the color when the application
+                            // submits depth for all views. With the focus layer composition mode, the depth of the
+                            // stereo views already matches the submitted stereo views.
+                            const XrCompositionLayerDepthInfoKHR* depthInfos[xr::QuadView::Count]{};
+                            Swapchain* swapchainsForDepth[xr::QuadView::Count]{};
+                            const bool useDepthComposition =
+                                m_useDepthComposition && m_useQuadViews && !useFocusLayer &&
+                                getDepthInfosForComposition(proj, depthInfos, swapchainsForDepth);
+                            PooledSwapchain* const depthOutput =
+                                useDepthComposition
+                                    ? &acquirePooledSwapchain(
+                                          session,
+                                          getFullFovSwapchainCreateInfo(
+                                              swapchainsForDepth[xr::StereoView::Left]->createInfo),
+                                          getDepthCompositionExtent(m_fullFovRenderResolution))
+                                    : nullptr;
+
+                            // Composite the focus views and the stereo views together into a single stereo view.
+                            if (m_applicationDevice) {
+                                compositeViewContentD3D11(proj->views,
+                                                          swapchainsForStereoView,
+                                                          focusViews,
+                                                          swapchainsForFocusView,
+                                                          proj->layerFlags,
+                                                          useFocusLayer,
+                                                          output,
+                                                          useDepthComposition ? depthInfos : nullptr,
+                                                          swapchainsForDepth,
+                                                          depthOutput);
+                            } else {
+                                compositeViewContentD3D12(proj->views,
+                                                          swapchainsForStereoView,
+                                                          focusViews,
+                                                          swapchainsForFocusView,
+                                                          proj->layerFlags,
+                                                          useFocusLayer,
+                                                          output,
+                                                          useDepthComposition ? depthInfos : nullptr,
+                                                          swapchainsForDepth,
+                                                          depthOutput);
+                            }
 
-                                // Composite the focus view and the stereo view together into a single stereo view.
-                                compositeViewContent(viewIndex,
-                                                     proj->views[viewIndex],
-                                                     swapchainForStereoView,
-                                                     focusView,
-                                                     swapchainForFocusView,
-                                                     proj->layerFlags);
-
-                                // Patch the view to reference the new swapchain at full FOV.
-                                XrCompositionLayerProjectionView& patchedView =
-                                    projectionViewAllocator.back()[viewIndex];
-                                patchedView.fov = m_cachedEyeFov[viewIndex];
-                                patchedView.subImage.swapchain = swapchainForStereoView.fullFovSwapchain[viewIndex];
-                                patchedView.subImage.imageArrayIndex = 0;
-                                patchedView.subImage.imageRect.offset = {0, 0};
-                                patchedView.subImage.imageRect.extent = m_fullFovResolution;
+                            for (uint32_t viewIndex = 0; viewIndex < xr::StereoView::Count; viewIndex++) {
+                                if (!useFocusLayer) {
+                                    // Patch the view to reference the new swapchain at full FOV.
+                                    XrCompositionLayerProjectionView& patchedView =
+                                        projectionViewAllocator.back()[viewIndex];
+                                    patchedView.fov = m_cachedEyeFov[viewIndex];
+                                    patchedView.subImage.swapchain = output.handle;
+                                    patchedView.subImage.imageArrayIndex = viewIndex;
+                                    patchedView.subImage.imageRect.offset = {0, 0};
+                                    patchedView.subImage.imageRect.extent = m_fullFovRenderResolution;
+
+                                    if (useDepthComposition) {
+                                        // Other structures chained before the depth info are not forwarded.
+                                        XrCompositionLayerDepthInfoKHR& patchedDepthInfo =
+                                            depthInfoAllocator.emplace_back(*depthInfos[viewIndex]);
+                                        patchedDepthInfo.subImage.swapchain = depthOutput->handle;
+                                        patchedDepthInfo.subImage.imageArrayIndex = viewIndex;
+                                        patchedDepthInfo.subImage.imageRect.offset = {0, 0};
+                                        patchedDepthInfo.subImage.imageRect.extent = depthOutput->extent;
+                                        patchedView.next = &patchedDepthInfo;
+                                    }
+                                }
 
                                 if (m_requestedDepthSubmission && m_needDeferredSwapchainReleaseQuirk) {
                                     const XrBaseInStructure* entry =
@@ -1627,16 +2040,14 @@ namespace openxr_api_layer {
                                                 TLArg(depth->minDepth, "MinDepth"),
                                                 TLArg(depth->maxDepth, "MaxDepth"));
 
-                                            const auto it = m_swapchains.find(depth->subImage.swapchain);
-                                            if (it == m_swapchains.end()) {
+                                            Swapchain* const swapchainForDepthInfo =
+                                                findSwapchain(depth->subImage.swapchain);
+                                            if (!swapchainForDepthInfo) {
                                                 return XR_ERROR_HANDLE_INVALID;
                                             }
 
-                                            Swapchain& swapchainForDepthInfo = it->second;
-
-                                            if (swapchainForDepthInfo.deferredRelease) {
-                                                swapchainsToRelease.insert(depth->subImage.swapchain);
-                                                swapchainForDepthInfo.deferredRelease = false;
+                                            if (swapchainForDepthInfo->deferredRelease.exchange(false)) {
+                                                m_frameArena.markForRelease(depth->subImage.swapchain);
                                             }
                                         }
                                         entry = entry->next;
@@ -1644,30 +2055,58 @@ namespace openxr_api_layer {
                                 }
                             }
 
-                            // Note: if a depth buffer was attached, we will use it as-is (per copy of the proj
-                            // struct below, and therefore its entire chain of next structs). This is good: we will
-                            // submit a depth that matches the composited view, but that is lower resolution.
+                            // Note: without depth composition, if a depth buffer was attached, we will use it as-is
+                            // (per copy of the proj struct below, and therefore its entire chain of next structs).
+                            // This is good: we will submit a depth that matches the composited view, but that is
+                            // lower resolution.
 
                             projectionAllocator.push_back(*proj);
-                            // Our shader always premultiplies the alpha channel.
-                            projectionAllocator.back().layerFlags &= ~XR_COMPOSITION_LAYER_UNPREMULTIPLIED_ALPHA_BIT;
+                            if (!useFocusLayer) {
+                                // Our shader always premultiplies the alpha channel.
+                                projectionAllocator.back().layerFlags &=
+                                    ~XR_COMPOSITION_LAYER_UNPREMULTIPLIED_ALPHA_BIT;
+                            }
                             projectionAllocator.back().views = projectionViewAllocator.back().data();
                             projectionAllocator.back().viewCount = xr::StereoView::Count;
                             layers.push_back(
                                 reinterpret_cast<XrCompositionLayerBaseHeader*>(&projectionAllocator.back()));
 
+                            if (useFocusLayer) {
+                                // The focus layer is blended over the stereo views using the alpha written by our
+                                // shader, which fades the edges.
+                                projectionViewAllocator.push_back({focusViews[xr::StereoView::Left],
+                                                                   focusViews[xr::StereoView::Right]});
+                                for (uint32_t viewIndex = 0; viewIndex < xr::StereoView::Count; viewIndex++) {
+                                    XrCompositionLayerProjectionView& patchedView =
+                                        projectionViewAllocator.back()[viewIndex];
+                                    // The depth of the focus view does not match the composited image.
+                                    patchedView.next = nullptr;
+                                    patchedView.subImage.swapchain = output.handle;
+                                    patchedView.subImage.imageArrayIndex = viewIndex;
+                                    patchedView.subImage.imageRect.offset = {0, 0};
+                                    patchedView.subImage.imageRect.extent = output.extent;
+                                }
+
+                                projectionAllocator.push_back(*proj);
+                                projectionAllocator.back().next = nullptr;
+                                projectionAllocator.back().layerFlags =
+                                    (proj->layerFlags & ~XR_COMPOSITION_LAYER_UNPREMULTIPLIED_ALPHA_BIT) |
+                                    XR_COMPOSITION_LAYER_BLEND_TEXTURE_SOURCE_ALPHA_BIT;
+                                projectionAllocator.back().views = projectionViewAllocator.back().data();
+                                projectionAllocator.back().viewCount = xr::StereoView::Count;
+                                layers.push_back(
+                                    reinterpret_cast<XrCompositionLayerBaseHeader*>(&projectionAllocator.back()));
+                            }
+
                         } else {
                             if (m_needDeferredSwapchainReleaseQuirk) {
                                 if (frameEndInfo->layers[i]->type == XR_TYPE_COMPOSITION_LAYER_QUAD) {
                                     const XrCompositionLayerQuad* quad =
                                         reinterpret_cast<const XrCompositionLayerQuad*>(frameEndInfo->layers[i]);
 
-                                    std::unique_lock lock(m_swapchainsMutex);
-
-                                    const auto it = m_swapchains.find(quad->subImage.swapchain);
-                                    if (it != m_swapchains.end() && it->second.deferredRelease) {
-                                        swapchainsToRelease.insert(quad->subImage.swapchain);
-                                        it->second.deferredRelease = false;
+                                    Swapchain* const swapchainForQuad = findSwapchain(quad->subImage.swapchain);
+                                    if (swapchainForQuad && swapchainForQuad->deferredRelease.exchange(false)) {
+                                        m_frameArena.markForRelease(quad->subImage.swapchain);
                                     }
                                 }
                                 // TODO: We need to handle all other types of composition layers in order to mark
@@ -1685,27 +2124,16 @@ namespace openxr_api_layer {
                     chainFrameEndInfo.layers = layers.data();
                     chainFrameEndInfo.layerCount = (uint32_t)layers.size();
 
-                    if (m_needFocusFovCorrectionQuirk) {
-                        TraceLocalActivity(local);
-                        TraceLoggingWriteStart(local, "xrEndFrame_AgeFovForQuirk");
-                        std::unique_lock lock(m_focusFovMutex);
-
-                        // Delete all entries older than 1s.
-                        while (!m_focusFovForDisplayTime.empty() &&
-                               m_focusFovForDisplayTime.cbegin()->first < frameEndInfo->displayTime - 1'000'000'000) {
-                            m_focusFovForDisplayTime.erase(m_focusFovForDisplayTime.begin());
-                        }
-                        TraceLoggingWriteStop(local,
-                                              "xrEndFrame_AgeFovForQuirk",
-                                              TLArg(m_focusFovForDisplayTime.size(), "DictionarySize"));
-                    }
-
                     // Perform deferred swapchains release now.
                     for (auto swapchain : swapchainsToRelease) {
                         TraceLoggingWrite(
                             g_traceProvider, "xrEndFrame_DeferredSwapchainRelease", TLXArg(swapchain, "Swapchain"));
 
-                        CHECK_XRCMD(OpenXrApi::xrReleaseSwapchainImage(swapchain, nullptr));
+                        if (m_d3d12CompositionQueue) {
+                            synchronizeCompositionQueue();
+                        }
+                        CHECK_XRCMD(
+                            overhead.chain([&] { return OpenXrApi::xrReleaseSwapchainImage(swapchain, nullptr); }));
                     }
                 }
 
@@ -1713,7 +2141,7 @@ namespace openxr_api_layer {
                     std::unique_lock lock(m_frameMutex);
 
                     result = XR_SUCCESS;
-                    if (m_asyncWaitPromise.valid()) {
+                    if (m_asyncWaitPending) {
                         {
                             TraceLocalActivity(local);
 
@@ -1725,17 +2153,17 @@ namespace openxr_api_layer {
                             // pretty solution, but it is simple and it seems to work effectively (minus the 1s
                             // freeze observed in-game).
                             TraceLoggingWriteStart(local, "xrEndFrame_AsyncWaitNow");
-                            const auto ready = m_asyncWaitPromise.wait_for(1s) == std::future_status::ready;
+                            const auto ready = overhead.chain([&] { return waitForAsyncWaitFrame(1s); });
                             TraceLoggingWriteStop(local, "xrEndFrame_AsyncWaitNow", TLArg(ready, "Ready"));
                             if (ready) {
-                                m_asyncWaitPromise = {};
+                                m_asyncWaitPending = false;
                             }
                         }
 
                         {
                             TraceLocalActivity(local);
                             TraceLoggingWriteStart(local, "xrEndFrame_BeginFrame");
-                            result = OpenXrApi::xrBeginFrame(session, nullptr);
+                            result = overhead.chain([&] { return OpenXrApi::xrBeginFrame(session, nullptr); });
                             // Passthrough errors (eg: XR_ERROR_SESSION_NOT_RUNNING) in case the session state
                             // machine advanced.
                             if (XR_FAILED(result)) {
@@ -1750,46 +2178,28 @@ namespace openxr_api_layer {
                     if (XR_SUCCEEDED(result)) {
                         TraceLocalActivity(local);
                         TraceLoggingWriteStart(local, "xrEndFrame_EndFrame");
-                        result = OpenXrApi::xrEndFrame(session, &chainFrameEndInfo);
+                        result = overhead.chain([&] { return OpenXrApi::xrEndFrame(session, &chainFrameEndInfo); });
                         TraceLoggingWriteStop(local, "xrEndFrame_EndFrame");
                     }
 
                     if (XR_SUCCEEDED(result)) {
-                        if (m_useTurboMode && !m_asyncWaitPromise.valid()) {
+                        if (m_usePreacquireOutput && (m_useQuadViews || m_useFovTangent)) {
+                            overhead.chain([&] { preacquireOutputSwapchainImages(); });
+                        }
+
+                        if (m_useTurboMode && !m_asyncWaitPending) {
                             m_asyncWaitPolled = false;
-                            m_asyncWaitCompleted = false;
 
-                            // In Turbo mode, we kick off a wait thread immediately.
+                            // In Turbo mode, we kick off the next wait immediately.
                             TraceLoggingWrite(g_traceProvider, "xrEndFrame_AsyncWaitStart");
-                            m_asyncWaitPromise = std::async(std::launch::async, [&, session] {
-                                TraceLocalActivity(local);
-
-                                XrFrameState frameState{XR_TYPE_FRAME_STATE};
-                                TraceLoggingWriteStart(local, "AsyncWaitFrame");
-                                CHECK_XRCMD(OpenXrApi::xrWaitFrame(session, nullptr, &frameState));
-                                TraceLoggingWriteStop(
-                                    local,
-                                    "AsyncWaitFrame",
-                                    TLArg(!!frameState.shouldRender, "ShouldRender"),
-                                    TLArg(frameState.predictedDisplayTime, "PredictedDisplayTime"),
-                                    TLArg(frameState.predictedDisplayPeriod, "PredictedDisplayPeriod"));
-                                {
-                                    std::unique_lock lock(m_asyncWaitMutex);
-
-                                    m_lastPredictedDisplayTime = frameState.predictedDisplayTime;
-                                    m_lastPredictedDisplayPeriod = frameState.predictedDisplayPeriod;
-                                    m_lastShouldRender = frameState.shouldRender;
-
-                                    m_asyncWaitCompleted = true;
-                                }
-                            });
+                            startAsyncWaitFrame(session);
                         }
                     }
                 }
 
                 m_framesElapsed++;
             } else {
-                result = OpenXrApi::xrEndFrame(session, frameEndInfo);
+                result = overhead.chain([&] { return OpenXrApi::xrEndFrame(session, frameEndInfo); });
             }
 
             return result;
@@ -1932,6 +2342,29 @@ namespace openxr_api_layer {
         XrResult xrPollEvent(XrInstance instance, XrEventDataBuffer* eventData) override {
             TraceLoggingWrite(g_traceProvider, "xrPollEvent", TLXArg(instance, "Instance"));
 
+            // Deliver our own visibility mask events first, when the focus view has moved.
+            if (m_useFocusVisibilityMask && eventData->type == XR_TYPE_EVENT_DATA_BUFFER) {
+                std::unique_lock lock(m_focusVisibilityMaskMutex);
+                for (uint32_t eye = 0; eye < xr::StereoView::Count; eye++) {
+                    if (!m_focusVisibilityMaskEventPending[eye]) {
+                        continue;
+                    }
+                    m_focusVisibilityMaskEventPending[eye] = false;
+
+                    XrEventDataVisibilityMaskChangedKHR* event =
+                        reinterpret_cast<XrEventDataVisibilityMaskChangedKHR*>(eventData);
+                    event->type = XR_TYPE_EVENT_DATA_VISIBILITY_MASK_CHANGED_KHR;
+                    event->next = nullptr;
+                    event->session = m_session;
+                    event->viewConfigurationType = XR_VIEW_CONFIGURATION_TYPE_PRIMARY_QUAD_VARJO;
+                    event->viewIndex = eye;
+
+                    TraceLoggingWrite(g_traceProvider, "xrPollEvent_FocusVisibilityMask", TLArg(eye, "ViewIndex"));
+
+                    return XR_SUCCESS;
+                }
+            }
+
             const XrResult result = OpenXrApi::xrPollEvent(instance, eventData);
 
             if (result == XR_SUCCESS) {
@@ -1997,11 +2430,16 @@ namespace openxr_api_layer {
                     if (m_requestedQuadViews &&
                         viewConfigurationType == XR_VIEW_CONFIGURATION_TYPE_PRIMARY_QUAD_VARJO) {
                         if (m_useQuadViews) {
-                            result = OpenXrApi::xrGetVisibilityMaskKHR(session,
-                                                                       XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO,
-                                                                       viewIndex,
-                                                                       visibilityMaskType,
-                                                                       visibilityMask);
+                            if (m_useFocusVisibilityMask &&
+                                visibilityMaskType == XR_VISIBILITY_MASK_TYPE_HIDDEN_TRIANGLE_MESH_KHR) {
+                                result = getPeripheralHiddenMask(session, viewIndex, visibilityMask);
+                            } else {
+                                result = OpenXrApi::xrGetVisibilityMaskKHR(session,
+                                                                           XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO,
+                                                                           viewIndex,
+                                                                           visibilityMaskType,
+                                                                           visibilityMask);
+                            }
                         } else {
                             result = XR_ERROR_VIEW_CONFIGURATION_TYPE_UNSUPPORTED;
                         }
@@ -2025,86 +2463,526 @@ namespace openxr_api_layer {
         }
 
       private:
-        struct Swapchain {
-            std::deque<uint32_t> acquiredIndex;
-            uint32_t lastReleasedIndex{0};
-            bool deferredRelease{false};
+        // The peripheral views are not visible where the focus view is fully opaque. Publish that region as part of the
+        // hidden area mesh, so that applications honoring the visibility mask do not shade it.
+        //
+        // This is only done for fixed foveation. The application only picks up a new mask some frames after the event,
+        // so with eye tracking the cutout would lag behind the focus view and leave holes in the peripheral views.
+        void updateFocusVisibilityMask(const XrFovf& leftFocusFov, const XrFovf& rightFocusFov, bool isFocusFixed) {
+            // Keep margin for the peripheral pixels sampled by the upscaling filter at the edge of the cutout.
+            constexpr float MarginFraction = 0.05f;
+            // Ignore the minor changes of the focus view, and never signal a change more often than this, since each
+            // event may cause the application to rebuild its mesh.
+            constexpr float UpdateThreshold = 0.01f;
+            constexpr auto MinUpdateInterval = 1s;
+
+            const float inset = m_smoothenFocusViewEdges + MarginFraction;
+            const XrFovf* focusFov[xr::StereoView::Count] = {&leftFocusFov, &rightFocusFov};
 
-            XrSwapchainCreateInfo createInfo{};
-            XrSwapchain fullFovSwapchain[xr::StereoView::Count]{XR_NULL_HANDLE, XR_NULL_HANDLE};
-            ComPtr<ID3D11Texture2D> flatImage[xr::QuadView::Count];
-            ComPtr<ID3D11Texture2D> sharpenedImage[xr::StereoView::Count];
+            const auto now = std::chrono::steady_clock::now();
+            std::unique_lock lock(m_focusVisibilityMaskMutex);
+            for (uint32_t eye = 0; eye < xr::StereoView::Count; eye++) {
+                if (now - m_focusVisibilityMaskLastUpdate[eye] < MinUpdateInterval) {
+                    continue;
+                }
 
-            std::vector<ID3D11Texture2D*> images;
-            std::vector<ID3D11Texture2D*> fullFovSwapchainImages[xr::StereoView::Count];
-        };
+                // The rectangle is in tangent space, as (left, right, down, up).
+                const float tanLeft = std::tan(focusFov[eye]->angleLeft);
+                const float tanRight = std::tan(focusFov[eye]->angleRight);
+                const float tanDown = std::tan(focusFov[eye]->angleDown);
+                const float tanUp = std::tan(focusFov[eye]->angleUp);
+                std::array<float, 4> cutout{tanLeft + inset * (tanRight - tanLeft),
+                                            tanRight - inset * (tanRight - tanLeft),
+                                            tanDown + inset * (tanUp - tanDown),
+                                            tanUp - inset * (tanUp - tanDown)};
+                if (!isFocusFixed || cutout[0] >= cutout[1] || cutout[2] >= cutout[3]) {
+                    cutout = {};
+                }
 
-        void initializeEyeTrackingFB(XrSession session) {
-            XrEyeTrackerCreateInfoFB createInfo{XR_TYPE_EYE_TRACKER_CREATE_INFO_FB};
-            CHECK_XRCMD(OpenXrApi::xrCreateEyeTrackerFB(session, &createInfo, &m_eyeTrackerFB));
-            TraceLoggingWrite(g_traceProvider, "EyeTrackerFB", TLXArg(m_eyeTrackerFB, "Handle"));
+                bool hasMoved = false;
+                for (uint32_t i = 0; i < cutout.size(); i++) {
+                    hasMoved = hasMoved || std::abs(cutout[i] - m_focusVisibilityMaskCutout[eye][i]) > UpdateThreshold;
+                }
+                if (hasMoved) {
+                    m_focusVisibilityMaskCutout[eye] = cutout;
+                    m_focusVisibilityMaskEventPending[eye] = true;
+                    m_focusVisibilityMaskLastUpdate[eye] = now;
+                }
+            }
         }
 
-        void initializeEyeGazeInteraction(XrSession session) {
-            if (m_eyeTrackerActionSet == XR_NULL_HANDLE) {
-                XrActionSetCreateInfo actionSetCreateInfo{XR_TYPE_ACTION_SET_CREATE_INFO, nullptr};
-                strcpy_s(actionSetCreateInfo.actionSetName, "quad_views_foveated_eye_tracker");
-                strcpy_s(actionSetCreateInfo.localizedActionSetName, "Eye Tracker");
-                actionSetCreateInfo.priority = 0;
-                CHECK_XRCMD(
-                    OpenXrApi::xrCreateActionSet(GetXrInstance(), &actionSetCreateInfo, &m_eyeTrackerActionSet));
+        XrResult getPeripheralHiddenMask(XrSession session, uint32_t viewIndex, XrVisibilityMaskKHR* visibilityMask) {
+            // Query the size of the mask from the runtime before appending the cutout.
+            XrVisibilityMaskKHR runtimeMask{XR_TYPE_VISIBILITY_MASK_KHR};
+            XrResult result = OpenXrApi::xrGetVisibilityMaskKHR(session,
+                                                                XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO,
+                                                                viewIndex,
+                                                                XR_VISIBILITY_MASK_TYPE_HIDDEN_TRIANGLE_MESH_KHR,
+                                                                &runtimeMask);
+            if (XR_FAILED(result)) {
+                return result;
+            }
 
-                XrActionCreateInfo actionCreateInfo{XR_TYPE_ACTION_CREATE_INFO, nullptr};
-                strcpy_s(actionCreateInfo.actionName, "quad_views_foveated_eye_tracker");
-                strcpy_s(actionCreateInfo.localizedActionName, "Eye Tracker");
-                actionCreateInfo.actionType = XR_ACTION_TYPE_POSE_INPUT;
-                actionCreateInfo.countSubactionPaths = 0;
-                CHECK_XRCMD(OpenXrApi::xrCreateAction(m_eyeTrackerActionSet, &actionCreateInfo, &m_eyeGazeAction));
+            // The application queries the size of the mask, then its content. The cutout published by the first call
+            // is kept for the second one, even if it moved in between, so that the sizes match. The event queued for
+            // the move makes the application query the mask again.
+            std::array<float, 4> cutout;
+            {
+                std::unique_lock lock(m_focusVisibilityMaskMutex);
+                auto& published = m_focusVisibilityMaskPublishedCutout[viewIndex];
+                if (!visibilityMask->vertexCapacityInput && !visibilityMask->indexCapacityInput) {
+                    published = m_focusVisibilityMaskCutout[viewIndex];
+                    cutout = *published;
+                } else {
+                    cutout = std::exchange(published, std::nullopt).value_or(m_focusVisibilityMaskCutout[viewIndex]);
+                }
             }
+            const bool hasCutout = cutout[0] < cutout[1];
+            const uint32_t cutoutVertexCount = hasCutout ? 4 : 0;
+            const uint32_t cutoutIndexCount = hasCutout ? 6 : 0;
 
-            XrActionSpaceCreateInfo actionSpaceCreateInfo{XR_TYPE_ACTION_SPACE_CREATE_INFO, nullptr};
-            actionSpaceCreateInfo.action = m_eyeGazeAction;
-            actionSpaceCreateInfo.subactionPath = XR_NULL_PATH;
-            actionSpaceCreateInfo.poseInActionSpace = Pose::Identity();
-            CHECK_XRCMD(OpenXrApi::xrCreateActionSpace(session, &actionSpaceCreateInfo, &m_eyeSpace));
+            visibilityMask->vertexCountOutput = runtimeMask.vertexCountOutput + cutoutVertexCount;
+            visibilityMask->indexCountOutput = runtimeMask.indexCountOutput + cutoutIndexCount;
+            if (!visibilityMask->vertexCapacityInput && !visibilityMask->indexCapacityInput) {
+                return XR_SUCCESS;
+            }
+            if (visibilityMask->vertexCapacityInput < visibilityMask->vertexCountOutput ||
+                visibilityMask->indexCapacityInput < visibilityMask->indexCountOutput) {
+                return XR_ERROR_SIZE_INSUFFICIENT;
+            }
+
+            if (runtimeMask.vertexCountOutput && runtimeMask.indexCountOutput) {
+                runtimeMask.vertexCapacityInput = runtimeMask.vertexCountOutput;
+                runtimeMask.vertices = visibilityMask->vertices;
+                runtimeMask.indexCapacityInput = runtimeMask.indexCountOutput;
+                runtimeMask.indices = visibilityMask->indices;
+                result = OpenXrApi::xrGetVisibilityMaskKHR(session,
+                                                           XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO,
+                                                           viewIndex,
+                                                           XR_VISIBILITY_MASK_TYPE_HIDDEN_TRIANGLE_MESH_KHR,
+                                                           &runtimeMask);
+                if (XR_FAILED(result)) {
+                    return result;
+                }
+            }
+
+            if (hasCutout) {
+                // Two counter-clockwise triangles on the z=-1 plane.
+                const uint32_t base = runtimeMask.vertexCountOutput;
+                XrVector2f* vertices = visibilityMask->vertices + base;
+                vertices[0] = {cutout[0], cutout[2]};
+                vertices[1] = {cutout[1], cutout[2]};
+                vertices[2] = {cutout[1], cutout[3]};
+                vertices[3] = {cutout[0], cutout[3]};
+                uint32_t* indices = visibilityMask->indices + runtimeMask.indexCountOutput;
+                indices[0] = base;
+                indices[1] = base + 1;
+                indices[2] = base + 2;
+                indices[3] = base;
+                indices[4] = base + 2;
+                indices[5] = base + 3;
+            }
 
             TraceLoggingWrite(g_traceProvider,
-                              "EyeGazeInteraction",
-                              TLXArg(m_eyeTrackerActionSet, "ActionSet"),
-                              TLXArg(m_eyeGazeAction, "Action"),
-                              TLXArg(m_eyeSpace, "ActionSpace"));
+                              "xrGetVisibilityMaskKHR",
+                              TLArg(viewIndex, "ViewIndex"),
+                              TLArg(hasCutout, "HasFocusCutout"),
+                              TLArg(visibilityMask->vertexCountOutput, "VertexCountOutput"),
+                              TLArg(visibilityMask->indexCountOutput, "IndexCountOutput"));
+
+            return XR_SUCCESS;
         }
 
-        bool getSimulatedTracking(XrTime time, bool getStateOnly, XrVector3f& unitVector) {
-            // Use the mouse to simulate eye tracking.
-            if (!getStateOnly) {
-                RECT rect;
-                rect.left = 1;
-                rect.right = 999;
-                rect.top = 1;
-                rect.bottom = 999;
-                ClipCursor(&rect);
+        // Storage for the structures built by xrEndFrame(). The collections are reset every frame but keep their
+        // capacity, so that submission does not allocate once the first frames have been submitted.
+        struct FrameArena {
+            std::vector<XrCompositionLayerProjection> projections;
+            std::vector<std::array<XrCompositionLayerProjectionView, xr::StereoView::Count>> projectionViews;
+            std::vector<XrCompositionLayerDepthInfoKHR> depthInfos;
+            std::vector<const XrCompositionLayerBaseHeader*> layers;
+            std::vector<XrSwapchain> swapchainsToRelease;
+
+            void reset() {
+                projections.clear();
+                projectionViews.clear();
+                depthInfos.clear();
+                layers.clear();
+                swapchainsToRelease.clear();
+            }
 
-                POINT cursor{};
-                GetCursorPos(&cursor);
+            // There are only a handful of swapchains per frame, a linear search is cheaper than a set.
+            void markForRelease(XrSwapchain swapchain) {
+                if (std::find(swapchainsToRelease.cbegin(), swapchainsToRelease.cend(), swapchain) ==
+                    swapchainsToRelease.cend()) {
+                    swapchainsToRelease.push_back(swapchain);
+                }
+            }
+        };
 
-                XrVector2f point = {(float)cursor.x / 1000.f, (float)cursor.y / 1000.f};
-                unitVector = Normalize({point.x - 0.5f, 0.5f - point.y, -0.35f});
+        struct Swapchain {
+            // The number of images of an application swapchain, and for async composition, the value of the
+            // composition fence once each image is no longer read by the composition.
+            uint32_t imageCount{0};
+            std::unique_ptr<std::atomic<uint64_t>[]> compositionFenceValues;
+
+            // Acquire and release of a given swapchain are externally synchronized by the application, but
+            // xrEndFrame() may observe the state from another thread. The acquired indices are kept in a ring with
+            // room for all the images of the swapchain.
+            std::unique_ptr<uint32_t[]> acquiredIndex;
+            std::atomic<uint32_t> acquiredHead{0};
+            std::atomic<uint32_t> acquiredTail{0};
+            std::atomic<uint32_t> lastReleasedIndex{0};
+            std::atomic<bool> deferredRelease{false};
+
+            // Every image of the swapchain is already acquired.
+            bool isAcquiredIndexRingFull() const {
+                return acquiredTail.load(std::memory_order_relaxed) - acquiredHead.load(std::memory_order_acquire) >=
+                       imageCount;
             }
 
-            return true;
-        }
+            void pushAcquiredIndex(uint32_t index) {
+                const uint32_t tail = acquiredTail.load(std::memory_order_relaxed);
+                acquiredIndex[tail % imageCount] = index;
+                acquiredTail.store(tail + 1, std::memory_order_release);
+            }
 
-        bool getEyeTrackerFB(XrTime time, bool getStateOnly, XrVector3f& unitVector) {
-            XrEyeGazesInfoFB eyeGazeInfo{XR_TYPE_EYE_GAZES_INFO_FB};
-            eyeGazeInfo.baseSpace = m_viewSpace;
-            eyeGazeInfo.time = time;
+            void popAcquiredIndex() {
+                const uint32_t head = acquiredHead.load(std::memory_order_relaxed);
+                if (head == acquiredTail.load(std::memory_order_acquire)) {
+                    return;
+                }
+                lastReleasedIndex.store(acquiredIndex[head % imageCount], std::memory_order_release);
+                acquiredHead.store(head + 1, std::memory_order_release);
+            }
 
-            XrEyeGazesFB eyeGaze{XR_TYPE_EYE_GAZES_FB};
-            CHECK_XRCMD(OpenXrApi::xrGetEyeGazesFB(m_eyeTrackerFB, &eyeGazeInfo, &eyeGaze));
-            TraceLoggingWrite(g_traceProvider,
-                              "EyeTrackerFB",
-                              TLArg(!!eyeGaze.gaze[xr::StereoView::Left].isValid, "LeftValid"),
+            XrSwapchainCreateInfo createInfo{};
+            // Only used by the entry holding the sharpened images, which are shared by all the focus swapchains.
+            ComPtr<ID3D11Texture2D> sharpenedImage[xr::StereoView::Count];
+
+            std::vector<ID3D11Texture2D*> images;
+
+            // For D3D12 sessions.
+            ComPtr<ID3D12Resource> d3d12SharpenedImage[xr::StereoView::Count];
+            std::vector<ID3D12Resource*> d3d12Images;
+
+            // Views are persistent across frames. They are keyed by texture, format, first array slice, array size and
+            // view type.
+            enum class ViewType { SRV, RTV, UAV, DSV };
+            using ViewKey = std::tuple<IUnknown*, DXGI_FORMAT, uint32_t, uint32_t, ViewType>;
+            std::map<ViewKey, ComPtr<ID3D11View>> views;
+            // With D3D12, each view is stored in its own CPU-only descriptor heap.
+            std::map<ViewKey, ComPtr<ID3D12DescriptorHeap>> descriptors;
+        };
+
+        // The output swapchains of the composition (full FOV color and depth, focus layer) are pooled for the session.
+        // They outlive the application swapchains and only ever grow, the composition rendering into a sub-rect. They
+        // are shared between the application swapchains with a compatible format, but used at most once per frame.
+        struct PooledSwapchain {
+            XrSwapchain handle{XR_NULL_HANDLE};
+            // The portion of the swapchain used by the current frame.
+            XrExtent2Di extent{};
+            uint64_t lastUsedFrame{0};
+            // Whether the swapchain was created ahead of time and not used yet.
+            bool isReservation{false};
+            // The image acquired ahead of the next frame, and whether it was already waited for.
+            std::optional<uint32_t> preacquiredIndex;
+            bool isPreacquiredImageReady{false};
+            // The creation info (with one array slice per eye), the images cache and the views.
+            Swapchain state;
+        };
+
+        // Layout of the constant buffers and shader-visible descriptors owned by each D3D12 composition context.
+        // The sharpening constants and the sharpening descriptors are duplicated for each eye.
+        enum class D3D12ConstantsSlot {
+            ProjectionVS = 0,
+            ProjectionPS,
+            DepthProjectionVS,
+            DepthProjectionPS,
+            Sharpening,
+        };
+        static constexpr uint32_t D3D12ConstantsPerContext = 4 + xr::StereoView::Count;
+        // The sharpening input/output pair of each eye and the projection inputs (color or depth) of both eyes must be
+        // contiguous for their descriptor tables.
+        enum class D3D12DescriptorSlot {
+            SharpeningInput = 0,
+            SharpeningOutput,
+            StereoInput = 2 * xr::StereoView::Count,
+            FocusInput = StereoInput + xr::StereoView::Count,
+            StereoDepthInput = FocusInput + xr::StereoView::Count,
+            FocusDepthInput = StereoDepthInput + xr::StereoView::Count,
+        };
+        static constexpr uint32_t D3D12DescriptorsPerContext = 6 * xr::StereoView::Count;
+        // The start of the composition, the end of the sharpening pass and the end of the projection pass.
+        static constexpr uint32_t D3D12TimestampsPerContext = 3;
+
+        // A persistent context to record and submit D3D12 composition commands.
+        struct D3D12CompositionContext {
+            ComPtr<ID3D12CommandAllocator> allocator;
+            ComPtr<ID3D12GraphicsCommandList> commandList;
+            uint64_t completedFenceValue{0};
+            // Whether the timestamps of the last submission must be read back.
+            bool hasTimestamps{false};
+            // Whether the last submission ran the sharpening pass.
+            bool hasSharpeningPass{false};
+        };
+
+        ID3D11ShaderResourceView* getShaderResourceView(Swapchain& swapchain,
+                                                        ID3D11Texture2D* texture,
+                                                        DXGI_FORMAT format,
+                                                        uint32_t arraySlice) {
+            const Swapchain::ViewKey key{texture, format, arraySlice, 1, Swapchain::ViewType::SRV};
+            auto it = swapchain.views.find(key);
+            if (it == swapchain.views.end()) {
+                D3D11_SHADER_RESOURCE_VIEW_DESC desc{};
+                desc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+                desc.Format = format;
+                desc.Texture2DArray.MipLevels = 1;
+                desc.Texture2DArray.FirstArraySlice = arraySlice;
+                desc.Texture2DArray.ArraySize = 1;
+                ComPtr<ID3D11ShaderResourceView> srv;
+                CHECK_HRCMD(
+                    m_applicationDevice->CreateShaderResourceView(texture, &desc, srv.ReleaseAndGetAddressOf()));
+                it = swapchain.views.insert_or_assign(key, srv).first;
+            }
+            return static_cast<ID3D11ShaderResourceView*>(it->second.Get());
+        }
+
+        ID3D11RenderTargetView* getRenderTargetView(Swapchain& swapchain,
+                                                    ID3D11Texture2D* texture,
+                                                    DXGI_FORMAT format,
+                                                    uint32_t arraySlice,
+                                                    uint32_t arraySize = 1) {
+            const Swapchain::ViewKey key{texture, format, arraySlice, arraySize, Swapchain::ViewType::RTV};
+            auto it = swapchain.views.find(key);
+            if (it == swapchain.views.end()) {
+                D3D11_RENDER_TARGET_VIEW_DESC desc{};
+                desc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2DARRAY;
+                desc.Format = format;
+                desc.Texture2DArray.FirstArraySlice = arraySlice;
+                desc.Texture2DArray.ArraySize = arraySize;
+                ComPtr<ID3D11RenderTargetView> rtv;
+                CHECK_HRCMD(m_applicationDevice->CreateRenderTargetView(texture, &desc, rtv.ReleaseAndGetAddressOf()));
+                it = swapchain.views.insert_or_assign(key, rtv).first;
+            }
+            return static_cast<ID3D11RenderTargetView*>(it->second.Get());
+        }
+
+        ID3D11UnorderedAccessView* getUnorderedAccessView(Swapchain& swapchain,
+                                                          ID3D11Texture2D* texture,
+                                                          DXGI_FORMAT format) {
+            const Swapchain::ViewKey key{texture, format, 0, 1, Swapchain::ViewType::UAV};
+            auto it = swapchain.views.find(key);
+            if (it == swapchain.views.end()) {
+                D3D11_UNORDERED_ACCESS_VIEW_DESC desc{};
+                desc.ViewDimension = D3D11_UAV_DIMENSION_TEXTURE2D;
+                desc.Format = format;
+                ComPtr<ID3D11UnorderedAccessView> uav;
+                CHECK_HRCMD(
+                    m_applicationDevice->CreateUnorderedAccessView(texture, &desc, uav.ReleaseAndGetAddressOf()));
+                it = swapchain.views.insert_or_assign(key, uav).first;
+            }
+            return static_cast<ID3D11UnorderedAccessView*>(it->second.Get());
+        }
+
+        ID3D11DepthStencilView* getDepthStencilView(Swapchain& swapchain,
+                                                    ID3D11Texture2D* texture,
+                                                    DXGI_FORMAT format,
+                                                    uint32_t arraySlice,
+                                                    uint32_t arraySize = 1) {
+            const Swapchain::ViewKey key{texture, format, arraySlice, arraySize, Swapchain::ViewType::DSV};
+            auto it = swapchain.views.find(key);
+            if (it == swapchain.views.end()) {
+                D3D11_DEPTH_STENCIL_VIEW_DESC desc{};
+                desc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2DARRAY;
+                desc.Format = format;
+                desc.Texture2DArray.FirstArraySlice = arraySlice;
+                desc.Texture2DArray.ArraySize = arraySize;
+                ComPtr<ID3D11DepthStencilView> dsv;
+                CHECK_HRCMD(m_applicationDevice->CreateDepthStencilView(texture, &desc, dsv.ReleaseAndGetAddressOf()));
+                it = swapchain.views.insert_or_assign(key, dsv).first;
+            }
+            return static_cast<ID3D11DepthStencilView*>(it->second.Get());
+        }
+
+        D3D12_CPU_DESCRIPTOR_HANDLE getShaderResourceDescriptor(Swapchain& swapchain,
+                                                                ID3D12Resource* texture,
+                                                                DXGI_FORMAT format,
+                                                                uint32_t arraySlice) {
+            const Swapchain::ViewKey key{texture, format, arraySlice, 1, Swapchain::ViewType::SRV};
+            auto it = swapchain.descriptors.find(key);
+            if (it == swapchain.descriptors.end()) {
+                ComPtr<ID3D12DescriptorHeap> heap = createD3D12DescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+                D3D12_SHADER_RESOURCE_VIEW_DESC desc{};
+                desc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+                desc.Format = format;
+                desc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+                desc.Texture2DArray.MipLevels = 1;
+                desc.Texture2DArray.FirstArraySlice = arraySlice;
+                desc.Texture2DArray.ArraySize = 1;
+                m_d3d12ApplicationDevice->CreateShaderResourceView(
+                    texture, &desc, heap->GetCPUDescriptorHandleForHeapStart());
+                it = swapchain.descriptors.insert_or_assign(key, heap).first;
+            }
+            return it->second->GetCPUDescriptorHandleForHeapStart();
+        }
+
+        D3D12_CPU_DESCRIPTOR_HANDLE getRenderTargetDescriptor(Swapchain& swapchain,
+                                                              ID3D12Resource* texture,
+                                                              DXGI_FORMAT format,
+                                                              uint32_t arraySlice,
+                                                              uint32_t arraySize = 1) {
+            const Swapchain::ViewKey key{texture, format, arraySlice, arraySize, Swapchain::ViewType::RTV};
+            auto it = swapchain.descriptors.find(key);
+            if (it == swapchain.descriptors.end()) {
+                ComPtr<ID3D12DescriptorHeap> heap = createD3D12DescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+                D3D12_RENDER_TARGET_VIEW_DESC desc{};
+                desc.ViewDimension = D3D12_RTV_DIMENSION_TEXTURE2DARRAY;
+                desc.Format = format;
+                desc.Texture2DArray.FirstArraySlice = arraySlice;
+                desc.Texture2DArray.ArraySize = arraySize;
+                m_d3d12ApplicationDevice->CreateRenderTargetView(
+                    texture, &desc, heap->GetCPUDescriptorHandleForHeapStart());
+                it = swapchain.descriptors.insert_or_assign(key, heap).first;
+            }
+            return it->second->GetCPUDescriptorHandleForHeapStart();
+        }
+
+        D3D12_CPU_DESCRIPTOR_HANDLE getUnorderedAccessDescriptor(Swapchain& swapchain,
+                                                                 ID3D12Resource* texture,
+                                                                 DXGI_FORMAT format) {
+            const Swapchain::ViewKey key{texture, format, 0, 1, Swapchain::ViewType::UAV};
+            auto it = swapchain.descriptors.find(key);
+            if (it == swapchain.descriptors.end()) {
+                ComPtr<ID3D12DescriptorHeap> heap = createD3D12DescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+                D3D12_UNORDERED_ACCESS_VIEW_DESC desc{};
+                desc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
+                desc.Format = format;
+                m_d3d12ApplicationDevice->CreateUnorderedAccessView(
+                    texture, nullptr, &desc, heap->GetCPUDescriptorHandleForHeapStart());
+                it = swapchain.descriptors.insert_or_assign(key, heap).first;
+            }
+            return it->second->GetCPUDescriptorHandleForHeapStart();
+        }
+
+        D3D12_CPU_DESCRIPTOR_HANDLE getDepthStencilDescriptor(Swapchain& swapchain,
+                                                              ID3D12Resource* texture,
+                                                              DXGI_FORMAT format,
+                                                              uint32_t arraySlice,
+                                                              uint32_t arraySize = 1) {
+            const Swapchain::ViewKey key{texture, format, arraySlice, arraySize, Swapchain::ViewType::DSV};
+            auto it = swapchain.descriptors.find(key);
+            if (it == swapchain.descriptors.end()) {
+                ComPtr<ID3D12DescriptorHeap> heap = createD3D12DescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
+                D3D12_DEPTH_STENCIL_VIEW_DESC desc{};
+                desc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2DARRAY;
+                desc.Format = format;
+                desc.Texture2DArray.FirstArraySlice = arraySlice;
+                desc.Texture2DArray.ArraySize = arraySize;
+                m_d3d12ApplicationDevice->CreateDepthStencilView(
+                    texture, &desc, heap->GetCPUDescriptorHandleForHeapStart());
+                it = swapchain.descriptors.insert_or_assign(key, heap).first;
+            }
+            return it->second->GetCPUDescriptorHandleForHeapStart();
+        }
+
+        ComPtr<ID3D12DescriptorHeap> createD3D12DescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE type,
+                                                               uint32_t count = 1,
+                                                               bool shaderVisible = false) {
+            D3D12_DESCRIPTOR_HEAP_DESC desc{};
+            desc.Type = type;
+            desc.NumDescriptors = count;
+            desc.Flags = shaderVisible ? D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE : D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+            ComPtr<ID3D12DescriptorHeap> heap;
+            CHECK_HRCMD(
+                m_d3d12ApplicationDevice->CreateDescriptorHeap(&desc, IID_PPV_ARGS(heap.ReleaseAndGetAddressOf())));
+            return heap;
+        }
+
+        // Drop all views referencing a texture that is about to be released.
+        void invalidateViews(Swapchain& swapchain, IUnknown* texture) {
+            for (auto it = swapchain.views.begin(); it != swapchain.views.end();) {
+                if (std::get<0>(it->first) == texture) {
+                    it = swapchain.views.erase(it);
+                } else {
+                    it++;
+                }
+            }
+            for (auto it = swapchain.descriptors.begin(); it != swapchain.descriptors.end();) {
+                if (std::get<0>(it->first) == texture) {
+                    it = swapchain.descriptors.erase(it);
+                } else {
+                    it++;
+                }
+            }
+        }
+
+        void initializeEyeTrackingFB(XrSession session) {
+            XrEyeTrackerCreateInfoFB createInfo{XR_TYPE_EYE_TRACKER_CREATE_INFO_FB};
+            CHECK_XRCMD(OpenXrApi::xrCreateEyeTrackerFB(session, &createInfo, &m_eyeTrackerFB));
+            TraceLoggingWrite(g_traceProvider, "EyeTrackerFB", TLXArg(m_eyeTrackerFB, "Handle"));
+        }
+
+        void initializeEyeGazeInteraction(XrSession session) {
+            if (m_eyeTrackerActionSet == XR_NULL_HANDLE) {
+                XrActionSetCreateInfo actionSetCreateInfo{XR_TYPE_ACTION_SET_CREATE_INFO, nullptr};
+                strcpy_s(actionSetCreateInfo.actionSetName, "quad_views_foveated_eye_tracker");
+                strcpy_s(actionSetCreateInfo.localizedActionSetName, "Eye Tracker");
+                actionSetCreateInfo.priority = 0;
+                CHECK_XRCMD(
+                    OpenXrApi::xrCreateActionSet(GetXrInstance(), &actionSetCreateInfo, &m_eyeTrackerActionSet));
+
+                XrActionCreateInfo actionCreateInfo{XR_TYPE_ACTION_CREATE_INFO, nullptr};
+                strcpy_s(actionCreateInfo.actionName, "quad_views_foveated_eye_tracker");
+                strcpy_s(actionCreateInfo.localizedActionName, "Eye Tracker");
+                actionCreateInfo.actionType = XR_ACTION_TYPE_POSE_INPUT;
+                actionCreateInfo.countSubactionPaths = 0;
+                CHECK_XRCMD(OpenXrApi::xrCreateAction(m_eyeTrackerActionSet, &actionCreateInfo, &m_eyeGazeAction));
+            }
+
+            XrActionSpaceCreateInfo actionSpaceCreateInfo{XR_TYPE_ACTION_SPACE_CREATE_INFO, nullptr};
+            actionSpaceCreateInfo.action = m_eyeGazeAction;
+            actionSpaceCreateInfo.subactionPath = XR_NULL_PATH;
+            actionSpaceCreateInfo.poseInActionSpace = Pose::Identity();
+            CHECK_XRCMD(OpenXrApi::xrCreateActionSpace(session, &actionSpaceCreateInfo, &m_eyeSpace));
+
+            TraceLoggingWrite(g_traceProvider,
+                              "EyeGazeInteraction",
+                              TLXArg(m_eyeTrackerActionSet, "ActionSet"),
+                              TLXArg(m_eyeGazeAction, "Action"),
+                              TLXArg(m_eyeSpace, "ActionSpace"));
+        }
+
+        bool getSimulatedTracking(XrTime time, bool getStateOnly, XrVector3f& unitVector, XrTime& sampleTime) {
+            // Use the mouse to simulate eye tracking.
+            if (!getStateOnly) {
+                RECT rect;
+                rect.left = 1;
+                rect.right = 999;
+                rect.top = 1;
+                rect.bottom = 999;
+                ClipCursor(&rect);
+
+                POINT cursor{};
+                GetCursorPos(&cursor);
+
+                XrVector2f point = {(float)cursor.x / 1000.f, (float)cursor.y / 1000.f};
+                unitVector = Normalize({point.x - 0.5f, 0.5f - point.y, -0.35f});
+            }
+
+            return true;
+        }
+
+        bool getEyeTrackerFB(XrTime time, bool getStateOnly, XrVector3f& unitVector, XrTime& sampleTime) {
+            XrEyeGazesInfoFB eyeGazeInfo{XR_TYPE_EYE_GAZES_INFO_FB};
+            eyeGazeInfo.baseSpace = m_viewSpace;
+            eyeGazeInfo.time = time;
+
+            XrEyeGazesFB eyeGaze{XR_TYPE_EYE_GAZES_FB};
+            CHECK_XRCMD(LayerOverheadScope::chainDownstream(
+                [&] { return OpenXrApi::xrGetEyeGazesFB(m_eyeTrackerFB, &eyeGazeInfo, &eyeGaze); }));
+            TraceLoggingWrite(g_traceProvider,
+                              "EyeTrackerFB",
+                              TLArg(!!eyeGaze.gaze[xr::StereoView::Left].isValid, "LeftValid"),
                               TLArg(eyeGaze.gaze[xr::StereoView::Left].gazeConfidence, "LeftConfidence"),
                               TLArg(!!eyeGaze.gaze[xr::StereoView::Right].isValid, "RightValid"),
                               TLArg(eyeGaze.gaze[xr::StereoView::Right].gazeConfidence, "RightConfidence"));
@@ -2127,16 +3005,21 @@ namespace openxr_api_layer {
 
                 unitVector = Normalize(
                     {gazeProjectedPoint.m128_f32[0], gazeProjectedPoint.m128_f32[1], gazeProjectedPoint.m128_f32[2]});
+                // The eye tracker reports when the gaze was captured.
+                if (eyeGaze.time) {
+                    sampleTime = eyeGaze.time;
+                }
             }
 
             return true;
         }
 
-        bool getEyeGazeInteraction(XrTime time, bool getStateOnly, XrVector3f& unitVector) {
+        bool getEyeGazeInteraction(XrTime time, bool getStateOnly, XrVector3f& unitVector, XrTime& sampleTime) {
             XrActionStatePose actionStatePose{XR_TYPE_ACTION_STATE_POSE, nullptr};
             XrActionStateGetInfo getInfo{XR_TYPE_ACTION_STATE_GET_INFO, nullptr};
             getInfo.action = m_eyeGazeAction;
-            const XrResult result = OpenXrApi::xrGetActionStatePose(m_session, &getInfo, &actionStatePose);
+            const XrResult result = LayerOverheadScope::chainDownstream(
+                [&] { return OpenXrApi::xrGetActionStatePose(m_session, &getInfo, &actionStatePose); });
             TraceLoggingWrite(g_traceProvider,
                               "EyeGazeInteraction",
                               TLArg(xr::ToCString(result), "Result"),
@@ -2147,7 +3030,8 @@ namespace openxr_api_layer {
             }
 
             XrSpaceLocation location{XR_TYPE_SPACE_LOCATION, nullptr};
-            CHECK_XRCMD(OpenXrApi::xrLocateSpace(m_eyeSpace, m_viewSpace, time, &location));
+            CHECK_XRCMD(LayerOverheadScope::chainDownstream(
+                [&] { return OpenXrApi::xrLocateSpace(m_eyeSpace, m_viewSpace, time, &location); }));
             TraceLoggingWrite(g_traceProvider, "EyeGazeInteraction", TLArg(location.locationFlags, "LocationFlags"));
 
             if (!Pose::IsPoseValid(location.locationFlags)) {
@@ -2171,26 +3055,39 @@ namespace openxr_api_layer {
             const auto now = std::chrono::steady_clock::now();
             if ((now - m_lastGoodEyeTrackingData).count() >= 600'000'000) {
                 m_lastGoodEyeGaze.reset();
+                m_eyeGazeSampleCount = 0;
             }
 
             bool result = false;
-            switch (m_trackerType) {
-            case Tracker::SimulatedTracking:
-                result = getSimulatedTracking(time, getStateOnly, unitVector);
-                break;
+            // Unless the tracker tells otherwise, assume the sample is for the requested time.
+            XrTime sampleTime = time;
+            if (isEyeTrackingThreadActive()) {
+                result = getEyeTrackingThreadSample(time, unitVector, sampleTime);
+            } else {
+                switch (m_trackerType) {
+                case Tracker::SimulatedTracking:
+                    result = getSimulatedTracking(time, getStateOnly, unitVector, sampleTime);
+                    break;
 
-            case Tracker::EyeTrackerFB:
-                result = getEyeTrackerFB(time, getStateOnly, unitVector);
-                break;
+                case Tracker::EyeTrackerFB:
+                    result = getEyeTrackerFB(time, getStateOnly, unitVector, sampleTime);
+                    break;
 
-            case Tracker::EyeGazeInteraction:
-                result = getEyeGazeInteraction(time, getStateOnly, unitVector);
-                break;
+                case Tracker::EyeGazeInteraction:
+                    result = getEyeGazeInteraction(time, getStateOnly, unitVector, sampleTime);
+                    break;
+                }
             }
 
             if (result) {
                 m_lastGoodEyeTrackingData = now;
                 if (!getStateOnly) {
+                    if (needEyeGazeHistory()) {
+                        addEyeGazeSample(sampleTime, unitVector);
+                    }
+                    if (m_useEyeGazePrediction) {
+                        unitVector = predictEyeGaze(time);
+                    }
                     m_lastGoodEyeGaze = unitVector;
                 }
                 m_loggedEyeTrackingWarning = false;
@@ -2209,24 +3106,1766 @@ namespace openxr_api_layer {
                               TLArg(useCache, "UsingCache"),
                               TLArg(xr::ToString(unitVector).c_str(), "GazeUnitVector"));
 
-            return result;
-        }
+            return result;
+        }
+
+        struct EyeGazeSample {
+            XrTime time{0};
+            XrVector3f gaze{};
+        };
+
+        // Below this angular speed, the eyes are considered fixating.
+        static constexpr float EyeFixationMaxSpeed = DirectX::XMConvertToRadians(30.f);
+        // Above this angular speed, the eyes are considered in a saccade.
+        static constexpr float EyeSaccadeMinSpeed = DirectX::XMConvertToRadians(180.f);
+
+        // The gaze samples are needed for the prediction, and to measure the eye motion.
+        bool needEyeGazeHistory() const {
+            return m_useEyeGazePrediction || m_useAdaptiveSharpening;
+        }
+
+        // The angular speed of the eyes between the two most recent gaze samples (in radians per second).
+        float getEyeGazeAngularSpeed(XrTime time) const {
+            // Past this age, the samples do not describe the current motion of the eyes anymore.
+            constexpr XrTime MaxSampleAge = 100'000'000;
+
+            if (m_eyeGazeSampleCount < 2) {
+                return 0.f;
+            }
+
+            const EyeGazeSample& latest = getEyeGazeSample(0);
+            const EyeGazeSample& previous = getEyeGazeSample(1);
+            const float dt = (latest.time - previous.time) / 1e9f;
+            if (dt <= 0 || time - latest.time > MaxSampleAge) {
+                return 0.f;
+            }
+            return std::acos(std::clamp(Dot(previous.gaze, latest.gaze), -1.f, 1.f)) / dt;
+        }
+
+        void addEyeGazeSample(XrTime time, const XrVector3f& unitVector) {
+            // Trackers may return the same sample multiple times.
+            if (m_eyeGazeSampleCount && getEyeGazeSample(0).time >= time) {
+                return;
+            }
+
+            m_eyeGazeSampleIndex = (m_eyeGazeSampleIndex + 1) % (uint32_t)std::size(m_eyeGazeSamples);
+            m_eyeGazeSamples[m_eyeGazeSampleIndex] = {time, unitVector};
+            m_eyeGazeSampleCount = std::min(m_eyeGazeSampleCount + 1, (uint32_t)std::size(m_eyeGazeSamples));
+        }
+
+        // Get the N-th most recent gaze sample.
+        const EyeGazeSample& getEyeGazeSample(uint32_t age) const {
+            return m_eyeGazeSamples[(m_eyeGazeSampleIndex + std::size(m_eyeGazeSamples) - age) %
+                                    std::size(m_eyeGazeSamples)];
+        }
+
+        // Filter the gaze during fixations, and extrapolate it to the display time during eye movements.
+        XrVector3f predictEyeGaze(XrTime time) const {
+            // Saccades end abruptly, so we limit how far ahead of the last sample we guess the landing point.
+            constexpr float SaccadeMaxExtrapolation = DirectX::XMConvertToRadians(5.f);
+            constexpr float MaxHorizon = 0.05f;
+            constexpr XrTime FixationFilterWindow = 50'000'000;
+
+            const EyeGazeSample& latest = getEyeGazeSample(0);
+            if (m_eyeGazeSampleCount < 2) {
+                return latest.gaze;
+            }
+
+            const EyeGazeSample& previous = getEyeGazeSample(1);
+            const float dt = (latest.time - previous.time) / 1e9f;
+            const float angle = std::acos(std::clamp(Dot(previous.gaze, latest.gaze), -1.f, 1.f));
+            const float speed = dt > 0 ? angle / dt : 0.f;
+            const float horizon = std::clamp((time - latest.time) / 1e9f + m_eyeGazePredictionLatency, 0.f, MaxHorizon);
+
+            XrVector3f predicted = latest.gaze;
+            if (speed < EyeFixationMaxSpeed) {
+                XrVector3f sum{};
+                for (uint32_t i = 0; i < m_eyeGazeSampleCount; i++) {
+                    const EyeGazeSample& sample = getEyeGazeSample(i);
+                    if (latest.time - sample.time > FixationFilterWindow) {
+                        break;
+                    }
+                    sum = sum + sample.gaze;
+                }
+                predicted = Normalize(sum);
+            } else if (angle > 0) {
+                float displacement = speed * horizon;
+                if (speed >= EyeSaccadeMinSpeed) {
+                    displacement = std::min(displacement, SaccadeMaxExtrapolation);
+                }
+
+                // Keep rotating along the arc between the last two samples.
+                const XrVector3f axis = Normalize(Cross(previous.gaze, latest.gaze));
+                predicted = Normalize(latest.gaze * std::cos(displacement) +
+                                      Cross(axis, latest.gaze) * std::sin(displacement));
+            }
+
+            TraceLoggingWrite(g_traceProvider,
+                              "EyeGazePrediction",
+                              TLArg(DirectX::XMConvertToDegrees(speed), "AngularSpeed"),
+                              TLArg(speed >= EyeSaccadeMinSpeed, "IsSaccade"),
+                              TLArg(horizon * 1000.f, "HorizonMs"),
+                              TLArg(xr::ToString(predicted).c_str(), "PredictedGaze"));
+
+            return predicted;
+        }
+
+        // Poll the eye tracker at a fixed rate on a dedicated thread, so the latency of the tracker is not added to the
+        // application's frame loop. The samples are published into a ring that the frame loop reads without locking.
+        void startEyeTrackingThread() {
+            if (m_eyeTrackingThread.joinable()) {
+                return;
+            }
+
+            m_eyeTrackingThreadExit = false;
+            m_eyeTrackingThreadFailed = false;
+            m_eyeTrackingThread = std::thread([&] { eyeTrackingThread(); });
+        }
+
+        void stopEyeTrackingThread() {
+            if (m_eyeTrackingThread.joinable()) {
+                m_eyeTrackingThreadExit = true;
+                m_eyeTrackingThread.join();
+            }
+        }
+
+        bool isEyeTrackingThreadActive() const {
+            return m_eyeTrackingThread.joinable() && !m_eyeTrackingThreadFailed.load(std::memory_order_relaxed);
+        }
+
+        void eyeTrackingThread() {
+            SetThreadDescription(GetCurrentThread(), L"Quad-Views Eye Tracking");
+
+            // The default timer resolution is too coarse for the polling rates of most eye trackers.
+            wil::unique_handle timer;
+            *timer.put() = CreateWaitableTimerEx(
+                nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_MODIFY_STATE | SYNCHRONIZE);
+            const LONGLONG period = 10'000'000 / m_eyeTrackingThreadRate;
+
+            try {
+                while (!m_eyeTrackingThreadExit) {
+                    LARGE_INTEGER qpcTime;
+                    QueryPerformanceCounter(&qpcTime);
+                    XrTime now;
+                    CHECK_XRCMD(
+                        OpenXrApi::xrConvertWin32PerformanceCounterToTimeKHR(GetXrInstance(), &qpcTime, &now));
+
+                    TraceLocalActivity(local);
+                    TraceLoggingWriteStart(local, "EyeTrackingThread_Poll", TLArg(now, "Time"));
+
+                    XrVector3f unitVector{};
+                    // Unless the tracker tells otherwise, the sample is for the time of the query.
+                    XrTime sampleTime = now;
+                    bool result = false;
+                    switch (m_trackerType) {
+                    case Tracker::SimulatedTracking:
+                        result = getSimulatedTracking(now, false, unitVector, sampleTime);
+                        break;
+
+                    case Tracker::EyeTrackerFB:
+                        result = getEyeTrackerFB(now, false, unitVector, sampleTime);
+                        break;
+
+                    case Tracker::EyeGazeInteraction:
+                        result = getEyeGazeInteraction(now, false, unitVector, sampleTime);
+                        break;
+                    }
+                    if (result) {
+                        publishEyeGazeSample(sampleTime, unitVector);
+                    }
+
+                    TraceLoggingWriteStop(local, "EyeTrackingThread_Poll", TLArg(result, "Valid"));
+
+                    if (timer) {
+                        LARGE_INTEGER dueTime;
+                        dueTime.QuadPart = -period;
+                        SetWaitableTimer(timer.get(), &dueTime, 0, nullptr, nullptr, FALSE);
+                        WaitForSingleObject(timer.get(), INFINITE);
+                    } else {
+                        std::this_thread::sleep_for(std::chrono::microseconds(period / 10));
+                    }
+                }
+            } catch (std::exception& exc) {
+                // The frame loop falls back to querying the eye tracker itself.
+                ErrorLog(fmt::format("EyeTrackingThread: {}\n", exc.what()));
+                m_eyeTrackingThreadFailed = true;
+            }
+        }
+
+        // Single producer: only called from the eye tracking thread.
+        void publishEyeGazeSample(XrTime time, const XrVector3f& unitVector) {
+            const uint64_t index = m_eyeTrackingSampleWriteCount.load(std::memory_order_relaxed);
+            EyeGazeSampleSlot& slot = m_eyeTrackingSamples[index % std::size(m_eyeTrackingSamples)];
+
+            // The sequence number is odd while the slot is being written.
+            const uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+            slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            slot.time.store(time, std::memory_order_relaxed);
+            slot.x.store(unitVector.x, std::memory_order_relaxed);
+            slot.y.store(unitVector.y, std::memory_order_relaxed);
+            slot.z.store(unitVector.z, std::memory_order_relaxed);
+            slot.sequence.store(sequence + 2, std::memory_order_release);
+
+            m_eyeTrackingSampleWriteCount.store(index + 1, std::memory_order_release);
+        }
+
+        // Returns false if the sample was overwritten by the eye tracking thread while reading it.
+        bool readEyeGazeSample(uint64_t index, EyeGazeSample& sample) const {
+            const EyeGazeSampleSlot& slot = m_eyeTrackingSamples[index % std::size(m_eyeTrackingSamples)];
+
+            // Each write to the slot advances its sequence number by 2.
+            const uint32_t expectedSequence = (uint32_t)(2 * (index / std::size(m_eyeTrackingSamples) + 1));
+            if (slot.sequence.load(std::memory_order_acquire) != expectedSequence) {
+                return false;
+            }
+            sample.time = slot.time.load(std::memory_order_relaxed);
+            sample.gaze = {slot.x.load(std::memory_order_relaxed),
+                           slot.y.load(std::memory_order_relaxed),
+                           slot.z.load(std::memory_order_relaxed)};
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return slot.sequence.load(std::memory_order_relaxed) == expectedSequence;
+        }
+
+        // Read the samples published by the eye tracking thread since the last call. The samples only feed the
+        // prediction history, the most recent one is returned.
+        bool getEyeTrackingThreadSample(XrTime time, XrVector3f& unitVector, XrTime& sampleTime) {
+            // Past this age, the tracker is considered to have lost the eyes (for example during a blink).
+            constexpr XrTime MaxSampleAge = 100'000'000;
+
+            const uint64_t writeCount = m_eyeTrackingSampleWriteCount.load(std::memory_order_acquire);
+            // Older samples would be pushed out of the prediction history anyway.
+            const uint64_t oldest = std::max(m_eyeTrackingSampleReadCount,
+                                             writeCount - std::min(writeCount, (uint64_t)std::size(m_eyeGazeSamples)));
+            bool hasSample = false;
+            EyeGazeSample latest{};
+            for (uint64_t index = oldest; index < writeCount; index++) {
+                EyeGazeSample sample;
+                if (!readEyeGazeSample(index, sample)) {
+                    continue;
+                }
+                if (needEyeGazeHistory()) {
+                    addEyeGazeSample(sample.time, sample.gaze);
+                }
+                latest = sample;
+                hasSample = true;
+            }
+            m_eyeTrackingSampleReadCount = writeCount;
+
+            if (hasSample) {
+                m_eyeTrackingLatestSample = latest;
+            }
+            if (!m_eyeTrackingLatestSample || time - m_eyeTrackingLatestSample->time > MaxSampleAge) {
+                return false;
+            }
+
+            unitVector = m_eyeTrackingLatestSample->gaze;
+            sampleTime = m_eyeTrackingLatestSample->time;
+            return true;
+        }
+
+        // Request the wait thread to perform the next xrWaitFrame() on behalf of the application.
+        void startAsyncWaitFrame(XrSession session) {
+            {
+                std::unique_lock lock(m_asyncWaitMutex);
+
+                m_asyncWaitSession = session;
+                m_asyncWaitCompleted = false;
+                m_asyncWaitRequested = true;
+            }
+            m_asyncWaitPending = true;
+
+            if (!m_asyncWaitThread.joinable()) {
+                m_asyncWaitThreadExit = false;
+                m_asyncWaitThread = std::thread([&] { asyncWaitThread(); });
+            }
+            m_asyncWaitCondition.notify_all();
+        }
+
+        void waitForAsyncWaitFrame() {
+            std::unique_lock lock(m_asyncWaitMutex);
+            m_asyncWaitCondition.wait(lock, [&] { return m_asyncWaitCompleted; });
+        }
+
+        bool waitForAsyncWaitFrame(std::chrono::milliseconds timeout) {
+            std::unique_lock lock(m_asyncWaitMutex);
+            return m_asyncWaitCondition.wait_for(lock, timeout, [&] { return m_asyncWaitCompleted; });
+        }
+
+        void stopAsyncWaitThread() {
+            if (m_asyncWaitThread.joinable()) {
+                {
+                    std::unique_lock lock(m_asyncWaitMutex);
+                    m_asyncWaitThreadExit = true;
+                }
+                m_asyncWaitCondition.notify_all();
+                m_asyncWaitThread.join();
+            }
+        }
+
+        // A persistent thread to perform xrWaitFrame() in Turbo mode, without spawning a thread for every frame.
+        void asyncWaitThread() {
+            SetThreadDescription(GetCurrentThread(), L"Quad-Views Async Wait");
+
+            while (true) {
+                XrSession session;
+                {
+                    std::unique_lock lock(m_asyncWaitMutex);
+                    m_asyncWaitCondition.wait(lock, [&] { return m_asyncWaitRequested || m_asyncWaitThreadExit; });
+                    if (m_asyncWaitThreadExit) {
+                        break;
+                    }
+
+                    session = m_asyncWaitSession;
+                    m_asyncWaitRequested = false;
+                }
+
+                TraceLocalActivity(local);
+
+                XrFrameState frameState{XR_TYPE_FRAME_STATE};
+                TraceLoggingWriteStart(local, "AsyncWaitFrame");
+                const XrResult result = OpenXrApi::xrWaitFrame(session, nullptr, &frameState);
+                TraceLoggingWriteStop(local,
+                                      "AsyncWaitFrame",
+                                      TLArg(xr::ToCString(result), "Result"),
+                                      TLArg(!!frameState.shouldRender, "ShouldRender"),
+                                      TLArg(frameState.predictedDisplayTime, "PredictedDisplayTime"),
+                                      TLArg(frameState.predictedDisplayPeriod, "PredictedDisplayPeriod"));
+                if (XR_FAILED(result)) {
+                    ErrorLog(fmt::format("AsyncWaitFrame: xrWaitFrame failed with {}\n", xr::ToCString(result)));
+                }
+
+                {
+                    std::unique_lock lock(m_asyncWaitMutex);
+
+                    if (XR_SUCCEEDED(result)) {
+                        m_lastPredictedDisplayTime = frameState.predictedDisplayTime;
+                        m_lastPredictedDisplayPeriod = frameState.predictedDisplayPeriod;
+                        m_lastShouldRender = frameState.shouldRender;
+                    }
+
+                    m_asyncWaitCompleted = true;
+                }
+                m_asyncWaitCondition.notify_all();
+            }
+        }
+
+        // The timers are needed for tracing, but also to drive dynamic resolution and the frame statistics.
+        bool isFrameTimingEnabled() const {
+            return IsTraceEnabled() || m_useDynamicResolution || m_useFrameStatistics;
+        }
+
+        void logFrameStatistics() {
+            static constexpr std::array<uint32_t, 3> Ranks{50, 95, 99};
+            const auto format = [](const char* name, const auto& stats) {
+                const auto values = stats.percentiles(Ranks);
+                return fmt::format("{} {}/{}/{}", name, values[0], values[1], values[2]);
+            };
+
+            if (!m_appCpuTimeStats.count()) {
+                return;
+            }
+
+            const float pipelinedRatio = m_turboFrames ? 100.f * m_turboPipelinedFrames / m_turboFrames : 0.f;
+            Log(fmt::format("Frame statistics (p50/p95/p99 us over {} frames): {}, {}, {}, {}, {}, {}, {}, {}, "
+                            "turbo pipelined {:.1f}% of {} frames\n",
+                            m_appCpuTimeStats.count(),
+                            format("app CPU", m_appCpuTimeStats),
+                            format("render CPU", m_appRenderCpuTimeStats),
+                            format("app GPU", m_appGpuTimeStats),
+                            format("composition GPU", m_compositionGpuTimeStats),
+                            format("sharpening GPU", m_sharpeningGpuTimeStats),
+                            format("projection GPU", m_projectionGpuTimeStats),
+                            format("waitFrame", m_waitFrameTimeStats),
+                            format("output wait", m_outputWaitTimeStats),
+                            pipelinedRatio,
+                            m_turboFrames));
+            Log(fmt::format("Layer CPU overhead (p50/p95/p99 ns): {}, {}, {}, {}, {}\n",
+                            format("waitFrame", m_waitFrameOverheadStats),
+                            format("locateViews", m_locateViewsOverheadStats),
+                            format("endFrame", m_endFrameOverheadStats),
+                            format("acquireSwapchainImage", m_acquireSwapchainImageOverheadStats),
+                            format("releaseSwapchainImage", m_releaseSwapchainImageOverheadStats)));
+
+            m_turboFrames = m_turboPipelinedFrames = 0;
+        }
+
+        // Record the GPU time of each stage of the composition (in microseconds). There is no sharpening time for the
+        // frames that skipped the sharpening pass.
+        void recordCompositionStageTimes(std::optional<uint64_t> sharpeningGpuTime, uint64_t projectionGpuTime) {
+            m_lastSharpeningGpuTime = sharpeningGpuTime;
+            m_lastProjectionGpuTime = projectionGpuTime;
+            TraceLoggingWrite(g_traceProvider,
+                              "CompositionStagePerf",
+                              TLArg(m_lastSharpeningGpuTime.value_or(0), "SharpeningGpuTime"),
+                              TLArg(m_lastProjectionGpuTime, "ProjectionGpuTime"));
+        }
+
+        // Read back the timestamps resolved by a D3D12 composition context. The context must have completed.
+        void readD3D12CompositionTimestamps(uint32_t contextIndex, bool hasSharpeningPass) {
+            const size_t offset = contextIndex * D3D12TimestampsPerContext * sizeof(uint64_t);
+            const D3D12_RANGE readRange{offset, offset + D3D12TimestampsPerContext * sizeof(uint64_t)};
+            uint8_t* mappedTimestamps = nullptr;
+            CHECK_HRCMD(m_d3d12TimestampReadback->Map(0, &readRange, reinterpret_cast<void**>(&mappedTimestamps)));
+            uint64_t timestamps[D3D12TimestampsPerContext];
+            memcpy(timestamps, mappedTimestamps + offset, sizeof(timestamps));
+            const D3D12_RANGE noWrite{0, 0};
+            m_d3d12TimestampReadback->Unmap(0, &noWrite);
+
+            const auto toMicroseconds = [&](uint64_t start, uint64_t end) {
+                return end > start && m_d3d12TimestampFrequency
+                           ? static_cast<uint64_t>(((end - start) * 1e6) / m_d3d12TimestampFrequency)
+                           : 0;
+            };
+            recordCompositionStageTimes(hasSharpeningPass ? std::optional(toMicroseconds(timestamps[0], timestamps[1]))
+                                                          : std::nullopt,
+                                        toMicroseconds(timestamps[1], timestamps[2]));
+        }
+
+        // Adjust the resolution of the full FOV image to keep the composition GPU time within its share of the display
+        // period. Only the layer's own output is resized: the application renders the focus and peripheral views at the
+        // resolution it picked from xrEnumerateViewConfigurationViews(), and the layer has no way to change it during
+        // the session. The application GPU time is therefore left out, since resizing the output cannot reduce it.
+        void updateDynamicResolution() {
+            // The GPU timers have 3 frames of latency, wait for the effects of the last change to be measured.
+            constexpr uint32_t FramesBetweenChanges = 10;
+            constexpr float MaxScaleStep = 0.05f;
+            // Only grow back when there is enough headroom, to avoid oscillating.
+            constexpr float GrowthHysteresis = 0.85f;
+
+            const uint64_t compositionGpuTime = m_lastCompositionGpuTime;
+            if (!compositionGpuTime || !m_lastPredictedDisplayPeriod || !m_fullFovResolution.width) {
+                return;
+            }
+
+            m_smoothedCompositionGpuTime = m_smoothedCompositionGpuTime
+                                               ? 0.9f * m_smoothedCompositionGpuTime + 0.1f * compositionGpuTime
+                                               : (float)compositionGpuTime;
+
+            m_framesSinceResolutionChange++;
+            if (m_framesSinceResolutionChange < FramesBetweenChanges) {
+                return;
+            }
+
+            const float budget = m_dynamicResolutionCompositionBudget * m_lastPredictedDisplayPeriod / 1000.f;
+            float newScale = m_dynamicResolutionScale;
+            if (m_smoothedCompositionGpuTime > budget || m_smoothedCompositionGpuTime < GrowthHysteresis * budget) {
+                // The cost of the composition is proportional to the pixel count.
+                const float idealScale = m_dynamicResolutionScale * std::sqrt(budget / m_smoothedCompositionGpuTime);
+                newScale = std::clamp(std::clamp(idealScale,
+                                                 m_dynamicResolutionScale - MaxScaleStep,
+                                                 m_dynamicResolutionScale + MaxScaleStep),
+                                      m_dynamicResolutionMinScale,
+                                      1.f);
+            }
+
+            if (std::abs(newScale - m_dynamicResolutionScale) > 0.001f) {
+                m_dynamicResolutionScale = newScale;
+                m_fullFovRenderResolution.width = AlignTo<2>((uint32_t)(m_fullFovResolution.width * newScale));
+                m_fullFovRenderResolution.height = AlignTo<2>((uint32_t)(m_fullFovResolution.height * newScale));
+                m_fullFovRenderResolution.width = std::min(m_fullFovRenderResolution.width, m_fullFovResolution.width);
+                m_fullFovRenderResolution.height =
+                    std::min(m_fullFovRenderResolution.height, m_fullFovResolution.height);
+                m_framesSinceResolutionChange = 0;
+
+                TraceLoggingWrite(g_traceProvider,
+                                  "DynamicResolution",
+                                  TLArg(m_smoothedCompositionGpuTime, "SmoothedCompositionGpuTime"),
+                                  TLArg(budget, "Budget"),
+                                  TLArg(m_dynamicResolutionScale, "Scale"),
+                                  TLArg(m_fullFovRenderResolution.width, "Width"),
+                                  TLArg(m_fullFovRenderResolution.height, "Height"));
+            }
+        }
+
+        static bool IsPooledSwapchainCompatible(const XrSwapchainCreateInfo& pooled,
+                                                const XrSwapchainCreateInfo& requested) {
+            return pooled.format == requested.format && pooled.usageFlags == requested.usageFlags &&
+                   pooled.createFlags == requested.createFlags && pooled.sampleCount == requested.sampleCount &&
+                   pooled.arraySize == requested.arraySize && pooled.faceCount == requested.faceCount &&
+                   pooled.mipCount == requested.mipCount;
+        }
+
+        // The full FOV swapchains have one array slice per eye. The depth is at a fraction of the full FOV resolution.
+        XrSwapchainCreateInfo getFullFovSwapchainCreateInfo(const XrSwapchainCreateInfo& applicationInfo) const {
+            XrSwapchainCreateInfo createInfo = applicationInfo;
+            createInfo.arraySize = xr::StereoView::Count;
+            if (applicationInfo.usageFlags & XR_SWAPCHAIN_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT) {
+                const XrExtent2Di resolution = getDepthCompositionExtent(m_fullFovResolution);
+                createInfo.width = resolution.width;
+                createInfo.height = resolution.height;
+            } else {
+                createInfo.width = m_fullFovResolution.width;
+                createInfo.height = m_fullFovResolution.height;
+                // We will use a Pixel Shader for rendering into this swapchain.
+                createInfo.usageFlags |= XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT;
+            }
+            return createInfo;
+        }
+
+        PooledSwapchain& createPooledSwapchain(XrSession session, const XrSwapchainCreateInfo& createInfo) {
+            TraceLoggingWrite(g_traceProvider,
+                              "CreatePooledSwapchain",
+                              TLArg(createInfo.width, "Width"),
+                              TLArg(createInfo.height, "Height"),
+                              TLArg(createInfo.format, "Format"),
+                              TLArg(createInfo.usageFlags, "UsageFlags"));
+
+            auto entry = std::make_unique<PooledSwapchain>();
+            CHECK_XRCMD(LayerOverheadScope::chainDownstream(
+                [&] { return OpenXrApi::xrCreateSwapchain(session, &createInfo, &entry->handle); }));
+            entry->state.createInfo = createInfo;
+            entry->lastUsedFrame = m_swapchainPoolFrame;
+            m_swapchainPool.push_back(std::move(entry));
+            return *m_swapchainPool.back();
+        }
+
+        void destroyPooledSwapchain(const PooledSwapchain& entry) {
+            TraceLoggingWrite(g_traceProvider, "DestroyPooledSwapchain", TLXArg(entry.handle, "Swapchain"));
+
+            // With D3D12, make sure there is no pending composition that may reference the swapchain images.
+            waitForD3D12Composition(m_d3d12CompositionFenceValue);
+            LayerOverheadScope::chainDownstream([&] { return OpenXrApi::xrDestroySwapchain(entry.handle); });
+            // Destroying the entry releases all its persistent views.
+            m_swapchainPool.erase(std::find_if(m_swapchainPool.begin(),
+                                               m_swapchainPool.end(),
+                                               [&](const std::unique_ptr<PooledSwapchain>& candidate) {
+                                                   return candidate.get() == &entry;
+                                               }));
+        }
+
+        // Pick a compatible swapchain from the pool that is not used yet by the current frame. A swapchain that is too
+        // small is replaced by one covering both the old and the requested sizes, so that the pool settles quickly on
+        // the largest size.
+        PooledSwapchain& acquirePooledSwapchain(XrSession session,
+                                                const XrSwapchainCreateInfo& createInfo,
+                                                const XrExtent2Di& extent) {
+            std::unique_lock lock(m_swapchainPoolMutex);
+
+            PooledSwapchain* smallerEntry = nullptr;
+            for (const auto& entry : m_swapchainPool) {
+                if (entry->lastUsedFrame == m_swapchainPoolFrame ||
+                    !IsPooledSwapchainCompatible(entry->state.createInfo, createInfo)) {
+                    continue;
+                }
+                if (entry->state.createInfo.width >= createInfo.width &&
+                    entry->state.createInfo.height >= createInfo.height) {
+                    entry->lastUsedFrame = m_swapchainPoolFrame;
+                    entry->isReservation = false;
+                    entry->extent = extent;
+                    return *entry;
+                }
+                smallerEntry = entry.get();
+            }
+
+            XrSwapchainCreateInfo poolCreateInfo = createInfo;
+            if (smallerEntry) {
+                poolCreateInfo.width = std::max(poolCreateInfo.width, smallerEntry->state.createInfo.width);
+                poolCreateInfo.height = std::max(poolCreateInfo.height, smallerEntry->state.createInfo.height);
+                destroyPooledSwapchain(*smallerEntry);
+            }
+            PooledSwapchain& newEntry = createPooledSwapchain(session, poolCreateInfo);
+            newEntry.extent = extent;
+            return newEntry;
+        }
+
+        // The swapchain for the focus layer composition mode is sized for the largest of the two focus views.
+        PooledSwapchain& acquireFocusLayerSwapchain(XrSession session,
+                                                    const XrSwapchainCreateInfo& applicationInfo,
+                                                    const XrCompositionLayerProjectionView* focusViews) {
+            const XrExtent2Di resolution{
+                std::max(focusViews[xr::StereoView::Left].subImage.imageRect.extent.width,
+                         focusViews[xr::StereoView::Right].subImage.imageRect.extent.width),
+                std::max(focusViews[xr::StereoView::Left].subImage.imageRect.extent.height,
+                         focusViews[xr::StereoView::Right].subImage.imageRect.extent.height)};
+
+            XrSwapchainCreateInfo createInfo = applicationInfo;
+            createInfo.arraySize = xr::StereoView::Count;
+            createInfo.width = resolution.width;
+            createInfo.height = resolution.height;
+            // We will use a Pixel Shader for rendering into this swapchain.
+            createInfo.usageFlags |= XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT;
+            return acquirePooledSwapchain(session, createInfo, resolution);
+        }
+
+        // Whether the content of the swapchain may be composited, and therefore whether its format may be the one of an
+        // output swapchain.
+        bool isCompositionSourceSwapchain(const XrSwapchainCreateInfo& applicationInfo) const {
+            const bool isDepth = applicationInfo.usageFlags & XR_SWAPCHAIN_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+            return applicationInfo.faceCount == 1 &&
+                   !(applicationInfo.createFlags & XR_SWAPCHAIN_CREATE_STATIC_IMAGE_BIT) &&
+                   (isDepth ? m_useDepthComposition
+                            : (applicationInfo.usageFlags & XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT) != 0);
+        }
+
+        // Create the full FOV swapchain for an application swapchain ahead of its first submission, so that the frame
+        // loop does not stall on the allocation. The application swapchains sharing a format share the reservation.
+        void reservePooledSwapchain(XrSession session, const XrSwapchainCreateInfo& applicationInfo) {
+            if (m_useFocusLayer || !m_fullFovResolution.width || !isCompositionSourceSwapchain(applicationInfo)) {
+                return;
+            }
+
+            std::unique_lock lock(m_swapchainPoolMutex);
+
+            const XrSwapchainCreateInfo createInfo = getFullFovSwapchainCreateInfo(applicationInfo);
+            for (const auto& entry : m_swapchainPool) {
+                if (IsPooledSwapchainCompatible(entry->state.createInfo, createInfo) &&
+                    entry->state.createInfo.width >= createInfo.width &&
+                    entry->state.createInfo.height >= createInfo.height) {
+                    return;
+                }
+            }
+            createPooledSwapchain(session, createInfo).isReservation = true;
+        }
+
+        // Start a new frame for the pool. Release the reservations for the application swapchains that are never
+        // submitted with a projection layer.
+        void beginSwapchainPoolFrame() {
+            std::unique_lock lock(m_swapchainPoolMutex);
+
+            m_swapchainPoolFrame++;
+
+            for (size_t i = 0; i < m_swapchainPool.size();) {
+                const PooledSwapchain& entry = *m_swapchainPool[i];
+                if (entry.isReservation && m_swapchainPoolFrame - entry.lastUsedFrame > SwapchainPoolRetentionFrames) {
+                    destroyPooledSwapchain(*m_swapchainPool[i]);
+                } else {
+                    i++;
+                }
+            }
+        }
+
+        // Find the depth submitted with each view. The stereo and focus depths are mixed together, so they must all be
+        // present, readable and use the same ranges.
+        bool getDepthInfosForComposition(const XrCompositionLayerProjection* proj,
+                                         const XrCompositionLayerDepthInfoKHR* (&depthInfos)[xr::QuadView::Count],
+                                         Swapchain* (&swapchainsForDepth)[xr::QuadView::Count]) const {
+            for (uint32_t i = 0; i < xr::QuadView::Count; i++) {
+                const XrBaseInStructure* entry = reinterpret_cast<const XrBaseInStructure*>(proj->views[i].next);
+                while (entry && entry->type != XR_TYPE_COMPOSITION_LAYER_DEPTH_INFO_KHR) {
+                    entry = entry->next;
+                }
+                if (!entry) {
+                    return false;
+                }
+
+                depthInfos[i] = reinterpret_cast<const XrCompositionLayerDepthInfoKHR*>(entry);
+                swapchainsForDepth[i] = findSwapchain(depthInfos[i]->subImage.swapchain);
+                if (!swapchainsForDepth[i] ||
+                    !(swapchainsForDepth[i]->createInfo.usageFlags & XR_SWAPCHAIN_USAGE_SAMPLED_BIT) ||
+                    swapchainsForDepth[i]->createInfo.sampleCount != 1) {
+                    return false;
+                }
+
+                const XrCompositionLayerDepthInfoKHR& reference = *depthInfos[0];
+                if (depthInfos[i]->minDepth != reference.minDepth || depthInfos[i]->maxDepth != reference.maxDepth ||
+                    depthInfos[i]->nearZ != reference.nearZ || depthInfos[i]->farZ != reference.farZ) {
+                    TraceLoggingWrite(g_traceProvider, "xrEndFrame_DepthRangeMismatch", TLArg(i, "ViewIndex"));
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        XrExtent2Di getDepthCompositionExtent(const XrExtent2Di& extent) const {
+            return {std::max(1, (int32_t)(extent.width * m_depthCompositionScale)),
+                    std::max(1, (int32_t)(extent.height * m_depthCompositionScale))};
+        }
+
+        // Use the image acquired at the end of the previous frame if there is one. Any time spent waiting for the
+        // runtime to give the image back is reported as a stall.
+        uint32_t acquireOutputSwapchainImage(PooledSwapchain& swapchain) {
+            TraceLocalActivity(local);
+            TraceLoggingWriteStart(local,
+                                   "xrEndFrame_GatherInputOutput_AcquireOutput",
+                                   TLXArg(swapchain.handle, "Swapchain"),
+                                   TLArg(swapchain.preacquiredIndex.has_value(), "Preacquired"));
+            const uint32_t acquiredImageIndex = swapchain.preacquiredIndex ? *swapchain.preacquiredIndex
+                                                                           : acquireSwapchainImage(swapchain.handle);
+            if (!swapchain.isPreacquiredImageReady) {
+                const auto start = std::chrono::steady_clock::now();
+                XrSwapchainImageWaitInfo waitInfo{XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO};
+                waitInfo.timeout = 10000000000;
+                TraceLoggingWriteTagged(
+                    local, "xrEndFrame_GatherInputOutput_WaitOutput", TLXArg(swapchain.handle, "Swapchain"));
+                CHECK_XRCMD(LayerOverheadScope::chainDownstream(
+                    [&] { return OpenXrApi::xrWaitSwapchainImage(swapchain.handle, &waitInfo); }));
+                const uint64_t stall = std::chrono::duration_cast<std::chrono::microseconds>(
+                                           std::chrono::steady_clock::now() - start)
+                                           .count();
+                m_outputWaitTime += stall;
+                TraceLoggingWriteTagged(local,
+                                        "xrEndFrame_GatherInputOutput_OutputStall",
+                                        TLXArg(swapchain.handle, "Swapchain"),
+                                        TLArg(stall, "StallUs"));
+            }
+            swapchain.preacquiredIndex.reset();
+            swapchain.isPreacquiredImageReady = false;
+            TraceLoggingWriteStop(local,
+                                  "xrEndFrame_GatherInputOutput_AcquireOutput",
+                                  TLArg(acquiredImageIndex, "AcquiredIndex"));
+
+            return acquiredImageIndex;
+        }
+
+        uint32_t acquireSwapchainImage(XrSwapchain swapchain) {
+            uint32_t acquiredImageIndex;
+            CHECK_XRCMD(LayerOverheadScope::chainDownstream(
+                [&] { return OpenXrApi::xrAcquireSwapchainImage(swapchain, nullptr, &acquiredImageIndex); }));
+            return acquiredImageIndex;
+        }
+
+        // Acquire the next image of the output swapchains used by the frame that was just submitted, so that the wait
+        // for the runtime to give the image back overlaps with the rendering of the next frame. The wait is only
+        // polled here, it completes by the next composition.
+        void preacquireOutputSwapchainImages() {
+            std::unique_lock lock(m_swapchainPoolMutex);
+
+            for (const auto& entry : m_swapchainPool) {
+                if (entry->lastUsedFrame != m_swapchainPoolFrame || entry->isReservation || entry->preacquiredIndex) {
+                    continue;
+                }
+
+                TraceLocalActivity(local);
+                TraceLoggingWriteStart(local, "xrEndFrame_PreacquireOutput", TLXArg(entry->handle, "Swapchain"));
+                entry->preacquiredIndex = acquireSwapchainImage(entry->handle);
+                XrSwapchainImageWaitInfo waitInfo{XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO};
+                waitInfo.timeout = 0;
+                const XrResult result = LayerOverheadScope::chainDownstream(
+                    [&] { return OpenXrApi::xrWaitSwapchainImage(entry->handle, &waitInfo); });
+                CHECK_XRCMD(result);
+                entry->isPreacquiredImageReady = result != XR_TIMEOUT_EXPIRED;
+                TraceLoggingWriteStop(local,
+                                      "xrEndFrame_PreacquireOutput",
+                                      TLArg(*entry->preacquiredIndex, "AcquiredIndex"),
+                                      TLArg(entry->isPreacquiredImageReady, "Ready"));
+            }
+        }
+
+        void releaseOutputSwapchainImage(XrSwapchain swapchain) {
+            TraceLocalActivity(local);
+            TraceLoggingWriteStart(local, "xrEndFrame_CommitOutput");
+            CHECK_XRCMD(LayerOverheadScope::chainDownstream(
+                [&] { return OpenXrApi::xrReleaseSwapchainImage(swapchain, nullptr); }));
+            TraceLoggingWriteStop(local, "xrEndFrame_CommitOutput");
+        }
+
+        void storeFocusFovForQuirk(XrTime displayTime, const XrFovf& left, const XrFovf& right) {
+            std::unique_lock lock(m_focusFovMutex);
+
+            // Update the latest entry if the application locates the views multiple times for the same frame.
+            if (m_focusFovForDisplayTime[m_focusFovForDisplayTimeIndex].displayTime != displayTime) {
+                m_focusFovForDisplayTimeIndex =
+                    (m_focusFovForDisplayTimeIndex + 1) % (uint32_t)std::size(m_focusFovForDisplayTime);
+            }
+
+            FocusFovEntry& entry = m_focusFovForDisplayTime[m_focusFovForDisplayTimeIndex];
+            const uint32_t sequence = entry.sequence.load(std::memory_order_relaxed);
+            entry.sequence.store(sequence + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            entry.displayTime = displayTime;
+            entry.fov[xr::StereoView::Left] = left;
+            entry.fov[xr::StereoView::Right] = right;
+            entry.sequence.store(sequence + 2, std::memory_order_release);
+        }
+
+        bool lookupFocusFovForQuirk(XrTime displayTime, XrFovf (&fov)[xr::StereoView::Count]) const {
+            for (const FocusFovEntry& entry : m_focusFovForDisplayTime) {
+                while (true) {
+                    const uint32_t sequence = entry.sequence.load(std::memory_order_acquire);
+                    if (sequence & 1) {
+                        // A write is in progress.
+                        continue;
+                    }
+
+                    const XrTime entryDisplayTime = entry.displayTime;
+                    fov[xr::StereoView::Left] = entry.fov[xr::StereoView::Left];
+                    fov[xr::StereoView::Right] = entry.fov[xr::StereoView::Right];
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    if (entry.sequence.load(std::memory_order_relaxed) != sequence) {
+                        continue;
+                    }
+
+                    if (entryDisplayTime == displayTime) {
+                        return true;
+                    }
+                    break;
+                }
+            }
+            return false;
+        }
+
+        Swapchain* findSwapchain(XrSwapchain handle) const {
+            const uint32_t count = m_swapchainsHighWater.load(std::memory_order_acquire);
+            for (uint32_t i = 0; i < count; i++) {
+                if (m_swapchains[i].handle.load(std::memory_order_acquire) == handle) {
+                    return m_swapchains[i].state.get();
+                }
+            }
+            return nullptr;
+        }
+
+        bool insertSwapchain(XrSwapchain handle, std::unique_ptr<Swapchain> state) {
+            std::unique_lock lock(m_swapchainsMutex);
+
+            for (uint32_t i = 0; i < MaxSwapchains; i++) {
+                SwapchainSlot& slot = m_swapchains[i];
+                if (slot.handle.load(std::memory_order_relaxed) == XR_NULL_HANDLE) {
+                    slot.state = std::move(state);
+                    slot.handle.store(handle, std::memory_order_release);
+                    if (i >= m_swapchainsHighWater.load(std::memory_order_relaxed)) {
+                        m_swapchainsHighWater.store(i + 1, std::memory_order_release);
+                    }
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        std::unique_ptr<Swapchain> removeSwapchain(XrSwapchain handle) {
+            std::unique_lock lock(m_swapchainsMutex);
+
+            const uint32_t count = m_swapchainsHighWater.load(std::memory_order_relaxed);
+            for (uint32_t i = 0; i < count; i++) {
+                SwapchainSlot& slot = m_swapchains[i];
+                if (slot.handle.load(std::memory_order_relaxed) == handle) {
+                    slot.handle.store(XR_NULL_HANDLE, std::memory_order_release);
+                    return std::move(slot.state);
+                }
+            }
+            return {};
+        }
+
+        void clearSwapchains() {
+            std::unique_lock lock(m_swapchainsMutex);
+
+            for (SwapchainSlot& slot : m_swapchains) {
+                slot.handle.store(XR_NULL_HANDLE, std::memory_order_release);
+                slot.state.reset();
+            }
+            m_swapchainsHighWater.store(0, std::memory_order_release);
+        }
+
+        // Compute the constants for the projection shaders for one eye. When the focus image is sharpened, the
+        // sharpened image only contains the image rect of the focus view.
+        template <typename TextureDesc>
+        void getProjectionConstants(uint32_t viewIndex,
+                                    const XrCompositionLayerProjectionView& stereoView,
+                                    const TextureDesc& stereoImageDesc,
+                                    const XrCompositionLayerProjectionView& focusView,
+                                    const TextureDesc& focusImageDesc,
+                                    bool isFocusImageSharpened,
+                                    XrCompositionLayerFlags layerFlags,
+                                    bool isFocusLayer,
+                                    ProjectionVSConstants& projection,
+                                    ProjectionPSConstants& drawing) const {
+            {
+                // The focus layer covers exactly the focus view.
+                const DirectX::XMMATRIX baseLayerViewProjection = ComposeProjectionMatrix(
+                    isFocusLayer ? focusView.fov : m_cachedEyeFov[viewIndex], NearFar{0.1f, 20.f});
+                const DirectX::XMMATRIX layerViewProjection =
+                    ComposeProjectionMatrix(focusView.fov, NearFar{0.1f, 20.f});
+
+                DirectX::XMStoreFloat4x4(
+                    &projection.focusProjection[viewIndex],
+                    DirectX::XMMatrixTranspose(DirectX::XMMatrixInverse(nullptr, baseLayerViewProjection) *
+                                               layerViewProjection));
+            }
+            projection.stereoUVScaleBias[viewIndex] =
+                m_useQuadViews ? GetUVScaleBias(stereoView.subImage.imageRect, stereoImageDesc)
+                               : DirectX::XMFLOAT4{1.f, 1.f, 0.f, 0.f};
+
+            drawing.smoothingArea = m_useQuadViews ? m_smoothenFocusViewEdges : 0;
+            drawing.ignoreAlpha = ~(layerFlags & XR_COMPOSITION_LAYER_BLEND_TEXTURE_SOURCE_ALPHA_BIT);
+            drawing.isUnpremultipliedAlpha = layerFlags & XR_COMPOSITION_LAYER_UNPREMULTIPLIED_ALPHA_BIT;
+            drawing.debugFocusView = m_debugFocusView;
+            if (m_sharpeningStrength && m_useFusedSharpening) {
+                // Same as CasSetup().
+                const float sharpness = std::clamp(m_sharpeningStrength, 0.f, 1.f);
+                drawing.sharpeningPeak = -1.f / (8.f + (5.f - 8.f) * sharpness);
+            } else {
+                drawing.sharpeningPeak = 0.f;
+            }
+            if (m_useQuadViews) {
+                drawing.stereoUVClamp[viewIndex] = GetUVClamp(stereoView.subImage.imageRect, stereoImageDesc);
+            } else {
+                drawing.stereoUVClamp[viewIndex] = {0.f, 0.f, 1.f, 1.f};
+            }
+            XrRect2Di focusImageRect = focusView.subImage.imageRect;
+            if (isFocusImageSharpened) {
+                focusImageRect.offset = {0, 0};
+            }
+            drawing.focusUVScaleBias[viewIndex] = GetUVScaleBias(focusImageRect, focusImageDesc);
+            drawing.focusUVClamp[viewIndex] = GetUVClamp(focusImageRect, focusImageDesc);
+            drawing.focusTexelSize[viewIndex] = {1.f / focusImageDesc.Width, 1.f / focusImageDesc.Height, 0.f, 0.f};
+            drawing.peripheralUpscaling = m_usePeripheralUpscaling;
+            drawing.focusLayer = isFocusLayer;
+            drawing.stereoTexelSize[viewIndex] = {1.f / stereoImageDesc.Width,
+                                                  1.f / stereoImageDesc.Height,
+                                                  (float)stereoImageDesc.Width,
+                                                  (float)stereoImageDesc.Height};
+        }
+
+        // Detail is not perceptible during saccades and fast head motion. In adaptive mode, the sharpening is lowered
+        // or skipped altogether in these frames. It is restored progressively once the motion settles.
+        void updateSharpeningStrength(XrTime displayTime) {
+            constexpr float HeadMotionMinSpeed = DirectX::XMConvertToRadians(60.f);
+            constexpr float HeadMotionMaxSpeed = DirectX::XMConvertToRadians(180.f);
+            // Below this strength, the sharpening pass is skipped.
+            constexpr float MinStrength = 0.05f;
+            constexpr float RecoveryPerFrame = 0.1f;
+
+            if (!m_useAdaptiveSharpening || !m_sharpenFocusView) {
+                m_sharpeningStrength = m_sharpenFocusView;
+                return;
+            }
+
+            const float eyeSpeed = getEyeGazeAngularSpeed(displayTime);
+            float motion =
+                std::clamp((eyeSpeed - EyeFixationMaxSpeed) / (EyeSaccadeMinSpeed - EyeFixationMaxSpeed), 0.f, 1.f);
+
+            float headSpeed = 0.f;
+            XrSpaceVelocity velocity{XR_TYPE_SPACE_VELOCITY};
+            XrSpaceLocation location{XR_TYPE_SPACE_LOCATION, &velocity};
+            if (XR_SUCCEEDED(LayerOverheadScope::chainDownstream([&] {
+                    return OpenXrApi::xrLocateSpace(m_viewSpace, m_localSpace, displayTime, &location);
+                })) &&
+                (velocity.velocityFlags & XR_SPACE_VELOCITY_ANGULAR_VALID_BIT)) {
+                headSpeed = Length(velocity.angularVelocity);
+                motion = std::max(
+                    motion,
+                    std::clamp((headSpeed - HeadMotionMinSpeed) / (HeadMotionMaxSpeed - HeadMotionMinSpeed), 0.f, 1.f));
+            }
+
+            // Drop the strength immediately, but bring it back over a few frames.
+            m_adaptiveSharpeningFactor = std::min(1.f - motion, m_adaptiveSharpeningFactor + RecoveryPerFrame);
+            m_sharpeningStrength = m_sharpenFocusView * m_adaptiveSharpeningFactor;
+            if (m_sharpeningStrength < MinStrength) {
+                m_sharpeningStrength = 0.f;
+            }
+
+            TraceLoggingWrite(g_traceProvider,
+                              "AdaptiveSharpening",
+                              TLArg(DirectX::XMConvertToDegrees(eyeSpeed), "EyeAngularSpeed"),
+                              TLArg(DirectX::XMConvertToDegrees(headSpeed), "HeadAngularSpeed"),
+                              TLArg(m_sharpeningStrength, "Strength"));
+        }
+
+        // Compute the constants for the CAS shader.
+        void getSharpeningConstants(const XrCompositionLayerProjectionView& focusView,
+                                    SharpeningCSConstants& sharpening) const {
+            sharpening = {};
+            CasSetup(sharpening.Const0,
+                     sharpening.Const1,
+                     std::clamp(m_sharpeningStrength, 0.f, 1.f),
+                     (AF1)focusView.subImage.imageRect.extent.width,
+                     (AF1)focusView.subImage.imageRect.extent.height,
+                     (AF1)focusView.subImage.imageRect.extent.width,
+                     (AF1)focusView.subImage.imageRect.extent.height);
+            sharpening.InputRect[0] = focusView.subImage.imageRect.offset.x;
+            sharpening.InputRect[1] = focusView.subImage.imageRect.offset.y;
+            sharpening.InputRect[2] =
+                focusView.subImage.imageRect.offset.x + focusView.subImage.imageRect.extent.width - 1;
+            sharpening.InputRect[3] =
+                focusView.subImage.imageRect.offset.y + focusView.subImage.imageRect.extent.height - 1;
+        }
+
+        // The sharpened images are shared by all the focus swapchains. They only ever grow, and the sharpening pass
+        // writes into their top-left corner.
+        ID3D11Texture2D* getSharpenedImage(uint32_t viewIndex, const XrExtent2Di& extent) {
+            ComPtr<ID3D11Texture2D>& image = m_sharpenedImages->sharpenedImage[viewIndex];
+            D3D11_TEXTURE2D_DESC desc{};
+            if (image) {
+                image->GetDesc(&desc);
+                if (desc.Width >= (UINT)extent.width && desc.Height >= (UINT)extent.height) {
+                    return image.Get();
+                }
+                invalidateViews(*m_sharpenedImages, image.Get());
+            }
+
+            TraceLoggingWrite(g_traceProvider,
+                              "CreateSharpenedImage",
+                              TLArg(viewIndex, "ViewIndex"),
+                              TLArg(extent.width, "Width"),
+                              TLArg(extent.height, "Height"));
+
+            const UINT width = std::max(desc.Width, (UINT)extent.width);
+            const UINT height = std::max(desc.Height, (UINT)extent.height);
+            desc = {};
+            desc.ArraySize = 1;
+            desc.Width = width;
+            desc.Height = height;
+            desc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+            desc.MipLevels = 1;
+            desc.SampleDesc.Count = 1;
+            desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+            CHECK_HRCMD(m_applicationDevice->CreateTexture2D(&desc, nullptr, image.ReleaseAndGetAddressOf()));
+            return image.Get();
+        }
+
+        ID3D12Resource* getD3D12SharpenedImage(uint32_t viewIndex, const XrExtent2Di& extent) {
+            ComPtr<ID3D12Resource>& image = m_sharpenedImages->d3d12SharpenedImage[viewIndex];
+            D3D12_RESOURCE_DESC desc{};
+            if (image) {
+                desc = image->GetDesc();
+                if (desc.Width >= (UINT64)extent.width && desc.Height >= (UINT)extent.height) {
+                    return image.Get();
+                }
+                // The previous image might still be in use by the GPU.
+                waitForD3D12Composition(m_d3d12CompositionFenceValue);
+                invalidateViews(*m_sharpenedImages, image.Get());
+            }
+
+            TraceLoggingWrite(g_traceProvider,
+                              "CreateSharpenedImage",
+                              TLArg(viewIndex, "ViewIndex"),
+                              TLArg(extent.width, "Width"),
+                              TLArg(extent.height, "Height"));
+
+            const UINT64 width = std::max(desc.Width, (UINT64)extent.width);
+            const UINT height = std::max(desc.Height, (UINT)extent.height);
+            desc = {};
+            desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+            desc.Width = width;
+            desc.Height = height;
+            desc.DepthOrArraySize = 1;
+            desc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+            desc.MipLevels = 1;
+            desc.SampleDesc.Count = 1;
+            desc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+            D3D12_HEAP_PROPERTIES heapType{};
+            heapType.Type = D3D12_HEAP_TYPE_DEFAULT;
+            heapType.CreationNodeMask = heapType.VisibleNodeMask = 1;
+            CHECK_HRCMD(
+                m_d3d12ApplicationDevice->CreateCommittedResource(&heapType,
+                                                                  D3D12_HEAP_FLAG_NONE,
+                                                                  &desc,
+                                                                  D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+                                                                  nullptr,
+                                                                  IID_PPV_ARGS(image.ReleaseAndGetAddressOf())));
+            image->SetName(L"Sharpened Image");
+            return image.Get();
+        }
+
+        // The driver compiles the shaders upon creating them (and for some drivers, again upon their first draw), which
+        // can take tens of milliseconds. Create all the composition resources on a worker thread from xrCreateSession()
+        // onwards, so that this cost is hidden behind the application's loading.
+        void startCompositionWarmUp(XrSession session) {
+            if (m_applicationDevice && (m_applicationDevice->GetCreationFlags() & D3D11_CREATE_DEVICE_SINGLETHREADED)) {
+                // The device cannot be used from another thread. Resources will be created when the session begins.
+                return;
+            }
+
+            // The pipeline states are specific to the format of the output swapchains, which are created with the
+            // format of the application swapchains. These formats are not known yet, so we compile the pipeline states
+            // for all the formats that the runtime supports.
+            std::vector<int64_t> formats;
+            if (m_d3d12ApplicationDevice) {
+                uint32_t count;
+                CHECK_XRCMD(OpenXrApi::xrEnumerateSwapchainFormats(session, 0, &count, nullptr));
+                formats.resize(count);
+                CHECK_XRCMD(OpenXrApi::xrEnumerateSwapchainFormats(session, count, &count, formats.data()));
+            }
+
+            m_compositionWarmUpException = {};
+            m_compositionWarmUpThread = std::thread([&, formats = std::move(formats)] {
+                TraceLocalActivity(local);
+                TraceLoggingWriteStart(local, "CompositionWarmUp");
+
+                // Exceptions are surfaced to the application thread upon waiting for the warm-up.
+                try {
+                    if (m_applicationDevice) {
+                        initializeCompositionResources(m_applicationDevice.Get());
+                    } else if (m_d3d12ApplicationDevice) {
+                        initializeCompositionResources(m_d3d12ApplicationDevice.Get());
+                        for (const int64_t format : formats) {
+                            warmUpD3D12PipelineStates((DXGI_FORMAT)format);
+                        }
+                    }
+                } catch (...) {
+                    m_compositionWarmUpException = std::current_exception();
+                }
+
+                TraceLoggingWriteStop(local, "CompositionWarmUp", TLArg(!!m_compositionWarmUpException, "Failed"));
+            });
+        }
+
+        void waitForCompositionWarmUp() {
+            if (!m_compositionWarmUpThread.joinable()) {
+                return;
+            }
+
+            TraceLocalActivity(local);
+            TraceLoggingWriteStart(local, "WaitForCompositionWarmUp");
+            m_compositionWarmUpThread.join();
+            TraceLoggingWriteStop(local, "WaitForCompositionWarmUp");
+
+            if (m_compositionWarmUpException) {
+                std::rethrow_exception(std::exchange(m_compositionWarmUpException, {}));
+            }
+        }
+
+        void warmUpD3D12PipelineStates(DXGI_FORMAT format) {
+            D3D12_FEATURE_DATA_FORMAT_SUPPORT support{format};
+            if (FAILED(m_d3d12ApplicationDevice->CheckFeatureSupport(
+                    D3D12_FEATURE_FORMAT_SUPPORT, &support, sizeof(support)))) {
+                return;
+            }
+
+            if (support.Support1 & D3D12_FORMAT_SUPPORT1_RENDER_TARGET) {
+                getProjectionPipelineState(format);
+            } else if (m_useDepthComposition && (support.Support1 & D3D12_FORMAT_SUPPORT1_DEPTH_STENCIL)) {
+                getDepthProjectionPipelineState(format);
+            }
+        }
+
+        // Some D3D11 drivers defer the final compilation of the shaders until they are used with a given render target
+        // format. Record a draw with each shader into small render targets of the application's formats, on a worker
+        // thread and a deferred context, so that neither the application thread nor the application's immediate
+        // context are involved. Drivers that support command lists natively compile upon recording, and the command
+        // list is then discarded without being executed.
+        void startD3D11PipelineWarmUp(std::set<DXGI_FORMAT> colorFormats, std::set<DXGI_FORMAT> depthFormats) {
+            if (m_applicationDevice->GetCreationFlags() & D3D11_CREATE_DEVICE_SINGLETHREADED) {
+                // The device cannot be used from another thread, nor have deferred contexts.
+                return;
+            }
+
+            m_compositionWarmUpThread =
+                std::thread([&, colorFormats = std::move(colorFormats), depthFormats = std::move(depthFormats)] {
+                    TraceLocalActivity(local);
+                    TraceLoggingWriteStart(local, "WarmUpD3D11Pipeline");
+
+                    // The warm-up is only an optimization, a failure must not fail the session.
+                    try {
+                        ComPtr<ID3D11DeviceContext> context;
+                        CHECK_HRCMD(m_applicationDevice->CreateDeferredContext(0, context.ReleaseAndGetAddressOf()));
+                        warmUpD3D11PipelineFormats(context.Get(), colorFormats, depthFormats);
+                        ComPtr<ID3D11CommandList> commandList;
+                        CHECK_HRCMD(context->FinishCommandList(FALSE, commandList.ReleaseAndGetAddressOf()));
+                    } catch (std::exception& exc) {
+                        ErrorLog(fmt::format("WarmUpD3D11Pipeline: {}\n", exc.what()));
+                    }
+
+                    TraceLoggingWriteStop(local,
+                                          "WarmUpD3D11Pipeline",
+                                          TLArg((uint32_t)colorFormats.size(), "ColorFormats"),
+                                          TLArg((uint32_t)depthFormats.size(), "DepthFormats"));
+                });
+        }
+
+        void warmUpD3D11PipelineFormats(ID3D11DeviceContext* context,
+                                        const std::set<DXGI_FORMAT>& colorFormats,
+                                        const std::set<DXGI_FORMAT>& depthFormats) {
+            // The views are released with this temporary swapchain state.
+            Swapchain scratch;
+            const auto createTexture = [&](DXGI_FORMAT format, UINT arraySize, UINT bindFlags) {
+                D3D11_TEXTURE2D_DESC desc{};
+                desc.ArraySize = arraySize;
+                desc.Width = desc.Height = 16;
+                desc.Format = format;
+                desc.MipLevels = 1;
+                desc.SampleDesc.Count = 1;
+                desc.BindFlags = bindFlags;
+                ComPtr<ID3D11Texture2D> texture;
+                CHECK_HRCMD(m_applicationDevice->CreateTexture2D(&desc, nullptr, texture.ReleaseAndGetAddressOf()));
+                return texture;
+            };
+
+            // The shaders only need to run, zeroed constants will do.
+            {
+                const ProjectionVSConstants projection{};
+                D3D11_MAPPED_SUBRESOURCE mappedResources;
+                CHECK_HRCMD(context->Map(
+                    m_projectionVSConstants.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResources));
+                memcpy(mappedResources.pData, &projection, sizeof(projection));
+                context->Unmap(m_projectionVSConstants.Get(), 0);
+            }
+            {
+                const ProjectionPSConstants drawing{};
+                D3D11_MAPPED_SUBRESOURCE mappedResources;
+                CHECK_HRCMD(context->Map(
+                    m_projectionPSConstants.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResources));
+                memcpy(mappedResources.pData, &drawing, sizeof(drawing));
+                context->Unmap(m_projectionPSConstants.Get(), 0);
+            }
+            {
+                const SharpeningCSConstants sharpening{};
+                D3D11_MAPPED_SUBRESOURCE mappedResources;
+                CHECK_HRCMD(context->Map(
+                    m_sharpeningCSConstants.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResources));
+                memcpy(mappedResources.pData, &sharpening, sizeof(sharpening));
+                context->Unmap(m_sharpeningCSConstants.Get(), 0);
+            }
+
+            if (m_sharpenFocusView && !m_useFusedSharpening) {
+                ComPtr<ID3D11Texture2D> texture =
+                    createTexture(DXGI_FORMAT_R16G16B16A16_FLOAT, 1, D3D11_BIND_UNORDERED_ACCESS);
+                ID3D11UnorderedAccessView* uav =
+                    getUnorderedAccessView(scratch, texture.Get(), DXGI_FORMAT_R16G16B16A16_FLOAT);
+                context->CSSetConstantBuffers(0, 1, m_sharpeningCSConstants.GetAddressOf());
+                context->CSSetShader(m_sharpeningCS.Get(), nullptr, 0);
+                context->CSSetShaderResources(0, 1, m_srvBlankTexture.GetAddressOf());
+                context->CSSetUnorderedAccessViews(0, 1, &uav, nullptr);
+                context->Dispatch(1, 1, 1);
+                ID3D11UnorderedAccessView* nullUAV[] = {nullptr};
+                context->CSSetUnorderedAccessViews(0, 1, nullUAV, nullptr);
+            }
+
+            ID3D11ShaderResourceView* srvs[xr::QuadView::Count];
+            std::fill_n(srvs, std::size(srvs), m_srvBlankTexture.Get());
+            D3D11_VIEWPORT viewport{};
+            viewport.Width = viewport.Height = 16.f;
+            viewport.MaxDepth = 1.f;
+            context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+            context->RSSetState(m_noDepthRasterizer.Get());
+            context->RSSetViewports(1, &viewport);
+            context->VSSetConstantBuffers(0, 1, m_projectionVSConstants.GetAddressOf());
+            context->VSSetShader(m_projectionVS.Get(), nullptr, 0);
+            context->GSSetShader(m_projectionGS.Get(), nullptr, 0);
+            context->PSSetConstantBuffers(0, 1, m_projectionPSConstants.GetAddressOf());
+            context->PSSetSamplers(0, 1, m_linearClampSampler.GetAddressOf());
+            context->PSSetShaderResources(0, (UINT)std::size(srvs), srvs);
+
+            context->PSSetShader(m_projectionPS.Get(), nullptr, 0);
+            for (const DXGI_FORMAT format : colorFormats) {
+                ComPtr<ID3D11Texture2D> texture =
+                    createTexture(format, xr::StereoView::Count, D3D11_BIND_RENDER_TARGET);
+                ID3D11RenderTargetView* rtv =
+                    getRenderTargetView(scratch, texture.Get(), format, 0, xr::StereoView::Count);
+                context->OMSetRenderTargets(1, &rtv, nullptr);
+                context->DrawInstanced(3, xr::StereoView::Count, 0, 0);
+            }
+
+            if (m_useDepthComposition) {
+                context->OMSetDepthStencilState(m_depthWriteState.Get(), 0);
+                context->PSSetShader(m_depthProjectionPS.Get(), nullptr, 0);
+                for (const DXGI_FORMAT format : depthFormats) {
+                    ComPtr<ID3D11Texture2D> texture =
+                        createTexture(format, xr::StereoView::Count, D3D11_BIND_DEPTH_STENCIL);
+                    ID3D11DepthStencilView* dsv =
+                        getDepthStencilView(scratch, texture.Get(), format, 0, xr::StereoView::Count);
+                    context->OMSetRenderTargets(0, nullptr, dsv);
+                    context->DrawInstanced(3, xr::StereoView::Count, 0, 0);
+                }
+            }
+        }
+
+        // Allocate the composition resources when the session begins rather than upon the first frames: the shaders,
+        // the sharpened images at the recommended focus resolution, and the output swapchains for the application
+        // swapchains created so far.
+        void preallocateCompositionResources(XrSession session) {
+            TraceLocalActivity(local);
+            TraceLoggingWriteStart(local, "PreallocateCompositionResources");
+
+            waitForCompositionWarmUp();
+            if (m_applicationDevice && !m_projectionPS) {
+                initializeCompositionResources(m_applicationDevice.Get());
+            } else if (m_d3d12ApplicationDevice && !m_d3d12ProjectionRootSignature) {
+                initializeCompositionResources(m_d3d12ApplicationDevice.Get());
+            }
+
+            if (m_sharpenFocusView && !m_useFusedSharpening && m_recommendedFocusResolution.width) {
+                for (uint32_t viewIndex = 0; viewIndex < xr::StereoView::Count; viewIndex++) {
+                    if (m_applicationDevice) {
+                        getSharpenedImage(viewIndex, m_recommendedFocusResolution);
+                    } else if (m_d3d12ApplicationDevice) {
+                        getD3D12SharpenedImage(viewIndex, m_recommendedFocusResolution);
+                    }
+                }
+            }
+
+            std::set<DXGI_FORMAT> colorFormats;
+            std::set<DXGI_FORMAT> depthFormats;
+            {
+                std::unique_lock lock(m_swapchainsMutex);
+
+                const uint32_t count = m_swapchainsHighWater.load(std::memory_order_relaxed);
+                for (uint32_t i = 0; i < count; i++) {
+                    if (m_swapchains[i].handle.load(std::memory_order_relaxed) != XR_NULL_HANDLE) {
+                        const XrSwapchainCreateInfo& createInfo = m_swapchains[i].state->createInfo;
+                        reservePooledSwapchain(session, createInfo);
+                        if (!isCompositionSourceSwapchain(createInfo)) {
+                            continue;
+                        }
+                        // The depth is not composited with the focus layer composition mode.
+                        if (createInfo.usageFlags & XR_SWAPCHAIN_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT) {
+                            if (!m_useFocusLayer) {
+                                depthFormats.insert((DXGI_FORMAT)createInfo.format);
+                            }
+                        } else {
+                            colorFormats.insert((DXGI_FORMAT)createInfo.format);
+                        }
+                    }
+                }
+            }
+
+            // Make sure the pipeline is ready for the formats the application is actually using.
+            if (m_applicationDevice) {
+                startD3D11PipelineWarmUp(std::move(colorFormats), std::move(depthFormats));
+            } else if (m_d3d12ApplicationDevice) {
+                // The warm-up is only an optimization, a failure must not fail the session.
+                try {
+                    for (const DXGI_FORMAT format : colorFormats) {
+                        getProjectionPipelineState(format);
+                    }
+                    if (m_useDepthComposition) {
+                        for (const DXGI_FORMAT format : depthFormats) {
+                            getDepthProjectionPipelineState(format);
+                        }
+                    }
+                } catch (std::exception& exc) {
+                    ErrorLog(fmt::format("PreallocateCompositionResources: {}\n", exc.what()));
+                }
+            }
+
+            TraceLoggingWriteStop(local, "PreallocateCompositionResources");
+        }
+
+        void compositeViewContentD3D11(const XrCompositionLayerProjectionView* stereoViews,
+                                       Swapchain* const* swapchainsForStereoView,
+                                       const XrCompositionLayerProjectionView* focusViews,
+                                       Swapchain* const* swapchainsForFocusView,
+                                       XrCompositionLayerFlags layerFlags,
+                                       bool isFocusLayer,
+                                       PooledSwapchain& output,
+                                       const XrCompositionLayerDepthInfoKHR* const* depthInfos,
+                                       Swapchain* const* swapchainsForDepth,
+                                       PooledSwapchain* depthOutput) {
+            // Lazy initialization of the composition resources, unless they were compiled in the background.
+            waitForCompositionWarmUp();
+            if (!m_projectionPS) {
+                initializeCompositionResources(m_applicationDevice.Get());
+            }
+
+            // Populate the images cache and create all the persistent views upfront.
+            const auto populateSwapchainImagesCache = [&](Swapchain& entry,
+                                                          std::vector<ID3D11Texture2D*>& images,
+                                                          XrSwapchain swapchain,
+                                                          bool isRenderTarget) {
+                if (!images.empty()) {
+                    return;
+                }
+
+                TraceLocalActivity(local);
+                TraceLoggingWriteStart(
+                    local, "xrEndFrame_GatherInputOutput_PopulateImagesCache", TLXArg(swapchain, "Swapchain"));
+                uint32_t count;
+                CHECK_XRCMD(LayerOverheadScope::chainDownstream(
+                    [&] { return OpenXrApi::xrEnumerateSwapchainImages(swapchain, 0, &count, nullptr); }));
+                std::vector<XrSwapchainImageD3D11KHR> d3d11Images(count, {XR_TYPE_SWAPCHAIN_IMAGE_D3D11_KHR});
+                CHECK_XRCMD(LayerOverheadScope::chainDownstream([&] {
+                    return OpenXrApi::xrEnumerateSwapchainImages(
+                        swapchain, count, &count, reinterpret_cast<XrSwapchainImageBaseHeader*>(d3d11Images.data()));
+                }));
+                const DXGI_FORMAT format = (DXGI_FORMAT)entry.createInfo.format;
+                const bool isDepth = entry.createInfo.usageFlags & XR_SWAPCHAIN_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+                for (uint32_t i = 0; i < count; i++) {
+                    TraceLoggingWriteTagged(local,
+                                            "xrEndFrame_GatherInputOutput_PopulateImagesCache",
+                                            TLArg(i, "Index"),
+                                            TLPArg(d3d11Images[i].texture, "Texture"));
+                    images.push_back(d3d11Images[i].texture);
+
+                    if (isRenderTarget) {
+                        if (isDepth) {
+                            getDepthStencilView(entry, d3d11Images[i].texture, format, 0, xr::StereoView::Count);
+                        } else {
+                            getRenderTargetView(entry, d3d11Images[i].texture, format, 0, xr::StereoView::Count);
+                        }
+                    } else {
+                        for (uint32_t slice = 0; slice < entry.createInfo.arraySize; slice++) {
+                            getShaderResourceView(entry,
+                                                  d3d11Images[i].texture,
+                                                  isDepth ? GetDepthShaderResourceFormat(format) : format,
+                                                  slice);
+                        }
+                    }
+                }
+                TraceLoggingWriteStop(local, "xrEndFrame_GatherInputOutput_PopulateImagesCache");
+            };
+
+            Swapchain& swapchainForOutput = output.state;
+            const bool useSharpeningPass = m_sharpeningStrength && !m_useFusedSharpening;
+            const DXGI_FORMAT outputFormat = (DXGI_FORMAT)swapchainForOutput.createInfo.format;
+            const XrSwapchain outputSwapchain = output.handle;
+            const XrExtent2Di outputResolution = output.extent;
+
+            ID3D11Texture2D* sourceImages[xr::StereoView::Count]{};
+            ID3D11Texture2D* sourceFocusImages[xr::StereoView::Count];
+            ID3D11Texture2D* destinationImage;
+            D3D11_TEXTURE2D_DESC sourceImagesDesc[xr::StereoView::Count]{};
+            D3D11_TEXTURE2D_DESC sourceFocusImagesDesc[xr::StereoView::Count]{};
+            // The depth of the stereo views comes first, followed by the depth of the focus views.
+            ID3D11Texture2D* sourceDepthImages[xr::QuadView::Count]{};
+            ID3D11Texture2D* destinationDepthImage{nullptr};
+            D3D11_TEXTURE2D_DESC sourceDepthImagesDesc[xr::QuadView::Count]{};
+            {
+                TraceLocalActivity(local);
+                TraceLoggingWriteStart(local, "xrEndFrame_GatherInputOutput");
+
+                // Grab the input textures.
+                for (uint32_t viewIndex = 0; viewIndex < xr::StereoView::Count; viewIndex++) {
+                    Swapchain& swapchainForStereoView = *swapchainsForStereoView[viewIndex];
+                    Swapchain& swapchainForFocusView = *swapchainsForFocusView[viewIndex];
+
+                    if (m_useQuadViews) {
+                        populateSwapchainImagesCache(swapchainForStereoView,
+                                                     swapchainForStereoView.images,
+                                                     stereoViews[viewIndex].subImage.swapchain,
+                                                     false);
+                        sourceImages[viewIndex] =
+                            swapchainForStereoView.images[swapchainForStereoView.lastReleasedIndex];
+                        sourceImages[viewIndex]->GetDesc(&sourceImagesDesc[viewIndex]);
+                    }
+                    populateSwapchainImagesCache(swapchainForFocusView,
+                                                 swapchainForFocusView.images,
+                                                 focusViews[viewIndex].subImage.swapchain,
+                                                 false);
+                    sourceFocusImages[viewIndex] =
+                        swapchainForFocusView.images[swapchainForFocusView.lastReleasedIndex];
+                    sourceFocusImages[viewIndex]->GetDesc(&sourceFocusImagesDesc[viewIndex]);
+                }
+
+                // Grab the output texture.
+                {
+                    const uint32_t acquiredImageIndex = acquireOutputSwapchainImage(output);
+
+                    populateSwapchainImagesCache(
+                        swapchainForOutput, swapchainForOutput.images, outputSwapchain, true);
+                    destinationImage = swapchainForOutput.images[acquiredImageIndex];
+                }
+
+                // Grab the depth textures.
+                if (depthInfos) {
+                    for (uint32_t i = 0; i < xr::QuadView::Count; i++) {
+                        Swapchain& swapchainForDepth = *swapchainsForDepth[i];
+                        populateSwapchainImagesCache(
+                            swapchainForDepth, swapchainForDepth.images, depthInfos[i]->subImage.swapchain, false);
+                        sourceDepthImages[i] = swapchainForDepth.images[swapchainForDepth.lastReleasedIndex];
+                        sourceDepthImages[i]->GetDesc(&sourceDepthImagesDesc[i]);
+                    }
+
+                    Swapchain& swapchainForDepthOutput = depthOutput->state;
+                    const uint32_t acquiredImageIndex = acquireOutputSwapchainImage(*depthOutput);
+                    populateSwapchainImagesCache(
+                        swapchainForDepthOutput, swapchainForDepthOutput.images, depthOutput->handle, true);
+                    destinationDepthImage = swapchainForDepthOutput.images[acquiredImageIndex];
+                }
+
+                TraceLoggingWriteStop(local, "xrEndFrame_GatherInputOutput");
+            }
+
+            if (isFrameTimingEnabled()) {
+                m_compositionTimerIndex = (m_compositionTimerIndex + 1) % std::size(m_compositionTimer);
+                // Latency is 3 frames.
+                m_lastCompositionGpuTime = m_compositionTimer[m_compositionTimerIndex]->query();
+                TraceLoggingWrite(
+                    g_traceProvider, "CompositionPerf", TLArg(m_lastCompositionGpuTime, "CompositionGpuTime"));
+                // The sharpening timer was only started if the sharpening pass ran.
+                recordCompositionStageTimes(std::exchange(m_sharpeningTimerStarted[m_compositionTimerIndex], false)
+                                                ? std::optional(m_sharpeningTimer[m_compositionTimerIndex]->query())
+                                                : std::nullopt,
+                                            m_projectionTimer[m_compositionTimerIndex]->query());
+                m_compositionTimer[m_compositionTimerIndex]->start();
+            }
+
+            // Sharpen if needed. In fused mode, the sharpening is done by the projection shader instead.
+            if (useSharpeningPass) {
+                TraceLocalActivity(local);
+                TraceLoggingWriteStart(local, "xrEndFrame_Sharpen");
+
+                if (isFrameTimingEnabled()) {
+                    m_sharpeningTimer[m_compositionTimerIndex]->start();
+                    m_sharpeningTimerStarted[m_compositionTimerIndex] = true;
+                }
+
+                m_renderContext->CSSetConstantBuffers(0, 1, m_sharpeningCSConstants.GetAddressOf());
+                m_renderContext->CSSetShader(m_sharpeningCS.Get(), nullptr, 0);
+
+                for (uint32_t viewIndex = 0; viewIndex < xr::StereoView::Count; viewIndex++) {
+                    const XrCompositionLayerProjectionView& focusView = focusViews[viewIndex];
+                    Swapchain& swapchainForFocusView = *swapchainsForFocusView[viewIndex];
+
+                    ID3D11Texture2D* const sharpenedImage =
+                        getSharpenedImage(viewIndex, focusView.subImage.imageRect.extent);
+
+                    ID3D11ShaderResourceView* srv =
+                        getShaderResourceView(swapchainForFocusView,
+                                              sourceFocusImages[viewIndex],
+                                              (DXGI_FORMAT)swapchainForFocusView.createInfo.format,
+                                              focusView.subImage.imageArrayIndex);
+                    ID3D11UnorderedAccessView* uav =
+                        getUnorderedAccessView(*m_sharpenedImages, sharpenedImage, DXGI_FORMAT_R16G16B16A16_FLOAT);
+
+                    // Set up the shader.
+                    SharpeningCSConstants sharpening;
+                    getSharpeningConstants(focusView, sharpening);
+                    {
+                        D3D11_MAPPED_SUBRESOURCE mappedResources;
+                        CHECK_HRCMD(m_renderContext->Map(
+                            m_sharpeningCSConstants.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResources));
+                        memcpy(mappedResources.pData, &sharpening, sizeof(sharpening));
+                        m_renderContext->Unmap(m_sharpeningCSConstants.Get(), 0);
+                    }
+
+                    m_renderContext->CSSetShaderResources(0, 1, &srv);
+                    m_renderContext->CSSetUnorderedAccessViews(0, 1, &uav, nullptr);
+
+                    // This value is the image region dim that each thread group of the CAS shader operates on
+                    static const int threadGroupWorkRegionDim = 16;
+                    int dispatchX = (focusView.subImage.imageRect.extent.width + (threadGroupWorkRegionDim - 1)) /
+                                    threadGroupWorkRegionDim;
+                    int dispatchY = (focusView.subImage.imageRect.extent.height + (threadGroupWorkRegionDim - 1)) /
+                                    threadGroupWorkRegionDim;
+                    m_renderContext->Dispatch((UINT)dispatchX, (UINT)dispatchY, 1);
+                }
+
+                // Unbind the resources used below to avoid D3D validation errors.
+                ID3D11UnorderedAccessView* nullUAV[] = {nullptr};
+                m_renderContext->CSSetUnorderedAccessViews(0, 1, nullUAV, nullptr);
+
+                if (isFrameTimingEnabled()) {
+                    m_sharpeningTimer[m_compositionTimerIndex]->stop();
+                }
+
+                TraceLoggingWriteStop(local, "xrEndFrame_Sharpen");
+            }
+
+            {
+                TraceLocalActivity(local);
+                TraceLoggingWriteStart(local, "xrEndFrame_Composite");
+
+                if (isFrameTimingEnabled()) {
+                    m_projectionTimer[m_compositionTimerIndex]->start();
+                }
+
+                // The stereo views of both eyes come first, followed by the focus views of both eyes.
+                ID3D11ShaderResourceView* srvs[2 * xr::StereoView::Count];
+                ProjectionVSConstants projection{};
+                ProjectionPSConstants drawing{};
+                for (uint32_t viewIndex = 0; viewIndex < xr::StereoView::Count; viewIndex++) {
+                    const XrCompositionLayerProjectionView& stereoView = stereoViews[viewIndex];
+                    const XrCompositionLayerProjectionView& focusView = focusViews[viewIndex];
+                    Swapchain& swapchainForStereoView = *swapchainsForStereoView[viewIndex];
+                    Swapchain& swapchainForFocusView = *swapchainsForFocusView[viewIndex];
+
+                    if (m_useQuadViews) {
+                        srvs[viewIndex] = getShaderResourceView(swapchainForStereoView,
+                                                                sourceImages[viewIndex],
+                                                                (DXGI_FORMAT)swapchainForStereoView.createInfo.format,
+                                                                stereoView.subImage.imageArrayIndex);
+                    } else {
+                        srvs[viewIndex] = m_srvBlankTexture.Get();
+                    }
+                    if (useSharpeningPass) {
+                        srvs[xr::StereoView::Count + viewIndex] =
+                            getShaderResourceView(*m_sharpenedImages,
+                                                  m_sharpenedImages->sharpenedImage[viewIndex].Get(),
+                                                  DXGI_FORMAT_R16G16B16A16_FLOAT,
+                                                  0);
+                    } else {
+                        srvs[xr::StereoView::Count + viewIndex] =
+                            getShaderResourceView(swapchainForFocusView,
+                                                  sourceFocusImages[viewIndex],
+                                                  (DXGI_FORMAT)swapchainForFocusView.createInfo.format,
+                                                  focusView.subImage.imageArrayIndex);
+                    }
+
+                    // Compute the projection.
+                    if (useSharpeningPass) {
+                        D3D11_TEXTURE2D_DESC desc{};
+                        m_sharpenedImages->sharpenedImage[viewIndex]->GetDesc(&desc);
+                        getProjectionConstants(viewIndex,
+                                               stereoView,
+                                               sourceImagesDesc[viewIndex],
+                                               focusView,
+                                               desc,
+                                               true,
+                                               layerFlags,
+                                               isFocusLayer,
+                                               projection,
+                                               drawing);
+                    } else {
+                        getProjectionConstants(viewIndex,
+                                               stereoView,
+                                               sourceImagesDesc[viewIndex],
+                                               focusView,
+                                               sourceFocusImagesDesc[viewIndex],
+                                               false,
+                                               layerFlags,
+                                               isFocusLayer,
+                                               projection,
+                                               drawing);
+                    }
+                }
+                ID3D11RenderTargetView* rtv =
+                    getRenderTargetView(swapchainForOutput, destinationImage, outputFormat, 0, xr::StereoView::Count);
+
+                {
+                    D3D11_MAPPED_SUBRESOURCE mappedResources;
+                    CHECK_HRCMD(m_renderContext->Map(
+                        m_projectionVSConstants.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResources));
+                    memcpy(mappedResources.pData, &projection, sizeof(projection));
+                    m_renderContext->Unmap(m_projectionVSConstants.Get(), 0);
+                }
+
+                {
+                    D3D11_MAPPED_SUBRESOURCE mappedResources;
+                    CHECK_HRCMD(m_renderContext->Map(
+                        m_projectionPSConstants.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResources));
+                    memcpy(mappedResources.pData, &drawing, sizeof(drawing));
+                    m_renderContext->Unmap(m_projectionPSConstants.Get(), 0);
+                }
+
+                // Dispatch the composition shader. Each instance draws one eye into its own array slice.
+                m_renderContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+                m_renderContext->OMSetRenderTargets(1, &rtv, nullptr);
+                m_renderContext->RSSetState(m_noDepthRasterizer.Get());
+                D3D11_VIEWPORT viewport{};
+                viewport.Width = (float)outputResolution.width;
+                viewport.Height = (float)outputResolution.height;
+                viewport.MaxDepth = 1.f;
+                m_renderContext->RSSetViewports(1, &viewport);
+                m_renderContext->VSSetConstantBuffers(0, 1, m_projectionVSConstants.GetAddressOf());
+                m_renderContext->VSSetShader(m_projectionVS.Get(), nullptr, 0);
+                m_renderContext->GSSetShader(m_projectionGS.Get(), nullptr, 0);
+                m_renderContext->PSSetConstantBuffers(0, 1, m_projectionPSConstants.GetAddressOf());
+                m_renderContext->PSSetSamplers(0, 1, m_linearClampSampler.GetAddressOf());
+                m_renderContext->PSSetShaderResources(0, (UINT)std::size(srvs), srvs);
+                m_renderContext->PSSetShader(m_projectionPS.Get(), nullptr, 0);
+                m_renderContext->DrawInstanced(3, xr::StereoView::Count, 0, 0);
+
+                if (m_debugEyeGaze && !isFocusLayer) {
+                    for (uint32_t viewIndex = 0; viewIndex < xr::StereoView::Count; viewIndex++) {
+                        XrOffset2Di eyeGaze; // Screen coordinates.
+                        eyeGaze.x = (uint32_t)(m_fullFovRenderResolution.width * (m_eyeGaze[viewIndex].x + 1.f) / 2.f);
+                        eyeGaze.y = (uint32_t)(m_fullFovRenderResolution.height * (1.f - m_eyeGaze[viewIndex].y) / 2.f);
+
+                        const float color[] = {0.5f, 0, 0.5f, 1};
+                        D3D11_RECT rect;
+                        rect.left = eyeGaze.x - 10;
+                        rect.right = eyeGaze.x + 10;
+                        rect.top = eyeGaze.y - 10;
+                        rect.bottom = eyeGaze.y + 10;
+                        m_renderContext->ClearView(
+                            getRenderTargetView(swapchainForOutput, destinationImage, outputFormat, viewIndex),
+                            color,
+                            &rect,
+                            1);
+                    }
+                }
+
+                if (isFrameTimingEnabled()) {
+                    m_projectionTimer[m_compositionTimerIndex]->stop();
+                }
+
+                TraceLoggingWriteStop(local, "xrEndFrame_Composite");
+            }
+
+            // Composite the depth with the same projection. The pipeline state is inherited from the color pass.
+            if (depthInfos) {
+                TraceLocalActivity(local);
+                TraceLoggingWriteStart(local, "xrEndFrame_CompositeDepth");
+
+                ID3D11ShaderResourceView* srvs[xr::QuadView::Count];
+                for (uint32_t i = 0; i < xr::QuadView::Count; i++) {
+                    Swapchain& swapchainForDepth = *swapchainsForDepth[i];
+                    srvs[i] = getShaderResourceView(
+                        swapchainForDepth,
+                        sourceDepthImages[i],
+                        GetDepthShaderResourceFormat((DXGI_FORMAT)swapchainForDepth.createInfo.format),
+                        depthInfos[i]->subImage.imageArrayIndex);
+                }
+
+                ProjectionVSConstants projection{};
+                ProjectionPSConstants drawing{};
+                for (uint32_t viewIndex = 0; viewIndex < xr::StereoView::Count; viewIndex++) {
+                    // The depth images are projected like the color images, but they have their own image rects.
+                    XrCompositionLayerProjectionView stereoDepthView = stereoViews[viewIndex];
+                    stereoDepthView.subImage = depthInfos[viewIndex]->subImage;
+                    XrCompositionLayerProjectionView focusDepthView = focusViews[viewIndex];
+                    focusDepthView.subImage = depthInfos[xr::StereoView::Count + viewIndex]->subImage;
+                    getProjectionConstants(viewIndex,
+                                           stereoDepthView,
+                                           sourceDepthImagesDesc[viewIndex],
+                                           focusDepthView,
+                                           sourceDepthImagesDesc[xr::StereoView::Count + viewIndex],
+                                           false,
+                                           0,
+                                           false,
+                                           projection,
+                                           drawing);
+                }
+                Swapchain& swapchainForDepthOutput = depthOutput->state;
+                ID3D11DepthStencilView* dsv =
+                    getDepthStencilView(swapchainForDepthOutput,
+                                        destinationDepthImage,
+                                        (DXGI_FORMAT)swapchainForDepthOutput.createInfo.format,
+                                        0,
+                                        xr::StereoView::Count);
+
+                {
+                    D3D11_MAPPED_SUBRESOURCE mappedResources;
+                    CHECK_HRCMD(m_renderContext->Map(
+                        m_projectionVSConstants.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResources));
+                    memcpy(mappedResources.pData, &projection, sizeof(projection));
+                    m_renderContext->Unmap(m_projectionVSConstants.Get(), 0);
+                }
+
+                {
+                    D3D11_MAPPED_SUBRESOURCE mappedResources;
+                    CHECK_HRCMD(m_renderContext->Map(
+                        m_projectionPSConstants.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResources));
+                    memcpy(mappedResources.pData, &drawing, sizeof(drawing));
+                    m_renderContext->Unmap(m_projectionPSConstants.Get(), 0);
+                }
+
+                const XrExtent2Di depthResolution = depthOutput->extent;
+                m_renderContext->OMSetRenderTargets(0, nullptr, dsv);
+                m_renderContext->OMSetDepthStencilState(m_depthWriteState.Get(), 0);
+                D3D11_VIEWPORT viewport{};
+                viewport.Width = (float)depthResolution.width;
+                viewport.Height = (float)depthResolution.height;
+                viewport.MaxDepth = 1.f;
+                m_renderContext->RSSetViewports(1, &viewport);
+                m_renderContext->PSSetShaderResources(0, (UINT)std::size(srvs), srvs);
+                m_renderContext->PSSetShader(m_depthProjectionPS.Get(), nullptr, 0);
+                m_renderContext->DrawInstanced(3, xr::StereoView::Count, 0, 0);
+
+                TraceLoggingWriteStop(local, "xrEndFrame_CompositeDepth");
+            }
+
+            if (isFrameTimingEnabled()) {
+                m_compositionTimer[m_compositionTimerIndex]->stop();
+            }
 
-        void compositeViewContent(uint32_t viewIndex,
-                                  const XrCompositionLayerProjectionView& stereoView,
-                                  Swapchain& swapchainForStereoView,
-                                  const XrCompositionLayerProjectionView& focusView,
-                                  Swapchain& swapchainForFocusView,
-                                  XrCompositionLayerFlags layerFlags) {
-            // TODO: Support D3D12.
+            releaseOutputSwapchainImage(outputSwapchain);
+            if (depthInfos) {
+                releaseOutputSwapchainImage(depthOutput->handle);
+            }
+        }
 
-            // Lazy initialization of the composition resources.
-            if (!m_projectionPS) {
-                initializeCompositionResources(m_applicationDevice.Get());
+        void compositeViewContentD3D12(const XrCompositionLayerProjectionView* stereoViews,
+                                       Swapchain* const* swapchainsForStereoView,
+                                       const XrCompositionLayerProjectionView* focusViews,
+                                       Swapchain* const* swapchainsForFocusView,
+                                       XrCompositionLayerFlags layerFlags,
+                                       bool isFocusLayer,
+                                       PooledSwapchain& output,
+                                       const XrCompositionLayerDepthInfoKHR* const* depthInfos,
+                                       Swapchain* const* swapchainsForDepth,
+                                       PooledSwapchain* depthOutput) {
+            // Lazy initialization of the composition resources, unless they were compiled in the background.
+            waitForCompositionWarmUp();
+            if (!m_d3d12ProjectionRootSignature) {
+                initializeCompositionResources(m_d3d12ApplicationDevice.Get());
             }
 
-            const auto populateSwapchainImagesCache = [&](std::vector<ID3D11Texture2D*>& images,
-                                                          XrSwapchain swapchain) {
+            // Populate the images cache and create all the persistent descriptors upfront.
+            const auto populateSwapchainImagesCache = [&](Swapchain& entry,
+                                                          std::vector<ID3D12Resource*>& images,
+                                                          XrSwapchain swapchain,
+                                                          bool isRenderTarget) {
                 if (!images.empty()) {
                     return;
                 }
@@ -2235,324 +4874,644 @@ namespace openxr_api_layer {
                 TraceLoggingWriteStart(
                     local, "xrEndFrame_GatherInputOutput_PopulateImagesCache", TLXArg(swapchain, "Swapchain"));
                 uint32_t count;
-                CHECK_XRCMD(OpenXrApi::xrEnumerateSwapchainImages(swapchain, 0, &count, nullptr));
-                std::vector<XrSwapchainImageD3D11KHR> d3d11Images(count, {XR_TYPE_SWAPCHAIN_IMAGE_D3D11_KHR});
-                CHECK_XRCMD(OpenXrApi::xrEnumerateSwapchainImages(
-                    swapchain, count, &count, reinterpret_cast<XrSwapchainImageBaseHeader*>(d3d11Images.data())));
+                CHECK_XRCMD(LayerOverheadScope::chainDownstream(
+                    [&] { return OpenXrApi::xrEnumerateSwapchainImages(swapchain, 0, &count, nullptr); }));
+                std::vector<XrSwapchainImageD3D12KHR> d3d12Images(count, {XR_TYPE_SWAPCHAIN_IMAGE_D3D12_KHR});
+                CHECK_XRCMD(LayerOverheadScope::chainDownstream([&] {
+                    return OpenXrApi::xrEnumerateSwapchainImages(
+                        swapchain, count, &count, reinterpret_cast<XrSwapchainImageBaseHeader*>(d3d12Images.data()));
+                }));
+                const DXGI_FORMAT format = (DXGI_FORMAT)entry.createInfo.format;
+                const bool isDepth = entry.createInfo.usageFlags & XR_SWAPCHAIN_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
                 for (uint32_t i = 0; i < count; i++) {
                     TraceLoggingWriteTagged(local,
                                             "xrEndFrame_GatherInputOutput_PopulateImagesCache",
                                             TLArg(i, "Index"),
-                                            TLPArg(d3d11Images[i].texture, "Texture"));
-                    images.push_back(d3d11Images[i].texture);
+                                            TLPArg(d3d12Images[i].texture, "Texture"));
+                    images.push_back(d3d12Images[i].texture);
+
+                    if (isRenderTarget) {
+                        if (isDepth) {
+                            getDepthStencilDescriptor(entry, d3d12Images[i].texture, format, 0, xr::StereoView::Count);
+                        } else {
+                            getRenderTargetDescriptor(entry, d3d12Images[i].texture, format, 0, xr::StereoView::Count);
+                        }
+                    } else {
+                        for (uint32_t slice = 0; slice < entry.createInfo.arraySize; slice++) {
+                            getShaderResourceDescriptor(entry,
+                                                        d3d12Images[i].texture,
+                                                        isDepth ? GetDepthShaderResourceFormat(format) : format,
+                                                        slice);
+                        }
+                    }
                 }
                 TraceLoggingWriteStop(local, "xrEndFrame_GatherInputOutput_PopulateImagesCache");
             };
 
-            ID3D11Texture2D* sourceImage = nullptr;
-            ID3D11Texture2D* sourceFocusImage;
-            ID3D11Texture2D* destinationImage;
+            Swapchain& swapchainForOutput = output.state;
+            const bool useSharpeningPass = m_sharpeningStrength && !m_useFusedSharpening;
+            const DXGI_FORMAT outputFormat = (DXGI_FORMAT)swapchainForOutput.createInfo.format;
+            const XrSwapchain outputSwapchain = output.handle;
+            const XrExtent2Di outputResolution = output.extent;
+
+            ID3D12Resource* sourceImages[xr::StereoView::Count]{};
+            ID3D12Resource* sourceFocusImages[xr::StereoView::Count];
+            ID3D12Resource* destinationImage;
+            D3D12_RESOURCE_DESC sourceImagesDesc[xr::StereoView::Count]{};
+            D3D12_RESOURCE_DESC sourceFocusImagesDesc[xr::StereoView::Count]{};
+            // The depth of the stereo views comes first, followed by the depth of the focus views.
+            ID3D12Resource* sourceDepthImages[xr::QuadView::Count]{};
+            ID3D12Resource* destinationDepthImage{nullptr};
+            D3D12_RESOURCE_DESC sourceDepthImagesDesc[xr::QuadView::Count]{};
+            // The application images read by this composition, for async composition.
+            std::pair<Swapchain*, uint32_t> sourceImageIndices[2 * xr::StereoView::Count + xr::QuadView::Count];
+            uint32_t sourceImageCount = 0;
+            const auto readSourceImage = [&](Swapchain& swapchain) {
+                const uint32_t index = swapchain.lastReleasedIndex;
+                sourceImageIndices[sourceImageCount++] = {&swapchain, index};
+                return swapchain.d3d12Images[index];
+            };
             {
                 TraceLocalActivity(local);
                 TraceLoggingWriteStart(local, "xrEndFrame_GatherInputOutput");
 
                 // Grab the input textures.
-                if (m_useQuadViews) {
-                    populateSwapchainImagesCache(swapchainForStereoView.images, stereoView.subImage.swapchain);
-                    sourceImage = swapchainForStereoView.images[swapchainForStereoView.lastReleasedIndex];
+                for (uint32_t viewIndex = 0; viewIndex < xr::StereoView::Count; viewIndex++) {
+                    Swapchain& swapchainForStereoView = *swapchainsForStereoView[viewIndex];
+                    Swapchain& swapchainForFocusView = *swapchainsForFocusView[viewIndex];
+
+                    if (m_useQuadViews) {
+                        populateSwapchainImagesCache(swapchainForStereoView,
+                                                     swapchainForStereoView.d3d12Images,
+                                                     stereoViews[viewIndex].subImage.swapchain,
+                                                     false);
+                        sourceImages[viewIndex] = readSourceImage(swapchainForStereoView);
+                        sourceImagesDesc[viewIndex] = sourceImages[viewIndex]->GetDesc();
+                    }
+                    populateSwapchainImagesCache(swapchainForFocusView,
+                                                 swapchainForFocusView.d3d12Images,
+                                                 focusViews[viewIndex].subImage.swapchain,
+                                                 false);
+                    sourceFocusImages[viewIndex] = readSourceImage(swapchainForFocusView);
+                    sourceFocusImagesDesc[viewIndex] = sourceFocusImages[viewIndex]->GetDesc();
                 }
-                populateSwapchainImagesCache(swapchainForFocusView.images, focusView.subImage.swapchain);
-                sourceFocusImage = swapchainForFocusView.images[swapchainForFocusView.lastReleasedIndex];
 
                 // Grab the output texture.
                 {
-                    TraceLoggingWriteTagged(local,
-                                            "xrEndFrame_GatherInputOutput_AcquireOutput",
-                                            TLXArg(swapchainForStereoView.fullFovSwapchain[viewIndex], "Swapchain"));
-                    uint32_t acquiredImageIndex;
-                    CHECK_XRCMD(OpenXrApi::xrAcquireSwapchainImage(
-                        swapchainForStereoView.fullFovSwapchain[viewIndex], nullptr, &acquiredImageIndex));
-                    XrSwapchainImageWaitInfo waitInfo{XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO};
-                    waitInfo.timeout = 10000000000;
-                    TraceLoggingWriteTagged(local,
-                                            "xrEndFrame_GatherInputOutput_WaitOutput",
-                                            TLXArg(swapchainForStereoView.fullFovSwapchain[viewIndex], "Swapchain"));
-                    CHECK_XRCMD(
-                        OpenXrApi::xrWaitSwapchainImage(swapchainForStereoView.fullFovSwapchain[viewIndex], &waitInfo));
+                    const uint32_t acquiredImageIndex = acquireOutputSwapchainImage(output);
+
+                    populateSwapchainImagesCache(
+                        swapchainForOutput, swapchainForOutput.d3d12Images, outputSwapchain, true);
+                    destinationImage = swapchainForOutput.d3d12Images[acquiredImageIndex];
+                }
+
+                // Grab the depth textures.
+                if (depthInfos) {
+                    for (uint32_t i = 0; i < xr::QuadView::Count; i++) {
+                        Swapchain& swapchainForDepth = *swapchainsForDepth[i];
+                        populateSwapchainImagesCache(
+                            swapchainForDepth, swapchainForDepth.d3d12Images, depthInfos[i]->subImage.swapchain, false);
+                        sourceDepthImages[i] = readSourceImage(swapchainForDepth);
+                        sourceDepthImagesDesc[i] = sourceDepthImages[i]->GetDesc();
+                    }
 
-                    populateSwapchainImagesCache(swapchainForStereoView.fullFovSwapchainImages[viewIndex],
-                                                 swapchainForStereoView.fullFovSwapchain[viewIndex]);
-                    destinationImage = swapchainForStereoView.fullFovSwapchainImages[viewIndex][acquiredImageIndex];
+                    Swapchain& swapchainForDepthOutput = depthOutput->state;
+                    const uint32_t acquiredImageIndex = acquireOutputSwapchainImage(*depthOutput);
+                    populateSwapchainImagesCache(
+                        swapchainForDepthOutput, swapchainForDepthOutput.d3d12Images, depthOutput->handle, true);
+                    destinationDepthImage = swapchainForDepthOutput.d3d12Images[acquiredImageIndex];
                 }
 
                 TraceLoggingWriteStop(local, "xrEndFrame_GatherInputOutput");
             }
 
-            if (IsTraceEnabled()) {
-                m_compositionTimerIndex = (m_compositionTimerIndex + 1) % std::size(m_compositionTimer);
-                // Latency is 3 frames.
-                TraceLoggingWrite(g_traceProvider,
-                                  "CompositionPerf",
-                                  TLArg(m_compositionTimer[m_compositionTimerIndex]->query(), "CompositionGpuTime"));
-                m_compositionTimer[m_compositionTimerIndex]->start();
+            // Grab the next composition context, and make sure the GPU is done with its previous use.
+            const uint32_t contextIndex = m_d3d12CompositionContextIndex;
+            m_d3d12CompositionContextIndex =
+                (m_d3d12CompositionContextIndex + 1) % std::size(m_d3d12CompositionContext);
+            D3D12CompositionContext& context = m_d3d12CompositionContext[contextIndex];
+            waitForD3D12Composition(context.completedFenceValue);
+            if (context.hasTimestamps) {
+                // The timestamps of the previous use of this context are now available.
+                readD3D12CompositionTimestamps(contextIndex, context.hasSharpeningPass);
+                context.hasTimestamps = false;
             }
+            CHECK_HRCMD(context.allocator->Reset());
+            CHECK_HRCMD(context.commandList->Reset(context.allocator.Get(), nullptr));
+            ID3D12GraphicsCommandList* const commandList = context.commandList.Get();
+
+            // Each context owns a slice of the constant buffer and of the shader-visible descriptor heap.
+            uint8_t* const mappedConstants = m_d3d12MappedConstants + contextIndex * D3D12ConstantsPerContext *
+                                                                         D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
+            const D3D12_GPU_VIRTUAL_ADDRESS constantsAddress =
+                m_d3d12ConstantsBuffer->GetGPUVirtualAddress() +
+                contextIndex * D3D12ConstantsPerContext * D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
+            const auto getConstantsOffset = [](D3D12ConstantsSlot slot, uint32_t viewIndex = 0) {
+                return ((uint32_t)slot + viewIndex) * D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
+            };
+            // The sharpening descriptors are allocated in input/output pairs.
+            const auto getDescriptorOffset = [&](D3D12DescriptorSlot slot, uint32_t viewIndex) {
+                const uint32_t stride = slot < D3D12DescriptorSlot::StereoInput ? 2 : 1;
+                return (contextIndex * D3D12DescriptorsPerContext + (uint32_t)slot + viewIndex * stride) *
+                       m_d3d12ResourceDescriptorSize;
+            };
+            const auto getCpuDescriptor = [&](D3D12DescriptorSlot slot, uint32_t viewIndex = 0) {
+                D3D12_CPU_DESCRIPTOR_HANDLE handle = m_d3d12ResourceHeap->GetCPUDescriptorHandleForHeapStart();
+                handle.ptr += getDescriptorOffset(slot, viewIndex);
+                return handle;
+            };
+            const auto getGpuDescriptor = [&](D3D12DescriptorSlot slot, uint32_t viewIndex = 0) {
+                D3D12_GPU_DESCRIPTOR_HANDLE handle = m_d3d12ResourceHeap->GetGPUDescriptorHandleForHeapStart();
+                handle.ptr += getDescriptorOffset(slot, viewIndex);
+                return handle;
+            };
 
-            // Copy to a flat texture for sampling.
-            {
-                TraceLocalActivity(local);
-                TraceLoggingWriteStart(local, "xrEndFrame_Flatten");
-
-                const auto flattenSourceImage = [&](ID3D11Texture2D* image,
-                                                    const XrCompositionLayerProjectionView& view,
-                                                    Swapchain& swapchain,
-                                                    uint32_t startSlot) {
-                    D3D11_TEXTURE2D_DESC desc{};
-                    if (swapchain.flatImage[startSlot + viewIndex]) {
-                        swapchain.flatImage[startSlot + viewIndex]->GetDesc(&desc);
-                    }
-                    if (!swapchain.flatImage[startSlot + viewIndex] ||
-                        desc.Width != view.subImage.imageRect.extent.width ||
-                        desc.Height != view.subImage.imageRect.extent.height) {
-                        desc = {};
-                        desc.ArraySize = 1;
-                        desc.Width = view.subImage.imageRect.extent.width;
-                        desc.Height = view.subImage.imageRect.extent.height;
-                        desc.Format = (DXGI_FORMAT)swapchain.createInfo.format;
-                        desc.MipLevels = 1;
-                        desc.SampleDesc.Count = 1;
-                        desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-                        CHECK_HRCMD(m_applicationDevice->CreateTexture2D(
-                            &desc, nullptr, swapchain.flatImage[startSlot + viewIndex].ReleaseAndGetAddressOf()));
-                    }
-                    D3D11_BOX box{};
-                    box.left = view.subImage.imageRect.offset.x;
-                    box.top = view.subImage.imageRect.offset.y;
-                    box.right = box.left + view.subImage.imageRect.extent.width;
-                    box.bottom = box.top + view.subImage.imageRect.extent.height;
-                    box.back = 1;
-                    m_renderContext->CopySubresourceRegion(swapchain.flatImage[startSlot + viewIndex].Get(),
-                                                           0,
-                                                           0,
-                                                           0,
-                                                           0,
-                                                           image,
-                                                           view.subImage.imageArrayIndex,
-                                                           &box);
-                };
-                // TODO: We could reduce overhead by avoiding these 2 copies and modifying sampling in our shader to
-                // consider the offset.
-                if (m_useQuadViews) {
-                    flattenSourceImage(sourceImage, stereoView, swapchainForStereoView, 0);
-                }
-                flattenSourceImage(sourceFocusImage, focusView, swapchainForFocusView, xr::StereoView::Count);
-
-                TraceLoggingWriteStop(local, "xrEndFrame_Flatten");
-            }
-
-            // Sharpen if needed.
-            if (m_sharpenFocusView) {
+            ID3D12DescriptorHeap* const heaps[] = {m_d3d12ResourceHeap.Get()};
+            commandList->SetDescriptorHeaps(1, heaps);
+
+            // Transition the application images for reading. The stereo and focus views may share the same images.
+            D3D12_RESOURCE_BARRIER barriers[2 * xr::StereoView::Count];
+            uint32_t barrierCount = 0;
+            const auto addSourceImageBarrier = [&](ID3D12Resource* image) {
+                if (!image) {
+                    return;
+                }
+                for (uint32_t i = 0; i < barrierCount; i++) {
+                    if (barriers[i].Transition.pResource == image) {
+                        return;
+                    }
+                }
+                barriers[barrierCount++] = GetTransitionBarrier(
+                    image,
+                    D3D12_RESOURCE_STATE_RENDER_TARGET,
+                    D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+            };
+            for (uint32_t viewIndex = 0; viewIndex < xr::StereoView::Count; viewIndex++) {
+                addSourceImageBarrier(sourceImages[viewIndex]);
+                addSourceImageBarrier(sourceFocusImages[viewIndex]);
+            }
+            commandList->ResourceBarrier(barrierCount, barriers);
+
+            // Timestamps delimiting each stage of the composition.
+            const bool useTimestamps = isFrameTimingEnabled();
+            const uint32_t timestampBase = contextIndex * D3D12TimestampsPerContext;
+            if (useTimestamps) {
+                commandList->EndQuery(m_d3d12TimestampQueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, timestampBase);
+            }
+
+            // Sharpen if needed. In fused mode, the sharpening is done by the projection shader instead.
+            if (useSharpeningPass) {
                 TraceLocalActivity(local);
                 TraceLoggingWriteStart(local, "xrEndFrame_Sharpen");
 
-                {
-                    D3D11_TEXTURE2D_DESC desc{};
-                    if (swapchainForFocusView.sharpenedImage[viewIndex]) {
-                        swapchainForFocusView.sharpenedImage[viewIndex]->GetDesc(&desc);
-                    }
-                    if (!swapchainForFocusView.sharpenedImage[viewIndex] ||
-                        desc.Width != focusView.subImage.imageRect.extent.width ||
-                        desc.Height != focusView.subImage.imageRect.extent.height) {
-                        desc = {};
-                        desc.ArraySize = 1;
-                        desc.Width = focusView.subImage.imageRect.extent.width;
-                        desc.Height = focusView.subImage.imageRect.extent.height;
-                        desc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
-                        desc.MipLevels = 1;
-                        desc.SampleDesc.Count = 1;
-                        desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
-                        CHECK_HRCMD(m_applicationDevice->CreateTexture2D(
-                            &desc, nullptr, swapchainForFocusView.sharpenedImage[viewIndex].ReleaseAndGetAddressOf()));
-                    }
-                }
-
-                // Create ephemeral SRV/UAV.
-                ComPtr<ID3D11ShaderResourceView> srv;
-                {
-                    D3D11_SHADER_RESOURCE_VIEW_DESC desc{};
-                    desc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-                    desc.Format = (DXGI_FORMAT)swapchainForFocusView.createInfo.format;
-                    desc.Texture2D.MipLevels = 1;
-                    CHECK_HRCMD(m_applicationDevice->CreateShaderResourceView(
-                        swapchainForFocusView.flatImage[xr::StereoView::Count + viewIndex].Get(),
-                        &desc,
-                        srv.ReleaseAndGetAddressOf()));
-                }
-                ComPtr<ID3D11UnorderedAccessView> uav;
-                {
-                    D3D11_UNORDERED_ACCESS_VIEW_DESC desc{};
-                    desc.ViewDimension = D3D11_UAV_DIMENSION_TEXTURE2D;
-                    desc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
-                    CHECK_HRCMD(m_applicationDevice->CreateUnorderedAccessView(
-                        swapchainForFocusView.sharpenedImage[viewIndex].Get(), &desc, uav.ReleaseAndGetAddressOf()));
+                D3D12_RESOURCE_BARRIER sharpenedImageBarriers[xr::StereoView::Count];
+                for (uint32_t viewIndex = 0; viewIndex < xr::StereoView::Count; viewIndex++) {
+                    const XrCompositionLayerProjectionView& focusView = focusViews[viewIndex];
+                    Swapchain& swapchainForFocusView = *swapchainsForFocusView[viewIndex];
+
+                    ID3D12Resource* const sharpenedImage =
+                        getD3D12SharpenedImage(viewIndex, focusView.subImage.imageRect.extent);
+
+                    // Gather the SRV/UAV.
+                    m_d3d12ApplicationDevice->CopyDescriptorsSimple(
+                        1,
+                        getCpuDescriptor(D3D12DescriptorSlot::SharpeningInput, viewIndex),
+                        getShaderResourceDescriptor(swapchainForFocusView,
+                                                    sourceFocusImages[viewIndex],
+                                                    (DXGI_FORMAT)swapchainForFocusView.createInfo.format,
+                                                    focusView.subImage.imageArrayIndex),
+                        D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+                    m_d3d12ApplicationDevice->CopyDescriptorsSimple(
+                        1,
+                        getCpuDescriptor(D3D12DescriptorSlot::SharpeningOutput, viewIndex),
+                        getUnorderedAccessDescriptor(
+                            *m_sharpenedImages, sharpenedImage, DXGI_FORMAT_R16G16B16A16_FLOAT),
+                        D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+                    SharpeningCSConstants sharpening;
+                    getSharpeningConstants(focusView, sharpening);
+                    memcpy(mappedConstants + getConstantsOffset(D3D12ConstantsSlot::Sharpening, viewIndex),
+                           &sharpening,
+                           sizeof(sharpening));
+
+                    sharpenedImageBarriers[viewIndex] =
+                        GetTransitionBarrier(sharpenedImage,
+                                             D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+                                             D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
                 }
+                commandList->ResourceBarrier((UINT)std::size(sharpenedImageBarriers), sharpenedImageBarriers);
 
                 // Set up the shader.
-                SharpeningCSConstants sharpening{};
-                CasSetup(sharpening.Const0,
-                         sharpening.Const1,
-                         std::clamp(m_sharpenFocusView, 0.f, 1.f),
-                         (AF1)focusView.subImage.imageRect.extent.width,
-                         (AF1)focusView.subImage.imageRect.extent.height,
-                         (AF1)focusView.subImage.imageRect.extent.width,
-                         (AF1)focusView.subImage.imageRect.extent.height);
-                {
-                    D3D11_MAPPED_SUBRESOURCE mappedResources;
-                    CHECK_HRCMD(m_renderContext->Map(
-                        m_sharpeningCSConstants.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResources));
-                    memcpy(mappedResources.pData, &sharpening, sizeof(sharpening));
-                    m_renderContext->Unmap(m_sharpeningCSConstants.Get(), 0);
+                commandList->SetComputeRootSignature(m_d3d12SharpeningRootSignature.Get());
+                commandList->SetPipelineState(m_d3d12SharpeningPSO.Get());
+
+                for (uint32_t viewIndex = 0; viewIndex < xr::StereoView::Count; viewIndex++) {
+                    const XrCompositionLayerProjectionView& focusView = focusViews[viewIndex];
+
+                    commandList->SetComputeRootConstantBufferView(
+                        0, constantsAddress + getConstantsOffset(D3D12ConstantsSlot::Sharpening, viewIndex));
+                    commandList->SetComputeRootDescriptorTable(
+                        1, getGpuDescriptor(D3D12DescriptorSlot::SharpeningInput, viewIndex));
+
+                    // This value is the image region dim that each thread group of the CAS shader operates on
+                    static const int threadGroupWorkRegionDim = 16;
+                    int dispatchX = (focusView.subImage.imageRect.extent.width + (threadGroupWorkRegionDim - 1)) /
+                                    threadGroupWorkRegionDim;
+                    int dispatchY = (focusView.subImage.imageRect.extent.height + (threadGroupWorkRegionDim - 1)) /
+                                    threadGroupWorkRegionDim;
+                    commandList->Dispatch((UINT)dispatchX, (UINT)dispatchY, 1);
                 }
 
-                m_renderContext->CSSetConstantBuffers(0, 1, m_sharpeningCSConstants.GetAddressOf());
-                m_renderContext->CSSetShaderResources(0, 1, srv.GetAddressOf());
-                m_renderContext->CSSetUnorderedAccessViews(0, 1, uav.GetAddressOf(), nullptr);
-                m_renderContext->CSSetShader(m_sharpeningCS.Get(), nullptr, 0);
-
-                // This value is the image region dim that each thread group of the CAS shader operates on
-                static const int threadGroupWorkRegionDim = 16;
-                int dispatchX = (focusView.subImage.imageRect.extent.width + (threadGroupWorkRegionDim - 1)) /
-                                threadGroupWorkRegionDim;
-                int dispatchY = (focusView.subImage.imageRect.extent.height + (threadGroupWorkRegionDim - 1)) /
-                                threadGroupWorkRegionDim;
-                m_renderContext->Dispatch((UINT)dispatchX, (UINT)dispatchY, 1);
-
-                // Unbind the resources used below to avoid D3D validation errors.
-                ID3D11UnorderedAccessView* nullUAV[] = {nullptr};
-                m_renderContext->CSSetUnorderedAccessViews(0, 1, nullUAV, nullptr);
+                for (D3D12_RESOURCE_BARRIER& barrier : sharpenedImageBarriers) {
+                    std::swap(barrier.Transition.StateBefore, barrier.Transition.StateAfter);
+                }
+                commandList->ResourceBarrier((UINT)std::size(sharpenedImageBarriers), sharpenedImageBarriers);
 
                 TraceLoggingWriteStop(local, "xrEndFrame_Sharpen");
             }
 
+            if (useTimestamps) {
+                commandList->EndQuery(m_d3d12TimestampQueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, timestampBase + 1);
+            }
+
             {
                 TraceLocalActivity(local);
                 TraceLoggingWriteStart(local, "xrEndFrame_Composite");
 
-                // Create ephemeral SRV/RTV.
-                ComPtr<ID3D11ShaderResourceView> srvForStereoView;
-                if (m_useQuadViews) {
-                    D3D11_SHADER_RESOURCE_VIEW_DESC desc{};
-                    desc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-                    desc.Format = (DXGI_FORMAT)swapchainForStereoView.createInfo.format;
-                    desc.Texture2D.MipLevels = 1;
-                    CHECK_HRCMD(
-                        m_applicationDevice->CreateShaderResourceView(swapchainForStereoView.flatImage[viewIndex].Get(),
-                                                                      &desc,
-                                                                      srvForStereoView.ReleaseAndGetAddressOf()));
-                } else {
-                    srvForStereoView = m_srvBlankTexture;
+                // Gather the SRVs and compute the projection for each eye.
+                ProjectionVSConstants projection{};
+                ProjectionPSConstants drawing{};
+                for (uint32_t viewIndex = 0; viewIndex < xr::StereoView::Count; viewIndex++) {
+                    const XrCompositionLayerProjectionView& stereoView = stereoViews[viewIndex];
+                    const XrCompositionLayerProjectionView& focusView = focusViews[viewIndex];
+                    Swapchain& swapchainForStereoView = *swapchainsForStereoView[viewIndex];
+                    Swapchain& swapchainForFocusView = *swapchainsForFocusView[viewIndex];
+
+                    m_d3d12ApplicationDevice->CopyDescriptorsSimple(
+                        1,
+                        getCpuDescriptor(D3D12DescriptorSlot::StereoInput, viewIndex),
+                        m_useQuadViews
+                            ? getShaderResourceDescriptor(swapchainForStereoView,
+                                                          sourceImages[viewIndex],
+                                                          (DXGI_FORMAT)swapchainForStereoView.createInfo.format,
+                                                          stereoView.subImage.imageArrayIndex)
+                            : m_d3d12SrvBlankTexture->GetCPUDescriptorHandleForHeapStart(),
+                        D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+                    m_d3d12ApplicationDevice->CopyDescriptorsSimple(
+                        1,
+                        getCpuDescriptor(D3D12DescriptorSlot::FocusInput, viewIndex),
+                        useSharpeningPass
+                            ? getShaderResourceDescriptor(*m_sharpenedImages,
+                                                          m_sharpenedImages->d3d12SharpenedImage[viewIndex].Get(),
+                                                          DXGI_FORMAT_R16G16B16A16_FLOAT,
+                                                          0)
+                            : getShaderResourceDescriptor(swapchainForFocusView,
+                                                          sourceFocusImages[viewIndex],
+                                                          (DXGI_FORMAT)swapchainForFocusView.createInfo.format,
+                                                          focusView.subImage.imageArrayIndex),
+                        D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+                    if (useSharpeningPass) {
+                        const D3D12_RESOURCE_DESC desc =
+                            m_sharpenedImages->d3d12SharpenedImage[viewIndex]->GetDesc();
+                        getProjectionConstants(viewIndex,
+                                               stereoView,
+                                               sourceImagesDesc[viewIndex],
+                                               focusView,
+                                               desc,
+                                               true,
+                                               layerFlags,
+                                               isFocusLayer,
+                                               projection,
+                                               drawing);
+                    } else {
+                        getProjectionConstants(viewIndex,
+                                               stereoView,
+                                               sourceImagesDesc[viewIndex],
+                                               focusView,
+                                               sourceFocusImagesDesc[viewIndex],
+                                               false,
+                                               layerFlags,
+                                               isFocusLayer,
+                                               projection,
+                                               drawing);
+                    }
                 }
-                ComPtr<ID3D11ShaderResourceView> srvForFocusView;
-                {
-                    D3D11_SHADER_RESOURCE_VIEW_DESC desc{};
-                    desc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-                    desc.Format = m_sharpenFocusView ? DXGI_FORMAT_R16G16B16A16_FLOAT
-                                                     : (DXGI_FORMAT)swapchainForFocusView.createInfo.format;
-                    desc.Texture2D.MipLevels = 1;
-                    CHECK_HRCMD(m_applicationDevice->CreateShaderResourceView(
-                        m_sharpenFocusView ? swapchainForFocusView.sharpenedImage[viewIndex].Get()
-                                           : swapchainForFocusView.flatImage[xr::StereoView::Count + viewIndex].Get(),
-                        &desc,
-                        srvForFocusView.ReleaseAndGetAddressOf()));
+                const D3D12_CPU_DESCRIPTOR_HANDLE rtv = getRenderTargetDescriptor(
+                    swapchainForOutput, destinationImage, outputFormat, 0, xr::StereoView::Count);
+
+                memcpy(mappedConstants + getConstantsOffset(D3D12ConstantsSlot::ProjectionVS),
+                       &projection,
+                       sizeof(projection));
+                memcpy(mappedConstants + getConstantsOffset(D3D12ConstantsSlot::ProjectionPS),
+                       &drawing,
+                       sizeof(drawing));
+
+                // Dispatch the composition shader. Each instance draws one eye into its own array slice.
+                commandList->SetGraphicsRootSignature(m_d3d12ProjectionRootSignature.Get());
+                commandList->SetPipelineState(getProjectionPipelineState(outputFormat));
+                commandList->SetGraphicsRootConstantBufferView(
+                    0, constantsAddress + getConstantsOffset(D3D12ConstantsSlot::ProjectionVS));
+                commandList->SetGraphicsRootConstantBufferView(
+                    1, constantsAddress + getConstantsOffset(D3D12ConstantsSlot::ProjectionPS));
+                commandList->SetGraphicsRootDescriptorTable(2, getGpuDescriptor(D3D12DescriptorSlot::StereoInput));
+                commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+                commandList->OMSetRenderTargets(1, &rtv, FALSE, nullptr);
+                D3D12_VIEWPORT viewport{};
+                viewport.Width = (float)outputResolution.width;
+                viewport.Height = (float)outputResolution.height;
+                viewport.MaxDepth = 1.f;
+                commandList->RSSetViewports(1, &viewport);
+                D3D12_RECT scissor{0, 0, outputResolution.width, outputResolution.height};
+                commandList->RSSetScissorRects(1, &scissor);
+                commandList->DrawInstanced(3, xr::StereoView::Count, 0, 0);
+
+                if (m_debugEyeGaze && !isFocusLayer) {
+                    for (uint32_t viewIndex = 0; viewIndex < xr::StereoView::Count; viewIndex++) {
+                        XrOffset2Di eyeGaze; // Screen coordinates.
+                        eyeGaze.x = (uint32_t)(m_fullFovRenderResolution.width * (m_eyeGaze[viewIndex].x + 1.f) / 2.f);
+                        eyeGaze.y = (uint32_t)(m_fullFovRenderResolution.height * (1.f - m_eyeGaze[viewIndex].y) / 2.f);
+
+                        const float color[] = {0.5f, 0, 0.5f, 1};
+                        D3D12_RECT rect;
+                        rect.left = eyeGaze.x - 10;
+                        rect.right = eyeGaze.x + 10;
+                        rect.top = eyeGaze.y - 10;
+                        rect.bottom = eyeGaze.y + 10;
+                        commandList->ClearRenderTargetView(
+                            getRenderTargetDescriptor(swapchainForOutput, destinationImage, outputFormat, viewIndex),
+                            color,
+                            1,
+                            &rect);
+                    }
                 }
-                ComPtr<ID3D11RenderTargetView> rtv;
-                {
-                    D3D11_RENDER_TARGET_VIEW_DESC desc{};
-                    desc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
-                    desc.Format = (DXGI_FORMAT)swapchainForStereoView.createInfo.format;
-                    CHECK_HRCMD(m_applicationDevice->CreateRenderTargetView(
-                        destinationImage, &desc, rtv.ReleaseAndGetAddressOf()));
+
+                TraceLoggingWriteStop(local, "xrEndFrame_Composite");
+            }
+
+            // Composite the depth with the same projection.
+            if (depthInfos) {
+                TraceLocalActivity(local);
+                TraceLoggingWriteStart(local, "xrEndFrame_CompositeDepth");
+
+                // Transition the application depth images for reading. The views may share the same images.
+                D3D12_RESOURCE_BARRIER depthBarriers[xr::QuadView::Count];
+                uint32_t depthBarrierCount = 0;
+                for (uint32_t i = 0; i < xr::QuadView::Count; i++) {
+                    bool isDuplicate = false;
+                    for (uint32_t j = 0; j < depthBarrierCount; j++) {
+                        isDuplicate = isDuplicate || depthBarriers[j].Transition.pResource == sourceDepthImages[i];
+                    }
+                    if (!isDuplicate) {
+                        depthBarriers[depthBarrierCount++] =
+                            GetTransitionBarrier(sourceDepthImages[i],
+                                                 D3D12_RESOURCE_STATE_DEPTH_WRITE,
+                                                 D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+                    }
                 }
+                commandList->ResourceBarrier(depthBarrierCount, depthBarriers);
 
-                // Compute the projection.
-                ProjectionVSConstants projection;
-                {
-                    const DirectX::XMMATRIX baseLayerViewProjection =
-                        ComposeProjectionMatrix(m_cachedEyeFov[viewIndex], NearFar{0.1f, 20.f});
-                    const DirectX::XMMATRIX layerViewProjection =
-                        ComposeProjectionMatrix(focusView.fov, NearFar{0.1f, 20.f});
+                ProjectionVSConstants projection{};
+                ProjectionPSConstants drawing{};
+                for (uint32_t viewIndex = 0; viewIndex < xr::StereoView::Count; viewIndex++) {
+                    const uint32_t focusViewIndex = xr::StereoView::Count + viewIndex;
+                    Swapchain& swapchainForStereoDepth = *swapchainsForDepth[viewIndex];
+                    Swapchain& swapchainForFocusDepth = *swapchainsForDepth[focusViewIndex];
+
+                    m_d3d12ApplicationDevice->CopyDescriptorsSimple(
+                        1,
+                        getCpuDescriptor(D3D12DescriptorSlot::StereoDepthInput, viewIndex),
+                        getShaderResourceDescriptor(
+                            swapchainForStereoDepth,
+                            sourceDepthImages[viewIndex],
+                            GetDepthShaderResourceFormat((DXGI_FORMAT)swapchainForStereoDepth.createInfo.format),
+                            depthInfos[viewIndex]->subImage.imageArrayIndex),
+                        D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+                    m_d3d12ApplicationDevice->CopyDescriptorsSimple(
+                        1,
+                        getCpuDescriptor(D3D12DescriptorSlot::FocusDepthInput, viewIndex),
+                        getShaderResourceDescriptor(
+                            swapchainForFocusDepth,
+                            sourceDepthImages[focusViewIndex],
+                            GetDepthShaderResourceFormat((DXGI_FORMAT)swapchainForFocusDepth.createInfo.format),
+                            depthInfos[focusViewIndex]->subImage.imageArrayIndex),
+                        D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+                    // The depth images are projected like the color images, but they have their own image rects.
+                    XrCompositionLayerProjectionView stereoDepthView = stereoViews[viewIndex];
+                    stereoDepthView.subImage = depthInfos[viewIndex]->subImage;
+                    XrCompositionLayerProjectionView focusDepthView = focusViews[viewIndex];
+                    focusDepthView.subImage = depthInfos[focusViewIndex]->subImage;
+                    getProjectionConstants(viewIndex,
+                                           stereoDepthView,
+                                           sourceDepthImagesDesc[viewIndex],
+                                           focusDepthView,
+                                           sourceDepthImagesDesc[focusViewIndex],
+                                           false,
+                                           0,
+                                           false,
+                                           projection,
+                                           drawing);
+                }
+                Swapchain& swapchainForDepthOutput = depthOutput->state;
+                const DXGI_FORMAT depthFormat = (DXGI_FORMAT)swapchainForDepthOutput.createInfo.format;
+                const D3D12_CPU_DESCRIPTOR_HANDLE dsv = getDepthStencilDescriptor(
+                    swapchainForDepthOutput, destinationDepthImage, depthFormat, 0, xr::StereoView::Count);
+
+                memcpy(mappedConstants + getConstantsOffset(D3D12ConstantsSlot::DepthProjectionVS),
+                       &projection,
+                       sizeof(projection));
+                memcpy(mappedConstants + getConstantsOffset(D3D12ConstantsSlot::DepthProjectionPS),
+                       &drawing,
+                       sizeof(drawing));
+
+                const XrExtent2Di depthResolution = depthOutput->extent;
+                commandList->SetPipelineState(getDepthProjectionPipelineState(depthFormat));
+                commandList->SetGraphicsRootConstantBufferView(
+                    0, constantsAddress + getConstantsOffset(D3D12ConstantsSlot::DepthProjectionVS));
+                commandList->SetGraphicsRootConstantBufferView(
+                    1, constantsAddress + getConstantsOffset(D3D12ConstantsSlot::DepthProjectionPS));
+                commandList->SetGraphicsRootDescriptorTable(2,
+                                                            getGpuDescriptor(D3D12DescriptorSlot::StereoDepthInput));
+                commandList->OMSetRenderTargets(0, nullptr, FALSE, &dsv);
+                D3D12_VIEWPORT viewport{};
+                viewport.Width = (float)depthResolution.width;
+                viewport.Height = (float)depthResolution.height;
+                viewport.MaxDepth = 1.f;
+                commandList->RSSetViewports(1, &viewport);
+                D3D12_RECT scissor{0, 0, depthResolution.width, depthResolution.height};
+                commandList->RSSetScissorRects(1, &scissor);
+                commandList->DrawInstanced(3, xr::StereoView::Count, 0, 0);
 
-                    DirectX::XMStoreFloat4x4(
-                        &projection.focusProjection,
-                        DirectX::XMMatrixTranspose(DirectX::XMMatrixInverse(nullptr, baseLayerViewProjection) *
-                                                   layerViewProjection));
+                for (uint32_t i = 0; i < depthBarrierCount; i++) {
+                    std::swap(depthBarriers[i].Transition.StateBefore, depthBarriers[i].Transition.StateAfter);
                 }
-                {
-                    D3D11_MAPPED_SUBRESOURCE mappedResources;
-                    CHECK_HRCMD(m_renderContext->Map(
-                        m_projectionVSConstants.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResources));
-                    memcpy(mappedResources.pData, &projection, sizeof(projection));
-                    m_renderContext->Unmap(m_projectionVSConstants.Get(), 0);
+                commandList->ResourceBarrier(depthBarrierCount, depthBarriers);
+
+                TraceLoggingWriteStop(local, "xrEndFrame_CompositeDepth");
+            }
+
+            if (useTimestamps) {
+                commandList->EndQuery(m_d3d12TimestampQueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, timestampBase + 2);
+                commandList->ResolveQueryData(m_d3d12TimestampQueryHeap.Get(),
+                                              D3D12_QUERY_TYPE_TIMESTAMP,
+                                              timestampBase,
+                                              D3D12TimestampsPerContext,
+                                              m_d3d12TimestampReadback.Get(),
+                                              timestampBase * sizeof(uint64_t));
+                context.hasTimestamps = true;
+                context.hasSharpeningPass = useSharpeningPass;
+            }
+
+            // Return the application images to the state expected by the runtime.
+            for (uint32_t i = 0; i < barrierCount; i++) {
+                std::swap(barriers[i].Transition.StateBefore, barriers[i].Transition.StateAfter);
+            }
+            commandList->ResourceBarrier(barrierCount, barriers);
+
+            {
+                TraceLocalActivity(local);
+                TraceLoggingWriteStart(local, "xrEndFrame_Submit");
+
+                CHECK_HRCMD(commandList->Close());
+
+                if (isFrameTimingEnabled()) {
+                    m_compositionTimerIndex = (m_compositionTimerIndex + 1) % std::size(m_compositionTimer);
+                    // Latency is 3 frames.
+                    m_lastCompositionGpuTime = m_compositionTimer[m_compositionTimerIndex]->query();
+                    TraceLoggingWrite(
+                        g_traceProvider, "CompositionPerf", TLArg(m_lastCompositionGpuTime, "CompositionGpuTime"));
+                    m_compositionTimer[m_compositionTimerIndex]->start();
                 }
 
-                ProjectionPSConstants drawing{};
-                drawing.smoothingArea = m_useQuadViews ? m_smoothenFocusViewEdges : 0;
-                drawing.ignoreAlpha = ~(layerFlags & XR_COMPOSITION_LAYER_BLEND_TEXTURE_SOURCE_ALPHA_BIT);
-                drawing.isUnpremultipliedAlpha = layerFlags & XR_COMPOSITION_LAYER_UNPREMULTIPLIED_ALPHA_BIT;
-                drawing.debugFocusView = m_debugFocusView;
-                {
-                    D3D11_MAPPED_SUBRESOURCE mappedResources;
-                    CHECK_HRCMD(m_renderContext->Map(
-                        m_projectionPSConstants.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResources));
-                    memcpy(mappedResources.pData, &drawing, sizeof(drawing));
-                    m_renderContext->Unmap(m_projectionPSConstants.Get(), 0);
+                if (m_d3d12CompositionQueue) {
+                    // The composition queue must not read the application images before the application is done
+                    // rendering them.
+                    synchronizeCompositionQueue();
                 }
 
-                // Dispatch the composition shader.
-                m_renderContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
-                m_renderContext->OMSetRenderTargets(1, rtv.GetAddressOf(), nullptr);
-                m_renderContext->RSSetState(m_noDepthRasterizer.Get());
-                D3D11_VIEWPORT viewport{};
-                viewport.Width = (float)m_fullFovResolution.width;
-                viewport.Height = (float)m_fullFovResolution.height;
-                viewport.MaxDepth = 1.f;
-                m_renderContext->RSSetViewports(1, &viewport);
-                m_renderContext->VSSetConstantBuffers(0, 1, m_projectionVSConstants.GetAddressOf());
-                m_renderContext->VSSetShader(m_projectionVS.Get(), nullptr, 0);
-                m_renderContext->PSSetConstantBuffers(0, 1, m_projectionPSConstants.GetAddressOf());
-                m_renderContext->PSSetSamplers(0, 1, m_linearClampSampler.GetAddressOf());
-                ID3D11ShaderResourceView* srvs[] = {srvForStereoView.Get(), srvForFocusView.Get()};
-                m_renderContext->PSSetShaderResources(0, 2, srvs);
-                m_renderContext->PSSetShader(m_projectionPS.Get(), nullptr, 0);
-                m_renderContext->Draw(3, 0);
+                ID3D12CommandList* const lists[] = {commandList};
+                getD3D12CompositionQueue()->ExecuteCommandLists(1, lists);
 
-                if (m_debugEyeGaze) {
-                    XrOffset2Di eyeGaze; // Screen coordinates.
-                    eyeGaze.x = (uint32_t)(m_fullFovResolution.width * (m_eyeGaze[viewIndex].x + 1.f) / 2.f);
-                    eyeGaze.y = (uint32_t)(m_fullFovResolution.height * (1.f - m_eyeGaze[viewIndex].y) / 2.f);
+                if (isFrameTimingEnabled()) {
+                    m_compositionTimer[m_compositionTimerIndex]->stop();
+                }
 
-                    const float color[] = {0.5f, 0, 0.5f, 1};
-                    D3D11_RECT rect;
-                    rect.left = eyeGaze.x - 10;
-                    rect.right = eyeGaze.x + 10;
-                    rect.top = eyeGaze.y - 10;
-                    rect.bottom = eyeGaze.y + 10;
-                    m_renderContext->ClearView(rtv.Get(), color, &rect, 1);
+                context.completedFenceValue = ++m_d3d12CompositionFenceValue;
+                m_d3d12CompositionFence->signal(context.completedFenceValue);
+
+                // The runtime consumes the output images on the composition queue, after the composition. Only the
+                // next use of the application images by the application must wait for the composition.
+                if (m_d3d12CompositionQueue) {
+                    for (uint32_t i = 0; i < sourceImageCount; i++) {
+                        const auto& [swapchain, index] = sourceImageIndices[i];
+                        if (index < swapchain->imageCount) {
+                            swapchain->compositionFenceValues[index].store(context.completedFenceValue,
+                                                                           std::memory_order_release);
+                        }
+                    }
                 }
 
-                TraceLoggingWriteStop(local, "xrEndFrame_Composite");
+                TraceLoggingWriteStop(local, "xrEndFrame_Submit");
             }
 
-            if (IsTraceEnabled()) {
-                m_compositionTimer[m_compositionTimerIndex]->stop();
+            releaseOutputSwapchainImage(outputSwapchain);
+            if (depthInfos) {
+                releaseOutputSwapchainImage(depthOutput->handle);
             }
+        }
 
-            {
+        ID3D12CommandQueue* getD3D12CompositionQueue() const {
+            return m_d3d12CompositionQueue ? m_d3d12CompositionQueue.Get() : m_d3d12ApplicationQueue.Get();
+        }
+
+        // Wait on the CPU for the D3D12 composition commands up to the specified fence value.
+        void waitForD3D12Composition(uint64_t fenceValue) {
+            if (!m_d3d12CompositionFence) {
+                return;
+            }
+
+            ID3D12Fence* const fence = m_d3d12CompositionFence->getNativeFence<graphics::D3D12>();
+            if (fence->GetCompletedValue() < fenceValue) {
                 TraceLocalActivity(local);
-                TraceLoggingWriteStart(local, "xrEndFrame_CommitOutput");
-                CHECK_XRCMD(
-                    OpenXrApi::xrReleaseSwapchainImage(swapchainForStereoView.fullFovSwapchain[viewIndex], nullptr));
-                TraceLoggingWriteStop(local, "xrEndFrame_CommitOutput");
+                TraceLoggingWriteStart(local, "D3D12Composition_Wait", TLArg(fenceValue, "FenceValue"));
+                // With no event, the call blocks until the fence value is reached. This is not the layer's CPU time.
+                CHECK_HRCMD(LayerOverheadScope::chainDownstream(
+                    [&] { return fence->SetEventOnCompletion(fenceValue, nullptr); }));
+                TraceLoggingWriteStop(local, "D3D12Composition_Wait");
+            }
+        }
+
+        // Select the FP16 packed variant of the CAS shader when the GPU natively supports 16-bit arithmetic, unless
+        // overriden in the configuration.
+        bool useFp16Sharpening(bool isSupported) const {
+            const bool useFp16 = m_useFp16Sharpening.value_or(isSupported);
+            TraceLoggingWrite(
+                g_traceProvider, "Sharpening", TLArg(isSupported, "Fp16Supported"), TLArg(useFp16, "UseFp16"));
+            Log(fmt::format("Sharpening precision: {}{}\n",
+                            useFp16 ? "FP16" : "FP32",
+                            m_useFp16Sharpening.has_value() ? " (forced)" : ""));
+            return useFp16;
+        }
+
+        // Pipeline states must be compiled for a specific render target format.
+        ID3D12PipelineState* getProjectionPipelineState(DXGI_FORMAT format) {
+            auto it = m_d3d12ProjectionPSO.find(format);
+            if (it == m_d3d12ProjectionPSO.end()) {
+                TraceLoggingWrite(g_traceProvider, "CreateProjectionPipelineState", TLArg((int)format, "Format"));
+
+                D3D12_GRAPHICS_PIPELINE_STATE_DESC desc{};
+                desc.pRootSignature = m_d3d12ProjectionRootSignature.Get();
+                desc.VS = {g_ProjectionVS, sizeof(g_ProjectionVS)};
+                desc.GS = {g_ProjectionGS, sizeof(g_ProjectionGS)};
+                desc.PS = {g_ProjectionPS, sizeof(g_ProjectionPS)};
+                desc.BlendState.RenderTarget[0].RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
+                desc.SampleMask = UINT_MAX;
+                desc.RasterizerState.FillMode = D3D12_FILL_MODE_SOLID;
+                desc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+                desc.RasterizerState.FrontCounterClockwise = TRUE;
+                desc.RasterizerState.DepthClipEnable = TRUE;
+                desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+                desc.NumRenderTargets = 1;
+                desc.RTVFormats[0] = format;
+                desc.SampleDesc.Count = 1;
+                ComPtr<ID3D12PipelineState> pipelineState;
+                CHECK_HRCMD(m_d3d12ApplicationDevice->CreateGraphicsPipelineState(
+                    &desc, IID_PPV_ARGS(pipelineState.ReleaseAndGetAddressOf())));
+                pipelineState->SetName(L"Projection PSO");
+                it = m_d3d12ProjectionPSO.insert_or_assign(format, pipelineState).first;
             }
+            return it->second.Get();
+        }
+
+        ID3D12PipelineState* getDepthProjectionPipelineState(DXGI_FORMAT format) {
+            auto it = m_d3d12DepthProjectionPSO.find(format);
+            if (it == m_d3d12DepthProjectionPSO.end()) {
+                TraceLoggingWrite(g_traceProvider, "CreateDepthProjectionPipelineState", TLArg((int)format, "Format"));
+
+                D3D12_GRAPHICS_PIPELINE_STATE_DESC desc{};
+                desc.pRootSignature = m_d3d12ProjectionRootSignature.Get();
+                desc.VS = {g_ProjectionVS, sizeof(g_ProjectionVS)};
+                desc.GS = {g_ProjectionGS, sizeof(g_ProjectionGS)};
+                desc.PS = {g_DepthProjectionPS, sizeof(g_DepthProjectionPS)};
+                desc.SampleMask = UINT_MAX;
+                desc.RasterizerState.FillMode = D3D12_FILL_MODE_SOLID;
+                desc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+                desc.RasterizerState.FrontCounterClockwise = TRUE;
+                desc.RasterizerState.DepthClipEnable = TRUE;
+                desc.DepthStencilState.DepthEnable = TRUE;
+                desc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
+                desc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_ALWAYS;
+                desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+                desc.DSVFormat = format;
+                desc.SampleDesc.Count = 1;
+                ComPtr<ID3D12PipelineState> pipelineState;
+                CHECK_HRCMD(m_d3d12ApplicationDevice->CreateGraphicsPipelineState(
+                    &desc, IID_PPV_ARGS(pipelineState.ReleaseAndGetAddressOf())));
+                pipelineState->SetName(L"Depth Projection PSO");
+                it = m_d3d12DepthProjectionPSO.insert_or_assign(format, pipelineState).first;
+            }
+            return it->second.Get();
         }
 
         void initializeDeviceContext(ID3D11Device* device) {
@@ -2594,6 +5553,8 @@ namespace openxr_api_layer {
         void initializeCompositionResources(ID3D11Device* device) {
             TraceLoggingWrite(g_traceProvider, "InitializeCompositionResources");
 
+            m_sharpenedImages = std::make_unique<Swapchain>();
+
             // For FOV projection.
             {
                 D3D11_SAMPLER_DESC desc{};
@@ -2625,63 +5586,386 @@ namespace openxr_api_layer {
                     &desc, nullptr, m_projectionVSConstants.ReleaseAndGetAddressOf()));
             }
             {
-                D3D11_BUFFER_DESC desc{};
-                desc.ByteWidth = (UINT)std::max((size_t)16, sizeof(ProjectionPSConstants));
-                desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-                desc.Usage = D3D11_USAGE_DYNAMIC;
-                desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-                CHECK_HRCMD(m_applicationDevice->CreateBuffer(
-                    &desc, nullptr, m_projectionPSConstants.ReleaseAndGetAddressOf()));
+                D3D11_BUFFER_DESC desc{};
+                desc.ByteWidth = (UINT)std::max((size_t)16, sizeof(ProjectionPSConstants));
+                desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+                desc.Usage = D3D11_USAGE_DYNAMIC;
+                desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+                CHECK_HRCMD(m_applicationDevice->CreateBuffer(
+                    &desc, nullptr, m_projectionPSConstants.ReleaseAndGetAddressOf()));
+            }
+            CHECK_HRCMD(m_applicationDevice->CreateVertexShader(
+                g_ProjectionVS, sizeof(g_ProjectionVS), nullptr, m_projectionVS.ReleaseAndGetAddressOf()));
+            CHECK_HRCMD(m_applicationDevice->CreateGeometryShader(
+                g_ProjectionGS, sizeof(g_ProjectionGS), nullptr, m_projectionGS.ReleaseAndGetAddressOf()));
+            CHECK_HRCMD(m_applicationDevice->CreatePixelShader(
+                g_ProjectionPS, sizeof(g_ProjectionPS), nullptr, m_projectionPS.ReleaseAndGetAddressOf()));
+
+            // For depth composition.
+            {
+                D3D11_DEPTH_STENCIL_DESC desc{};
+                desc.DepthEnable = TRUE;
+                desc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
+                desc.DepthFunc = D3D11_COMPARISON_ALWAYS;
+                CHECK_HRCMD(
+                    m_applicationDevice->CreateDepthStencilState(&desc, m_depthWriteState.ReleaseAndGetAddressOf()));
+            }
+            CHECK_HRCMD(m_applicationDevice->CreatePixelShader(g_DepthProjectionPS,
+                                                               sizeof(g_DepthProjectionPS),
+                                                               nullptr,
+                                                               m_depthProjectionPS.ReleaseAndGetAddressOf()));
+
+            // For CAS sharpening.
+            {
+                D3D11_BUFFER_DESC desc{};
+                desc.ByteWidth = (UINT)std::max((size_t)16, sizeof(SharpeningCSConstants));
+                desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+                desc.Usage = D3D11_USAGE_DYNAMIC;
+                desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+                CHECK_HRCMD(m_applicationDevice->CreateBuffer(
+                    &desc, nullptr, m_sharpeningCSConstants.ReleaseAndGetAddressOf()));
+            }
+            {
+                D3D11_FEATURE_DATA_SHADER_MIN_PRECISION_SUPPORT minPrecision{};
+                CHECK_HRCMD(m_applicationDevice->CheckFeatureSupport(
+                    D3D11_FEATURE_SHADER_MIN_PRECISION_SUPPORT, &minPrecision, sizeof(minPrecision)));
+                const bool useFp16 = useFp16Sharpening(minPrecision.AllOtherShaderStagesMinPrecision &
+                                                       D3D11_SHADER_MIN_PRECISION_16_BIT);
+                CHECK_HRCMD(m_applicationDevice->CreateComputeShader(
+                    useFp16 ? g_SharpeningFP16CS : g_SharpeningCS,
+                    useFp16 ? sizeof(g_SharpeningFP16CS) : sizeof(g_SharpeningCS),
+                    nullptr,
+                    m_sharpeningCS.ReleaseAndGetAddressOf()));
+            }
+
+            // Blank texture for FOV tangent.
+            {
+                D3D11_TEXTURE2D_DESC desc{};
+                desc.ArraySize = 1;
+                desc.Width = desc.Height = 32;
+                desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+                desc.MipLevels = 1;
+                desc.SampleDesc.Count = 1;
+                desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+                D3D11_SUBRESOURCE_DATA initialData{};
+                initialData.SysMemPitch = desc.Width;
+                std::vector<uint32_t> blank(desc.Width * desc.Height, 0);
+                initialData.pSysMem = blank.data();
+                CHECK_HRCMD(
+                    m_applicationDevice->CreateTexture2D(&desc, nullptr, m_blankTexture.ReleaseAndGetAddressOf()));
+            }
+            {
+                D3D11_SHADER_RESOURCE_VIEW_DESC desc{};
+                desc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+                desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+                desc.Texture2DArray.MipLevels = 1;
+                desc.Texture2DArray.ArraySize = 1;
+                CHECK_HRCMD(m_applicationDevice->CreateShaderResourceView(
+                    m_blankTexture.Get(), &desc, m_srvBlankTexture.ReleaseAndGetAddressOf()));
+            }
+
+            // For statistics.
+            {
+                XrGraphicsBindingD3D11KHR bindings{};
+                bindings.device = device;
+                std::shared_ptr<graphics::IGraphicsDevice> graphicsDevice =
+                    graphics::internal::wrapApplicationDevice(bindings);
+                for (uint32_t i = 0; i < std::size(m_compositionTimer); i++) {
+                    m_compositionTimer[i] = graphicsDevice->createTimer();
+                    // The D3D12 composition uses timestamp queries for the stages instead.
+                    m_sharpeningTimer[i] = graphicsDevice->createTimer();
+                    m_projectionTimer[i] = graphicsDevice->createTimer();
+                }
+            }
+        }
+
+        void initializeDeviceContext(ID3D12Device* device, ID3D12CommandQueue* queue) {
+            m_d3d12ApplicationDevice = device;
+            m_d3d12ApplicationQueue = queue;
+
+            // For statistics.
+            {
+                XrGraphicsBindingD3D12KHR bindings{};
+                bindings.device = device;
+                bindings.queue = queue;
+                std::shared_ptr<graphics::IGraphicsDevice> graphicsDevice =
+                    graphics::internal::wrapApplicationDevice(bindings);
+                for (uint32_t i = 0; i < std::size(m_appFrameGpuTimer); i++) {
+                    m_appFrameGpuTimer[i] = graphicsDevice->createTimer();
+                }
+                m_appFrameCpuTimer = general::createTimer();
+                m_appRenderCpuTimer = general::createTimer();
+            }
+        }
+
+        // In async composition mode, the composition commands are submitted to a dedicated queue, which is also the
+        // queue given to the runtime. The application queue only signals fences. This must happen before the session is
+        // created.
+        void initializeAsyncCompositionQueue(ID3D12Device* device) {
+            D3D12_COMMAND_QUEUE_DESC desc{};
+            desc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
+            desc.Priority = D3D12_COMMAND_QUEUE_PRIORITY_HIGH;
+            CHECK_HRCMD(
+                device->CreateCommandQueue(&desc, IID_PPV_ARGS(m_d3d12CompositionQueue.ReleaseAndGetAddressOf())));
+            m_d3d12CompositionQueue->SetName(L"Composition Queue");
+            CHECK_HRCMD(device->CreateFence(
+                0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(m_d3d12ApplicationFence.ReleaseAndGetAddressOf())));
+            m_d3d12ApplicationFence->SetName(L"Application Fence");
+            m_d3d12ApplicationFenceValue = 0;
+        }
+
+        // The runtime synchronizes with the composition queue upon releasing a swapchain image. The composition queue
+        // must not run ahead of the application work submitted so far. This is a GPU-side wait only.
+        void synchronizeCompositionQueue() {
+            const uint64_t value = ++m_d3d12ApplicationFenceValue;
+            CHECK_HRCMD(m_d3d12ApplicationQueue->Signal(m_d3d12ApplicationFence.Get(), value));
+            CHECK_HRCMD(m_d3d12CompositionQueue->Wait(m_d3d12ApplicationFence.Get(), value));
+        }
+
+        // The application must not render into an image that a pending composition still reads. This is a GPU-side
+        // wait only, and the image was normally read by a composition that completed long ago.
+        void waitForCompositionOfImage(const Swapchain& entry, uint32_t index) {
+            if (index >= entry.imageCount) {
+                return;
+            }
+
+            const uint64_t value = entry.compositionFenceValues[index].load(std::memory_order_acquire);
+            ID3D12Fence* const fence = value ? m_d3d12CompositionFence->getNativeFence<graphics::D3D12>() : nullptr;
+            if (fence && fence->GetCompletedValue() < value) {
+                TraceLoggingWrite(g_traceProvider, "WaitForCompositionOfImage", TLArg(value, "FenceValue"));
+                CHECK_HRCMD(m_d3d12ApplicationQueue->Wait(fence, value));
+            }
+        }
+
+        void initializeCompositionResources(ID3D12Device* device) {
+            TraceLoggingWrite(g_traceProvider, "InitializeCompositionResources");
+
+            m_sharpenedImages = std::make_unique<Swapchain>();
+
+            const auto createRootSignature = [&](const D3D12_ROOT_SIGNATURE_DESC& desc,
+                                                 ComPtr<ID3D12RootSignature>& rootSignature) {
+                ComPtr<ID3DBlob> blob;
+                ComPtr<ID3DBlob> error;
+                const HRESULT hr = D3D12SerializeRootSignature(
+                    &desc, D3D_ROOT_SIGNATURE_VERSION_1, blob.ReleaseAndGetAddressOf(), error.ReleaseAndGetAddressOf());
+                if (FAILED(hr)) {
+                    if (error) {
+                        ErrorLog(fmt::format("D3D12SerializeRootSignature failed: {}\n",
+                                             (const char*)error->GetBufferPointer()));
+                    }
+                    CHECK_HRCMD(hr);
+                }
+                CHECK_HRCMD(device->CreateRootSignature(0,
+                                                        blob->GetBufferPointer(),
+                                                        blob->GetBufferSize(),
+                                                        IID_PPV_ARGS(rootSignature.ReleaseAndGetAddressOf())));
+            };
+
+            // For FOV projection.
+            {
+                D3D12_DESCRIPTOR_RANGE range{};
+                range.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+                range.NumDescriptors = 2 * xr::StereoView::Count;
+                range.BaseShaderRegister = 0;
+                range.OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
+
+                D3D12_ROOT_PARAMETER parameters[3]{};
+                parameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
+                parameters[0].Descriptor.ShaderRegister = 0;
+                parameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+                parameters[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
+                parameters[1].Descriptor.ShaderRegister = 0;
+                parameters[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+                parameters[2].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+                parameters[2].DescriptorTable.NumDescriptorRanges = 1;
+                parameters[2].DescriptorTable.pDescriptorRanges = &range;
+                parameters[2].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+
+                D3D12_STATIC_SAMPLER_DESC sampler{};
+                sampler.Filter = D3D12_FILTER_MIN_MAG_MIP_LINEAR;
+                sampler.AddressU = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+                sampler.AddressV = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+                sampler.AddressW = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+                sampler.MaxAnisotropy = 1;
+                sampler.MinLOD = D3D12_MIP_LOD_BIAS_MIN;
+                sampler.MaxLOD = D3D12_MIP_LOD_BIAS_MAX;
+                sampler.ShaderRegister = 0;
+                sampler.ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+
+                D3D12_ROOT_SIGNATURE_DESC desc{};
+                desc.NumParameters = (UINT)std::size(parameters);
+                desc.pParameters = parameters;
+                desc.NumStaticSamplers = 1;
+                desc.pStaticSamplers = &sampler;
+                createRootSignature(desc, m_d3d12ProjectionRootSignature);
+                m_d3d12ProjectionRootSignature->SetName(L"Projection Root Signature");
+            }
+
+            // For CAS sharpening.
+            {
+                D3D12_DESCRIPTOR_RANGE ranges[2]{};
+                ranges[0].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+                ranges[0].NumDescriptors = 1;
+                ranges[0].BaseShaderRegister = 0;
+                ranges[0].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
+                ranges[1].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_UAV;
+                ranges[1].NumDescriptors = 1;
+                ranges[1].BaseShaderRegister = 0;
+                ranges[1].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
+
+                D3D12_ROOT_PARAMETER parameters[2]{};
+                parameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
+                parameters[0].Descriptor.ShaderRegister = 0;
+                parameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+                parameters[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+                parameters[1].DescriptorTable.NumDescriptorRanges = (UINT)std::size(ranges);
+                parameters[1].DescriptorTable.pDescriptorRanges = ranges;
+                parameters[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+
+                D3D12_ROOT_SIGNATURE_DESC desc{};
+                desc.NumParameters = (UINT)std::size(parameters);
+                desc.pParameters = parameters;
+                createRootSignature(desc, m_d3d12SharpeningRootSignature);
+                m_d3d12SharpeningRootSignature->SetName(L"Sharpening Root Signature");
+            }
+            {
+                D3D12_FEATURE_DATA_D3D12_OPTIONS options{};
+                CHECK_HRCMD(device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof(options)));
+                const bool useFp16 =
+                    useFp16Sharpening(options.MinPrecisionSupport & D3D12_SHADER_MIN_PRECISION_SUPPORT_16_BIT);
+
+                D3D12_COMPUTE_PIPELINE_STATE_DESC desc{};
+                desc.pRootSignature = m_d3d12SharpeningRootSignature.Get();
+                if (useFp16) {
+                    desc.CS = {g_SharpeningFP16CS, sizeof(g_SharpeningFP16CS)};
+                } else {
+                    desc.CS = {g_SharpeningCS, sizeof(g_SharpeningCS)};
+                }
+                CHECK_HRCMD(device->CreateComputePipelineState(
+                    &desc, IID_PPV_ARGS(m_d3d12SharpeningPSO.ReleaseAndGetAddressOf())));
+                m_d3d12SharpeningPSO->SetName(L"Sharpening PSO");
+            }
+
+            // Constant buffers, persistently mapped.
+            {
+                D3D12_RESOURCE_DESC desc{};
+                desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+                desc.Width = std::size(m_d3d12CompositionContext) * D3D12ConstantsPerContext *
+                             D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
+                desc.Height = desc.DepthOrArraySize = desc.MipLevels = desc.SampleDesc.Count = 1;
+                desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+                D3D12_HEAP_PROPERTIES heapType{};
+                heapType.Type = D3D12_HEAP_TYPE_UPLOAD;
+                heapType.CreationNodeMask = heapType.VisibleNodeMask = 1;
+                CHECK_HRCMD(
+                    device->CreateCommittedResource(&heapType,
+                                                    D3D12_HEAP_FLAG_NONE,
+                                                    &desc,
+                                                    D3D12_RESOURCE_STATE_GENERIC_READ,
+                                                    nullptr,
+                                                    IID_PPV_ARGS(m_d3d12ConstantsBuffer.ReleaseAndGetAddressOf())));
+                m_d3d12ConstantsBuffer->SetName(L"Composition Constants");
+                D3D12_RANGE noRead{0, 0};
+                CHECK_HRCMD(
+                    m_d3d12ConstantsBuffer->Map(0, &noRead, reinterpret_cast<void**>(&m_d3d12MappedConstants)));
             }
-            CHECK_HRCMD(m_applicationDevice->CreateVertexShader(
-                g_ProjectionVS, sizeof(g_ProjectionVS), nullptr, m_projectionVS.ReleaseAndGetAddressOf()));
-            CHECK_HRCMD(m_applicationDevice->CreatePixelShader(
-                g_ProjectionPS, sizeof(g_ProjectionPS), nullptr, m_projectionPS.ReleaseAndGetAddressOf()));
 
-            // For CAS sharpening.
+            // Shader-visible descriptors for all composition contexts.
+            m_d3d12ResourceHeap =
+                createD3D12DescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
+                                          (uint32_t)std::size(m_d3d12CompositionContext) * D3D12DescriptorsPerContext,
+                                          true);
+            m_d3d12ResourceHeap->SetName(L"Composition Descriptors");
+            m_d3d12ResourceDescriptorSize =
+                device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+            // Timestamps for all composition contexts, and their readback buffer.
             {
-                D3D11_BUFFER_DESC desc{};
-                desc.ByteWidth = (UINT)std::max((size_t)16, sizeof(SharpeningCSConstants));
-                desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-                desc.Usage = D3D11_USAGE_DYNAMIC;
-                desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-                CHECK_HRCMD(m_applicationDevice->CreateBuffer(
-                    &desc, nullptr, m_sharpeningCSConstants.ReleaseAndGetAddressOf()));
+                D3D12_QUERY_HEAP_DESC desc{};
+                desc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+                desc.Count = (uint32_t)std::size(m_d3d12CompositionContext) * D3D12TimestampsPerContext;
+                CHECK_HRCMD(
+                    device->CreateQueryHeap(&desc, IID_PPV_ARGS(m_d3d12TimestampQueryHeap.ReleaseAndGetAddressOf())));
+                m_d3d12TimestampQueryHeap->SetName(L"Composition Timestamps");
+            }
+            {
+                D3D12_RESOURCE_DESC desc{};
+                desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+                desc.Width = std::size(m_d3d12CompositionContext) * D3D12TimestampsPerContext * sizeof(uint64_t);
+                desc.Height = desc.DepthOrArraySize = desc.MipLevels = desc.SampleDesc.Count = 1;
+                desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+                D3D12_HEAP_PROPERTIES heapType{};
+                heapType.Type = D3D12_HEAP_TYPE_READBACK;
+                heapType.CreationNodeMask = heapType.VisibleNodeMask = 1;
+                CHECK_HRCMD(
+                    device->CreateCommittedResource(&heapType,
+                                                    D3D12_HEAP_FLAG_NONE,
+                                                    &desc,
+                                                    D3D12_RESOURCE_STATE_COPY_DEST,
+                                                    nullptr,
+                                                    IID_PPV_ARGS(m_d3d12TimestampReadback.ReleaseAndGetAddressOf())));
+                m_d3d12TimestampReadback->SetName(L"Composition Timestamps Readback");
+            }
+            CHECK_HRCMD(getD3D12CompositionQueue()->GetTimestampFrequency(&m_d3d12TimestampFrequency));
+
+            // The command lists are allocated once and recycled.
+            for (uint32_t i = 0; i < std::size(m_d3d12CompositionContext); i++) {
+                D3D12CompositionContext& context = m_d3d12CompositionContext[i];
+                CHECK_HRCMD(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT,
+                                                           IID_PPV_ARGS(context.allocator.ReleaseAndGetAddressOf())));
+                context.allocator->SetName(L"Composition Command Allocator");
+                CHECK_HRCMD(device->CreateCommandList(0,
+                                                      D3D12_COMMAND_LIST_TYPE_DIRECT,
+                                                      context.allocator.Get(),
+                                                      nullptr,
+                                                      IID_PPV_ARGS(context.commandList.ReleaseAndGetAddressOf())));
+                context.commandList->SetName(L"Composition Command List");
+                CHECK_HRCMD(context.commandList->Close());
+                context.completedFenceValue = 0;
             }
-            CHECK_HRCMD(m_applicationDevice->CreateComputeShader(
-                g_SharpeningCS, sizeof(g_SharpeningCS), nullptr, m_sharpeningCS.ReleaseAndGetAddressOf()));
 
             // Blank texture for FOV tangent.
             {
-                D3D11_TEXTURE2D_DESC desc{};
-                desc.ArraySize = 1;
+                D3D12_RESOURCE_DESC desc{};
+                desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
                 desc.Width = desc.Height = 32;
+                desc.DepthOrArraySize = 1;
                 desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
                 desc.MipLevels = 1;
                 desc.SampleDesc.Count = 1;
-                desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-                D3D11_SUBRESOURCE_DATA initialData{};
-                initialData.SysMemPitch = desc.Width;
-                std::vector<uint32_t> blank(desc.Width * desc.Height, 0);
-                initialData.pSysMem = blank.data();
+                D3D12_HEAP_PROPERTIES heapType{};
+                heapType.Type = D3D12_HEAP_TYPE_DEFAULT;
+                heapType.CreationNodeMask = heapType.VisibleNodeMask = 1;
                 CHECK_HRCMD(
-                    m_applicationDevice->CreateTexture2D(&desc, nullptr, m_blankTexture.ReleaseAndGetAddressOf()));
+                    device->CreateCommittedResource(&heapType,
+                                                    D3D12_HEAP_FLAG_NONE,
+                                                    &desc,
+                                                    D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+                                                    nullptr,
+                                                    IID_PPV_ARGS(m_d3d12BlankTexture.ReleaseAndGetAddressOf())));
+                m_d3d12BlankTexture->SetName(L"Blank Texture");
             }
             {
-                D3D11_SHADER_RESOURCE_VIEW_DESC desc{};
-                desc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+                m_d3d12SrvBlankTexture = createD3D12DescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+                D3D12_SHADER_RESOURCE_VIEW_DESC desc{};
+                desc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
                 desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-                desc.Texture2D.MipLevels = 1;
-                CHECK_HRCMD(m_applicationDevice->CreateShaderResourceView(
-                    m_blankTexture.Get(), &desc, m_srvBlankTexture.ReleaseAndGetAddressOf()));
+                desc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+                desc.Texture2DArray.MipLevels = 1;
+                desc.Texture2DArray.ArraySize = 1;
+                device->CreateShaderResourceView(
+                    m_d3d12BlankTexture.Get(), &desc, m_d3d12SrvBlankTexture->GetCPUDescriptorHandleForHeapStart());
             }
 
-            // For statistics.
+            // For synchronization and statistics.
             {
-                XrGraphicsBindingD3D11KHR bindings{};
+                XrGraphicsBindingD3D12KHR bindings{};
                 bindings.device = device;
+                bindings.queue = getD3D12CompositionQueue();
                 std::shared_ptr<graphics::IGraphicsDevice> graphicsDevice =
                     graphics::internal::wrapApplicationDevice(bindings);
+                m_d3d12CompositionFence = graphicsDevice->createFence(false /* shareable */);
+                m_d3d12CompositionFenceValue = 0;
                 for (uint32_t i = 0; i < std::size(m_compositionTimer); i++) {
                     m_compositionTimer[i] = graphicsDevice->createTimer();
                 }
@@ -2693,30 +5977,19 @@ namespace openxr_api_layer {
                 return;
             }
 
-            cacheStereoView(session);
-
-            XrView view[xr::StereoView::Count]{{XR_TYPE_VIEW}, {XR_TYPE_VIEW}};
-            for (uint32_t eye = 0; eye < xr::StereoView::Count; eye++) {
-                view[eye].fov = m_cachedEyeFov[eye];
-                view[eye].pose = m_cachedEyePoses[eye];
-
-                // Calculate the "resting" gaze position.
-                XrVector2f projectedGaze{};
-                ProjectPoint(view[eye], {0.f, 0.f, -1.f}, projectedGaze);
-                m_eyeGaze[eye] = m_centerOfFov[eye] = projectedGaze;
-                m_eyeGaze[eye] = m_eyeGaze[eye] + XrVector2f{eye == xr::StereoView::Left ? -m_horizontalFixedOffset
-                                                                                         : m_horizontalFixedOffset,
-                                                             m_verticalFixedOffset};
-
-                // Populate the FOV for the focus view (when no eye tracking is used).
-                const XrVector2f min{std::clamp(m_eyeGaze[eye].x - m_horizontalFovSection[0], -1.f, 1.f),
-                                     std::clamp(m_eyeGaze[eye].y - m_verticalFovSection[0], -1.f, 1.f)};
-                const XrVector2f max{std::clamp(m_eyeGaze[eye].x + m_horizontalFovSection[0], -1.f, 1.f),
-                                     std::clamp(m_eyeGaze[eye].y + m_verticalFovSection[0], -1.f, 1.f)};
-                m_cachedEyeFov[eye + xr::StereoView::Count] =
-                    xr::math::ComputeBoundingFov(m_cachedEyeFov[eye], min, max);
+            // Avoid running a synchronous frame loop at startup when the stereo view for this headset was seen
+            // before. The cached values are validated against the first pose located by the application.
+            if (m_useStereoViewCache && loadStereoViewCache()) {
+                m_needRefreshStereoView = true;
+            } else {
+                cacheStereoView(session);
+                if (m_useStereoViewCache) {
+                    storeStereoViewCache();
+                }
             }
 
+            computeFocusFovTables();
+
             {
                 XrViewConfigurationView stereoViews[xr::StereoView::Count]{{XR_TYPE_VIEW_CONFIGURATION_VIEW},
                                                                            {XR_TYPE_VIEW_CONFIGURATION_VIEW}};
@@ -2737,6 +6010,9 @@ namespace openxr_api_layer {
                     std::min((uint32_t)newWidth, stereoViews[xr::StereoView::Left].maxImageRectWidth);
                 m_fullFovResolution.height =
                     std::min((uint32_t)newHeight, stereoViews[xr::StereoView::Left].maxImageRectHeight);
+                m_fullFovRenderResolution = m_fullFovResolution;
+                m_dynamicResolutionScale = 1.f;
+                m_smoothedCompositionGpuTime = 0.f;
             }
 
             m_needComputeBaseFov = false;
@@ -2785,6 +6061,209 @@ namespace openxr_api_layer {
             }
         }
 
+        void computeFocusFovTables() {
+            XrView view[xr::StereoView::Count]{{XR_TYPE_VIEW}, {XR_TYPE_VIEW}};
+            for (uint32_t eye = 0; eye < xr::StereoView::Count; eye++) {
+                view[eye].fov = m_cachedEyeFov[eye];
+                view[eye].pose = m_cachedEyePoses[eye];
+            }
+            m_stereoProjection = ComputeStereoProjection(view);
+
+            // Calculate the "resting" gaze position.
+            XrVector2f projectedGaze[xr::StereoView::Count]{};
+            bool isProjectedGazeValid[xr::StereoView::Count]{};
+            ProjectPoint(m_stereoProjection, {0.f, 0.f, -1.f}, projectedGaze, isProjectedGazeValid);
+
+            for (uint32_t eye = 0; eye < xr::StereoView::Count; eye++) {
+                m_eyeGaze[eye] = m_centerOfFov[eye] = projectedGaze[eye];
+                m_eyeGaze[eye] = m_eyeGaze[eye] + XrVector2f{eye == xr::StereoView::Left ? -m_horizontalFixedOffset
+                                                                                         : m_horizontalFixedOffset,
+                                                             m_verticalFixedOffset};
+
+                // Populate the FOV for the focus view (when no eye tracking is used).
+                const XrVector2f min{std::clamp(m_eyeGaze[eye].x - m_horizontalFovSection[0], -1.f, 1.f),
+                                     std::clamp(m_eyeGaze[eye].y - m_verticalFovSection[0], -1.f, 1.f)};
+                const XrVector2f max{std::clamp(m_eyeGaze[eye].x + m_horizontalFovSection[0], -1.f, 1.f),
+                                     std::clamp(m_eyeGaze[eye].y + m_verticalFovSection[0], -1.f, 1.f)};
+                m_cachedEyeFov[eye + xr::StereoView::Count] = ComputeBoundingFov(m_stereoProjection, eye, min, max);
+            }
+        }
+
+        // The stereo view cache holds one line per runtime and system, with the IPD (in millimeters) followed by the
+        // FOV and the pose (in the VIEW reference space) of each eye.
+        std::filesystem::path getStereoViewCachePath() const {
+            return localAppData / "stereo_view_cache.txt";
+        }
+
+        std::string getStereoViewCacheKey() const {
+            return m_runtimeName + "|" + m_systemName;
+        }
+
+        static int32_t getIpdBucket(const XrPosef& leftEyePose, const XrPosef& rightEyePose) {
+            return static_cast<int32_t>(std::round(Length(rightEyePose.position - leftEyePose.position) * 1000.f));
+        }
+
+        static bool isSameFov(const XrFovf& a, const XrFovf& b, float tolerance = 0.0001f) {
+            return std::abs(a.angleLeft - b.angleLeft) <= tolerance &&
+                   std::abs(a.angleRight - b.angleRight) <= tolerance && std::abs(a.angleUp - b.angleUp) <= tolerance &&
+                   std::abs(a.angleDown - b.angleDown) <= tolerance;
+        }
+
+        bool loadStereoViewCache() {
+            std::ifstream cacheFile(getStereoViewCachePath());
+            if (!cacheFile.is_open()) {
+                return false;
+            }
+
+            const std::string key = getStereoViewCacheKey() + "\t";
+            std::string line;
+            while (std::getline(cacheFile, line)) {
+                if (!general::startsWith(line, key)) {
+                    continue;
+                }
+
+                std::istringstream entry(line.substr(key.size()));
+                int32_t ipdBucket = 0;
+                XrFovf fov[xr::StereoView::Count]{};
+                XrPosef pose[xr::StereoView::Count]{};
+                entry >> ipdBucket;
+                for (uint32_t eye = 0; eye < xr::StereoView::Count; eye++) {
+                    entry >> fov[eye].angleLeft >> fov[eye].angleRight >> fov[eye].angleUp >> fov[eye].angleDown;
+                    entry >> pose[eye].orientation.x >> pose[eye].orientation.y >> pose[eye].orientation.z >>
+                        pose[eye].orientation.w;
+                    entry >> pose[eye].position.x >> pose[eye].position.y >> pose[eye].position.z;
+                }
+                if (entry.fail() ||
+                    getIpdBucket(pose[xr::StereoView::Left], pose[xr::StereoView::Right]) != ipdBucket) {
+                    Log("Ignoring corrupted stereo view cache entry\n");
+                    return false;
+                }
+
+                for (uint32_t eye = 0; eye < xr::StereoView::Count; eye++) {
+                    m_cachedEyeFov[eye] = fov[eye];
+                    m_cachedEyePoses[eye] = pose[eye];
+
+                    TraceLoggingWrite(g_traceProvider,
+                                      "LoadStereoViewCache",
+                                      TLArg(eye, "ViewIndex"),
+                                      TLArg(xr::ToString(m_cachedEyePoses[eye]).c_str(), "Pose"),
+                                      TLArg(xr::ToString(m_cachedEyeFov[eye]).c_str(), "Fov"));
+                }
+                Log(fmt::format("Using cached stereo view (IPD: {}mm)\n", ipdBucket));
+
+                return true;
+            }
+
+            return false;
+        }
+
+        void storeStereoViewCache() {
+            // Preserve the entries for other runtimes and systems.
+            const std::string key = getStereoViewCacheKey() + "\t";
+            std::vector<std::string> lines;
+            {
+                std::ifstream cacheFile(getStereoViewCachePath());
+                std::string line;
+                while (std::getline(cacheFile, line)) {
+                    if (!line.empty() && !general::startsWith(line, key)) {
+                        lines.push_back(line);
+                    }
+                }
+            }
+
+            std::string entry = fmt::format(
+                "{}{}",
+                key,
+                getIpdBucket(m_cachedEyePoses[xr::StereoView::Left], m_cachedEyePoses[xr::StereoView::Right]));
+            for (uint32_t eye = 0; eye < xr::StereoView::Count; eye++) {
+                const XrFovf& fov = m_cachedEyeFov[eye];
+                const XrPosef& pose = m_cachedEyePoses[eye];
+                entry += fmt::format(
+                    " {:.9g} {:.9g} {:.9g} {:.9g}", fov.angleLeft, fov.angleRight, fov.angleUp, fov.angleDown);
+                entry += fmt::format(" {:.9g} {:.9g} {:.9g} {:.9g}",
+                                     pose.orientation.x,
+                                     pose.orientation.y,
+                                     pose.orientation.z,
+                                     pose.orientation.w);
+                entry += fmt::format(" {:.9g} {:.9g} {:.9g}", pose.position.x, pose.position.y, pose.position.z);
+            }
+            lines.push_back(entry);
+
+            std::ofstream cacheFile(getStereoViewCachePath(), std::ios::trunc);
+            if (!cacheFile.is_open()) {
+                ErrorLog(fmt::format("Failed to write stereo view cache at '{}'\n", getStereoViewCachePath().string()));
+                return;
+            }
+            for (const auto& line : lines) {
+                cacheFile << line << "\n";
+            }
+        }
+
+        // Validate the cached stereo view against the views located by the application, and replace it if the headset
+        // reports a different FOV or IPD.
+        void refreshStereoView(XrSession session, XrTime displayTime, const XrView* views) {
+            m_needRefreshStereoView = false;
+
+            bool isStale =
+                getIpdBucket(views[xr::StereoView::Left].pose, views[xr::StereoView::Right].pose) !=
+                getIpdBucket(m_cachedEyePoses[xr::StereoView::Left], m_cachedEyePoses[xr::StereoView::Right]);
+            for (uint32_t eye = 0; eye < xr::StereoView::Count; eye++) {
+                isStale = isStale || !isSameFov(views[eye].fov, m_cachedEyeFov[eye]);
+            }
+
+            TraceLoggingWrite(g_traceProvider, "RefreshStereoView", TLArg(isStale, "Stale"));
+
+            if (!isStale) {
+                return;
+            }
+
+            // The application's views are in an arbitrary space, locate the eyes again relative to the head.
+            XrReferenceSpaceCreateInfo spaceCreateInfo{XR_TYPE_REFERENCE_SPACE_CREATE_INFO};
+            spaceCreateInfo.referenceSpaceType = XR_REFERENCE_SPACE_TYPE_VIEW;
+            spaceCreateInfo.poseInReferenceSpace = Pose::Identity();
+
+            XrSpace viewSpace;
+            CHECK_XRCMD(LayerOverheadScope::chainDownstream(
+                [&] { return OpenXrApi::xrCreateReferenceSpace(session, &spaceCreateInfo, &viewSpace); }));
+
+            XrViewLocateInfo viewLocateInfo{XR_TYPE_VIEW_LOCATE_INFO};
+            viewLocateInfo.space = viewSpace;
+            viewLocateInfo.viewConfigurationType = XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO;
+            viewLocateInfo.displayTime = displayTime;
+
+            XrView view[xr::StereoView::Count]{{XR_TYPE_VIEW}, {XR_TYPE_VIEW}};
+            XrViewState viewState{XR_TYPE_VIEW_STATE};
+            uint32_t count;
+            const XrResult result = LayerOverheadScope::chainDownstream([&] {
+                return OpenXrApi::xrLocateViews(
+                    session, &viewLocateInfo, &viewState, xr::StereoView::Count, &count, view);
+            });
+
+            LayerOverheadScope::chainDownstream([&] { return OpenXrApi::xrDestroySpace(viewSpace); });
+
+            if (XR_FAILED(result) || !(viewState.viewStateFlags &
+                                       (XR_VIEW_STATE_POSITION_VALID_BIT | XR_VIEW_STATE_ORIENTATION_VALID_BIT))) {
+                // Try again on the next frame.
+                m_needRefreshStereoView = true;
+                return;
+            }
+
+            for (uint32_t eye = 0; eye < xr::StereoView::Count; eye++) {
+                m_cachedEyeFov[eye] = view[eye].fov;
+                m_cachedEyePoses[eye] = view[eye].pose;
+
+                TraceLoggingWrite(g_traceProvider,
+                                  "CacheStereoView",
+                                  TLArg(eye, "ViewIndex"),
+                                  TLArg(xr::ToString(m_cachedEyePoses[eye]).c_str(), "Pose"),
+                                  TLArg(xr::ToString(m_cachedEyeFov[eye]).c_str(), "Fov"));
+            }
+            computeFocusFovTables();
+            storeStereoViewCache();
+
+            Log("Cached stereo view was stale and has been refreshed\n");
+        }
+
         const std::string getXrPath(XrPath path) {
             if (path == XR_NULL_PATH) {
                 return "";
@@ -2893,22 +6372,190 @@ namespace openxr_api_layer {
         }
 
         void LoadConfiguration(const std::filesystem::path& configPath) {
+            ParseConfiguration(ReadConfiguration(configPath));
+        }
+
+        std::vector<std::string> ReadConfiguration(const std::filesystem::path& configPath) const {
             // Look in %LocalAppData% first, then fallback to your installation folder.
             Log(fmt::format("Trying to locate configuration file at '{}'...\n", configPath.string()));
+            std::vector<std::string> lines;
             std::ifstream configFile;
             configFile.open(configPath);
             if (configFile.is_open()) {
-                bool active = true;
-                unsigned int lineNumber = 0;
                 std::string line;
                 while (std::getline(configFile, line)) {
-                    lineNumber++;
-                    active = ParseConfigurationStatement(line, lineNumber, active);
+                    lines.push_back(line);
                 }
                 configFile.close();
             } else {
                 Log("Not found\n");
             }
+            return lines;
+        }
+
+        void ParseConfiguration(const std::vector<std::string>& lines) {
+            bool active = true;
+            unsigned int lineNumber = 0;
+            for (const auto& line : lines) {
+                lineNumber++;
+                active = ParseConfigurationStatement(line, lineNumber, active);
+            }
+        }
+
+        // Options that are only used by the per-frame computations, and that can be changed while the application is
+        // running. The others decide the resolutions reported to the application or the resources allocated upfront.
+        static bool IsLiveOption(const std::string& name) {
+            static const std::set<std::string> LiveOptions = {"horizontal_focus_offset",
+                                                              "vertical_focus_offset",
+                                                              "horizontal_focus_widening_multiplier",
+                                                              "vertical_focus_widening_multiplier",
+                                                              "focus_widening_deadzone",
+                                                              "smoothen_focus_view_edges",
+                                                              "sharpen_focus_view",
+                                                              "eye_gaze_prediction_latency_ms",
+                                                              "dynamic_resolution_min",
+                                                              "dynamic_resolution_budget",
+                                                              "debug_focus_view",
+                                                              "debug_eye_gaze"};
+            return LiveOptions.count(name);
+        }
+
+        struct LiveOptionValues {
+            float horizontalFocusOffset;
+            float verticalFocusOffset;
+            float horizontalFocusWideningMultiplier;
+            float verticalFocusWideningMultiplier;
+            float focusWideningDeadzone;
+            float smoothenFocusViewEdges;
+            float sharpenFocusView;
+            float eyeGazePredictionLatency;
+            float dynamicResolutionMinScale;
+            float dynamicResolutionCompositionBudget;
+            bool debugFocusView;
+            bool debugEyeGaze;
+        };
+
+        LiveOptionValues getLiveOptionValues() const {
+            return {m_horizontalFocusOffset,
+                    m_verticalFocusOffset,
+                    m_horizontalFocusWideningMultiplier,
+                    m_verticalFocusWideningMultiplier,
+                    m_focusWideningDeadzone,
+                    m_smoothenFocusViewEdges,
+                    m_sharpenFocusView,
+                    m_eyeGazePredictionLatency,
+                    m_dynamicResolutionMinScale,
+                    m_dynamicResolutionCompositionBudget,
+                    m_debugFocusView,
+                    m_debugEyeGaze};
+        }
+
+        void setLiveOptionValues(const LiveOptionValues& values) {
+            m_horizontalFocusOffset = values.horizontalFocusOffset;
+            m_verticalFocusOffset = values.verticalFocusOffset;
+            m_horizontalFocusWideningMultiplier = values.horizontalFocusWideningMultiplier;
+            m_verticalFocusWideningMultiplier = values.verticalFocusWideningMultiplier;
+            m_focusWideningDeadzone = values.focusWideningDeadzone;
+            m_smoothenFocusViewEdges = values.smoothenFocusViewEdges;
+            m_sharpenFocusView = values.sharpenFocusView;
+            m_eyeGazePredictionLatency = values.eyeGazePredictionLatency;
+            m_dynamicResolutionMinScale = values.dynamicResolutionMinScale;
+            m_dynamicResolutionCompositionBudget = values.dynamicResolutionCompositionBudget;
+            m_debugFocusView = values.debugFocusView;
+            m_debugEyeGaze = values.debugEyeGaze;
+        }
+
+        // Watch the file the users may edit, so that the settings can be tuned without restarting the application.
+        void startConfigurationWatcher() {
+            if (m_configurationWatcherThread.joinable()) {
+                return;
+            }
+
+            m_configurationWatcherExit.create(wil::EventOptions::ManualReset);
+            m_configurationWatcherThread = std::thread([&] { configurationWatcherThread(); });
+        }
+
+        void stopConfigurationWatcher() {
+            if (m_configurationWatcherThread.joinable()) {
+                m_configurationWatcherExit.SetEvent();
+                m_configurationWatcherThread.join();
+            }
+        }
+
+        void configurationWatcherThread() {
+            SetThreadDescription(GetCurrentThread(), L"Quad-Views Configuration Watcher");
+
+            // The log file lives in the same folder, so the notifications must be filtered.
+            const std::filesystem::path configPath = localAppData / "settings.cfg";
+            wil::unique_hfind_change change(FindFirstChangeNotificationW(
+                localAppData.c_str(), FALSE, FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME));
+            if (!change) {
+                ErrorLog(fmt::format("Failed to watch '{}': {}\n", localAppData.string(), GetLastError()));
+                return;
+            }
+
+            std::error_code ec;
+            auto lastWriteTime = std::filesystem::last_write_time(configPath, ec);
+            const HANDLE handles[] = {m_configurationWatcherExit.get(), change.get()};
+            while (WaitForMultipleObjects((DWORD)std::size(handles), handles, FALSE, INFINITE) == WAIT_OBJECT_0 + 1) {
+                const auto writeTime = std::filesystem::last_write_time(configPath, ec);
+                if (writeTime != lastWriteTime) {
+                    TraceLoggingWrite(g_traceProvider, "ConfigurationChanged");
+                    lastWriteTime = writeTime;
+                    m_configurationChanged = true;
+                }
+
+                if (!FindNextChangeNotification(change.get())) {
+                    break;
+                }
+            }
+        }
+
+        // Only the live options are applied. A change to any other option is reported, and will be applied upon the
+        // next start of the application.
+        void reloadConfiguration() {
+            TraceLocalActivity(local);
+            TraceLoggingWriteStart(local, "ReloadConfiguration");
+
+            Log("Reloading configuration\n");
+            const std::vector<std::string> defaultConfiguration = ReadConfiguration(dllHome / "settings.cfg");
+            const std::vector<std::string> userConfiguration = ReadConfiguration(localAppData / "settings.cfg");
+
+            const std::map<std::string, std::string> appliedOptions = std::exchange(m_configurationOptions, {});
+            LiveOptionValues reloadedValues;
+            {
+                // The live options are read by the frame loop, possibly from other threads.
+                std::unique_lock lock(m_liveSettingsMutex);
+
+                // An option removed from the files goes back to its default value.
+                setLiveOptionValues(m_liveOptionDefaults);
+                m_isReloadingConfiguration = true;
+                ParseConfiguration(defaultConfiguration);
+                ParseConfiguration(userConfiguration);
+                m_isReloadingConfiguration = false;
+                reloadedValues = getLiveOptionValues();
+            }
+
+            // Keep tracking the values the non-live options were applied with.
+            std::map<std::string, std::string> reloadedOptions = std::exchange(m_configurationOptions, appliedOptions);
+            for (const auto& [name, value] : reloadedOptions) {
+                if (IsLiveOption(name)) {
+                    m_configurationOptions.insert_or_assign(name, value);
+                    continue;
+                }
+
+                const auto it = appliedOptions.find(name);
+                if (it == appliedOptions.cend() || it->second != value) {
+                    Log(fmt::format("  Option '{}={}' will be applied after a restart\n", name, value));
+                }
+            }
+
+            TraceLoggingWriteStop(local,
+                                  "ReloadConfiguration",
+                                  TLArg(reloadedValues.horizontalFocusOffset, "FoveatedHorizontalOffset"),
+                                  TLArg(reloadedValues.verticalFocusOffset, "FoveatedVerticalOffset"),
+                                  TLArg(reloadedValues.smoothenFocusViewEdges, "SmoothenEdges"),
+                                  TLArg(reloadedValues.sharpenFocusView, "SharpenFocusView"));
         }
 
         bool ParseConfigurationStatement(const std::string& line, unsigned int lineNumber, bool active) {
@@ -2922,9 +6569,13 @@ namespace openxr_api_layer {
                     return active;
                 }
 
-                // Toggle active section.
+                // Toggle active section. The "app=" and "exe=" sections match the whole name, rather than a part of it.
                 if (line[0] == '[' && line[line.size() - 1] == ']') {
-                    if (line.substr(1, 4) == "app:") {
+                    if (line.substr(1, 4) == "app=") {
+                        return GetApplicationName() == line.substr(5, line.size() - 6);
+                    } else if (line.substr(1, 4) == "exe=") {
+                        return GetApplicationExecutableName() == line.substr(5, line.size() - 6);
+                    } else if (line.substr(1, 4) == "app:") {
                         return GetApplicationName().find(line.substr(5, line.size() - 6)) != std::string::npos;
                     } else if (line.substr(1, 4) == "exe:") {
                         return GetApplicationExecutableName().find(line.substr(5, line.size() - 6)) !=
@@ -2945,6 +6596,12 @@ namespace openxr_api_layer {
                     const std::string name = line.substr(0, offset);
                     const std::string value = line.substr(offset + 1);
 
+                    // Options that may be repeated in several sections are only effective with their last value.
+                    m_configurationOptions.insert_or_assign(name, value);
+                    if (m_isReloadingConfiguration && !IsLiveOption(name)) {
+                        return active;
+                    }
+
                     bool parsed = false;
                     if (name == "peripheral_multiplier") {
                         m_peripheralPixelDensity = std::max(0.1f, std::stof(value));
@@ -2992,7 +6649,7 @@ namespace openxr_api_layer {
                         m_forceNoEyeTracking = std::stoi(value);
                         parsed = true;
                     } else if (name == "force_focus_fov_quirk") {
-                        m_needFocusFovCorrectionQuirk = m_needFocusFovCorrectionQuirk || std::stoi(value);
+                        m_needFocusFovCorrectionQuirk = std::stoi(value);
                         parsed = true;
                     } else if (name == "smoothen_focus_view_edges") {
                         m_smoothenFocusViewEdges = std::clamp(std::stof(value), 0.f, 0.5f);
@@ -3000,6 +6657,60 @@ namespace openxr_api_layer {
                     } else if (name == "sharpen_focus_view") {
                         m_sharpenFocusView = std::clamp(std::stof(value), 0.f, 1.f);
                         parsed = true;
+                    } else if (name == "adaptive_sharpening") {
+                        m_useAdaptiveSharpening = std::stoi(value);
+                        parsed = true;
+                    } else if (name == "fused_sharpening") {
+                        m_useFusedSharpening = std::stoi(value);
+                        parsed = true;
+                    } else if (name == "focus_visibility_mask") {
+                        m_useFocusVisibilityMask = std::stoi(value);
+                        parsed = true;
+                    } else if (name == "focus_layer") {
+                        m_useFocusLayer = std::stoi(value);
+                        parsed = true;
+                    } else if (name == "depth_composition") {
+                        m_useDepthComposition = std::stoi(value);
+                        parsed = true;
+                    } else if (name == "depth_composition_scale") {
+                        m_depthCompositionScale = std::clamp(std::stof(value), 0.25f, 1.f);
+                        parsed = true;
+                    } else if (name == "peripheral_upscaling") {
+                        m_usePeripheralUpscaling = std::stoi(value);
+                        parsed = true;
+                    } else if (name == "sharpen_fp16") {
+                        m_useFp16Sharpening = std::stoi(value);
+                        parsed = true;
+                    } else if (name == "eye_gaze_prediction") {
+                        m_useEyeGazePrediction = std::stoi(value);
+                        parsed = true;
+                    } else if (name == "eye_gaze_prediction_latency_ms") {
+                        m_eyeGazePredictionLatency = std::clamp(std::stof(value), 0.f, 50.f) / 1000.f;
+                        parsed = true;
+                    } else if (name == "eye_tracking_thread") {
+                        m_useEyeTrackingThread = std::stoi(value);
+                        parsed = true;
+                    } else if (name == "eye_tracking_thread_rate") {
+                        m_eyeTrackingThreadRate = std::clamp(std::stoi(value), 30, 1000);
+                        parsed = true;
+                    } else if (name == "frame_statistics") {
+                        m_useFrameStatistics = std::stoi(value);
+                        parsed = true;
+                    } else if (name == "frame_statistics_interval") {
+                        m_frameStatisticsInterval = std::chrono::seconds(std::max(std::stoi(value), 1));
+                        parsed = true;
+                    } else if (name == "async_composition") {
+                        m_useAsyncComposition = std::stoi(value);
+                        parsed = true;
+                    } else if (name == "dynamic_resolution") {
+                        m_useDynamicResolution = std::stoi(value);
+                        parsed = true;
+                    } else if (name == "dynamic_resolution_min") {
+                        m_dynamicResolutionMinScale = std::clamp(std::stof(value), 0.25f, 1.f);
+                        parsed = true;
+                    } else if (name == "dynamic_resolution_budget") {
+                        m_dynamicResolutionCompositionBudget = std::clamp(std::stof(value), 0.02f, 0.5f);
+                        parsed = true;
                     } else if (name == "fov_tangent_x") {
                         m_fovTangentX = std::clamp(std::stof(value), 0.1f, 1.f);
                         parsed = true;
@@ -3009,6 +6720,15 @@ namespace openxr_api_layer {
                     } else if (name == "turbo_mode") {
                         m_useTurboMode = std::stoi(value);
                         parsed = true;
+                    } else if (name == "preacquire_output") {
+                        m_usePreacquireOutput = std::stoi(value);
+                        parsed = true;
+                    } else if (name == "stereo_view_cache") {
+                        m_useStereoViewCache = std::stoi(value);
+                        parsed = true;
+                    } else if (name == "hot_reload") {
+                        m_useHotReload = std::stoi(value);
+                        parsed = true;
                     } else if (name == "unadvertise") {
                         m_unadvertiseQuadViews = std::stoi(value);
                         parsed = true;
@@ -3062,7 +6782,9 @@ namespace openxr_api_layer {
         bool m_useQuadViews{false};
         bool m_requestedFoveatedRendering{false};
         bool m_requestedDepthSubmission{false};
+        bool m_requestedVisibilityMask{false};
         bool m_requestedD3D11{false};
+        bool m_requestedD3D12{false};
         bool m_useFovTangent{false};
         std::string m_runtimeName;
         XrSystemId m_systemId{XR_NULL_SYSTEM_ID};
@@ -3086,21 +6808,81 @@ namespace openxr_api_layer {
         bool m_forceNoEyeTracking{false};
         float m_smoothenFocusViewEdges{0.2f};
         float m_sharpenFocusView{0.7f};
+        bool m_useAdaptiveSharpening{false};
+        // The strength used for the current frame, after adaptation to the motion.
+        float m_sharpeningStrength{0.f};
+        float m_adaptiveSharpeningFactor{1.f};
+        bool m_useFusedSharpening{false};
+        bool m_usePeripheralUpscaling{false};
+        bool m_useFocusLayer{false};
+        bool m_useDepthComposition{false};
+        float m_depthCompositionScale{1.f};
+        bool m_useEyeGazePrediction{false};
+        bool m_useEyeTrackingThread{false};
+        int m_eyeTrackingThreadRate{200};
+        bool m_useDynamicResolution{false};
+        // Only with D3D12. Moving the D3D11 composition off the application context would need a second device, and
+        // the application swapchain images to be shareable with it, which runtimes do not guarantee.
+        bool m_useAsyncComposition{false};
+        bool m_useFrameStatistics{true};
+        std::chrono::seconds m_frameStatisticsInterval{60};
+        float m_dynamicResolutionMinScale{0.7f};
+        // The fraction of the display period that the composition may take on the GPU.
+        float m_dynamicResolutionCompositionBudget{0.1f};
+        float m_eyeGazePredictionLatency{0.f};
+        std::optional<bool> m_useFp16Sharpening;
         float m_fovTangentX{1.f};
         float m_fovTangentY{1.f};
         bool m_useTurboMode{true};
+        bool m_usePreacquireOutput{true};
         bool m_unadvertiseQuadViews{false};
+        bool m_useHotReload{false};
+
+        // The options found in the configuration files, with their value.
+        std::map<std::string, std::string> m_configurationOptions;
+        bool m_isReloadingConfiguration{false};
+        // Held exclusively while the live options are modified, and shared while the frame loop reads them.
+        std::shared_mutex m_liveSettingsMutex;
+        std::thread m_configurationWatcherThread;
+        wil::unique_event m_configurationWatcherExit;
+        std::atomic<bool> m_configurationChanged{false};
 
         bool m_needComputeBaseFov{true};
+        bool m_useStereoViewCache{true};
+        bool m_needRefreshStereoView{false};
         XrFovf m_cachedEyeFov[xr::QuadView::Count]{};
         XrPosef m_cachedEyePoses[xr::StereoView::Count]{};
+        xr::math::StereoProjection m_stereoProjection;
         XrVector2f m_centerOfFov[xr::StereoView::Count]{};
         XrVector2f m_eyeGaze[xr::StereoView::Count]{};
 
         XrExtent2Di m_fullFovResolution{};
-
+        // The portion of the full FOV swapchain being rendered, smaller than m_fullFovResolution when dynamic
+        // resolution is lowering the resolution.
+        XrExtent2Di m_fullFovRenderResolution{};
+
+        // Swapchain states are stored in a fixed-size table. Lookups do not take any lock: the handle of a slot is
+        // only published once its state is fully constructed. Only creation and destruction are serialized.
+        static constexpr uint32_t MaxSwapchains = 256;
+        struct SwapchainSlot {
+            std::atomic<XrSwapchain> handle{XR_NULL_HANDLE};
+            std::unique_ptr<Swapchain> state;
+        };
         std::mutex m_swapchainsMutex;
-        std::unordered_map<XrSwapchain, Swapchain> m_swapchains;
+        SwapchainSlot m_swapchains[MaxSwapchains];
+        // One past the last slot ever used, to bound the lookups.
+        std::atomic<uint32_t> m_swapchainsHighWater{0};
+
+        // Reservations that are not used within this many frames are released.
+        static constexpr uint64_t SwapchainPoolRetentionFrames = 900;
+        // Reservations can be made from xrCreateSwapchain() while xrEndFrame() picks from the pool.
+        std::mutex m_swapchainPoolMutex;
+        std::vector<std::unique_ptr<PooledSwapchain>> m_swapchainPool;
+        uint64_t m_swapchainPoolFrame{0};
+        // The sharpened images and their views.
+        std::unique_ptr<Swapchain> m_sharpenedImages;
+        // The largest recommended resolution of the focus views, to pre-allocate the sharpened images.
+        XrExtent2Di m_recommendedFocusResolution{};
 
         std::mutex m_spacesMutex;
         std::set<XrSpace> m_gazeSpaces;
@@ -3112,12 +6894,16 @@ namespace openxr_api_layer {
         XrAction m_eyeGazeAction{XR_NULL_HANDLE};
         XrSpace m_eyeSpace{XR_NULL_HANDLE};
         XrSpace m_viewSpace{XR_NULL_HANDLE};
+        XrSpace m_localSpace{XR_NULL_HANDLE};
 
         bool m_needPollEvent{true};
         bool m_needAttachActionSets{true};
         bool m_needSyncActions{true};
         uint64_t m_framesElapsed{0};
 
+        std::thread m_compositionWarmUpThread;
+        std::exception_ptr m_compositionWarmUpException;
+
         ComPtr<ID3D11Device5> m_applicationDevice;
         ComPtr<ID3D11DeviceContext4> m_renderContext;
         ComPtr<ID3DDeviceContextState> m_layerContextState;
@@ -3126,18 +6912,50 @@ namespace openxr_api_layer {
         ComPtr<ID3D11Buffer> m_projectionVSConstants;
         ComPtr<ID3D11Buffer> m_projectionPSConstants;
         ComPtr<ID3D11VertexShader> m_projectionVS;
+        ComPtr<ID3D11GeometryShader> m_projectionGS;
         ComPtr<ID3D11PixelShader> m_projectionPS;
+        ComPtr<ID3D11DepthStencilState> m_depthWriteState;
+        ComPtr<ID3D11PixelShader> m_depthProjectionPS;
         ComPtr<ID3D11Buffer> m_sharpeningCSConstants;
         ComPtr<ID3D11ComputeShader> m_sharpeningCS;
         ComPtr<ID3D11Texture2D> m_blankTexture;
         ComPtr<ID3D11ShaderResourceView> m_srvBlankTexture;
 
+        ComPtr<ID3D12Device> m_d3d12ApplicationDevice;
+        ComPtr<ID3D12CommandQueue> m_d3d12ApplicationQueue;
+        ComPtr<ID3D12RootSignature> m_d3d12ProjectionRootSignature;
+        std::map<DXGI_FORMAT, ComPtr<ID3D12PipelineState>> m_d3d12ProjectionPSO;
+        std::map<DXGI_FORMAT, ComPtr<ID3D12PipelineState>> m_d3d12DepthProjectionPSO;
+        ComPtr<ID3D12RootSignature> m_d3d12SharpeningRootSignature;
+        ComPtr<ID3D12PipelineState> m_d3d12SharpeningPSO;
+        ComPtr<ID3D12Resource> m_d3d12ConstantsBuffer;
+        uint8_t* m_d3d12MappedConstants{nullptr};
+        ComPtr<ID3D12DescriptorHeap> m_d3d12ResourceHeap;
+        uint32_t m_d3d12ResourceDescriptorSize{0};
+        ComPtr<ID3D12QueryHeap> m_d3d12TimestampQueryHeap;
+        ComPtr<ID3D12Resource> m_d3d12TimestampReadback;
+        uint64_t m_d3d12TimestampFrequency{0};
+        ComPtr<ID3D12Resource> m_d3d12BlankTexture;
+        ComPtr<ID3D12DescriptorHeap> m_d3d12SrvBlankTexture;
+        D3D12CompositionContext m_d3d12CompositionContext[3];
+        uint32_t m_d3d12CompositionContextIndex{0};
+        std::shared_ptr<graphics::IGraphicsFence> m_d3d12CompositionFence;
+        uint64_t m_d3d12CompositionFenceValue{0};
+        ComPtr<ID3D12CommandQueue> m_d3d12CompositionQueue;
+        ComPtr<ID3D12Fence> m_d3d12ApplicationFence;
+        std::atomic<uint64_t> m_d3d12ApplicationFenceValue{0};
+
         // Turbo mode.
-        std::chrono::time_point<std::chrono::steady_clock> m_lastFrameWaitTimestamp{};
         std::mutex m_frameMutex;
         XrTime m_waitedFrameTime;
         std::mutex m_asyncWaitMutex;
-        std::future<void> m_asyncWaitPromise;
+        std::condition_variable m_asyncWaitCondition;
+        std::thread m_asyncWaitThread;
+        XrSession m_asyncWaitSession{XR_NULL_HANDLE};
+        bool m_asyncWaitRequested{false};
+        bool m_asyncWaitThreadExit{false};
+        // Whether a wait was started and not consumed by xrEndFrame() yet. Only accessed under m_frameMutex.
+        bool m_asyncWaitPending{false};
         XrTime m_lastPredictedDisplayTime{0};
         XrTime m_lastPredictedDisplayPeriod{0};
         bool m_lastShouldRender{true};
@@ -3148,8 +6966,24 @@ namespace openxr_api_layer {
 
         // FOV submission quirk.
         bool m_needFocusFovCorrectionQuirk{false};
+        // Ring of the focus FOVs for the last display times, overwritten by the newest entries. Each entry is read
+        // with a sequence lock, only the writers are serialized.
+        struct FocusFovEntry {
+            std::atomic<uint32_t> sequence{0};
+            XrTime displayTime{0};
+            XrFovf fov[xr::StereoView::Count]{};
+        };
         std::mutex m_focusFovMutex;
-        std::map<XrTime, std::pair<XrFovf, XrFovf>> m_focusFovForDisplayTime;
+        FocusFovEntry m_focusFovForDisplayTime[16];
+        uint32_t m_focusFovForDisplayTimeIndex{0};
+
+        // Hidden area cutout for the peripheral views, as (left, right, down, up) tangents.
+        bool m_useFocusVisibilityMask{false};
+        std::mutex m_focusVisibilityMaskMutex;
+        std::array<float, 4> m_focusVisibilityMaskCutout[xr::StereoView::Count]{};
+        std::optional<std::array<float, 4>> m_focusVisibilityMaskPublishedCutout[xr::StereoView::Count];
+        bool m_focusVisibilityMaskEventPending[xr::StereoView::Count]{};
+        std::chrono::steady_clock::time_point m_focusVisibilityMaskLastUpdate[xr::StereoView::Count]{};
 
         bool m_isSupportedGraphicsApi{false};
 
@@ -3158,11 +6992,37 @@ namespace openxr_api_layer {
         std::optional<XrVector3f> m_lastGoodEyeGaze;
         bool m_loggedEyeTrackingWarning{false};
 
+        // Eye gaze prediction.
+        EyeGazeSample m_eyeGazeSamples[8];
+        uint32_t m_eyeGazeSampleIndex{0};
+        uint32_t m_eyeGazeSampleCount{0};
+
+        // Eye tracking thread.
+        struct EyeGazeSampleSlot {
+            std::atomic<uint32_t> sequence{0};
+            std::atomic<XrTime> time{0};
+            std::atomic<float> x{0};
+            std::atomic<float> y{0};
+            std::atomic<float> z{0};
+        };
+        bool m_hasPerformanceCounterTime{false};
+        std::thread m_eyeTrackingThread;
+        std::atomic<bool> m_eyeTrackingThreadExit{false};
+        std::atomic<bool> m_eyeTrackingThreadFailed{false};
+        EyeGazeSampleSlot m_eyeTrackingSamples[16];
+        std::atomic<uint64_t> m_eyeTrackingSampleWriteCount{0};
+        uint64_t m_eyeTrackingSampleReadCount{0};
+        std::optional<EyeGazeSample> m_eyeTrackingLatestSample;
+
         bool m_debugFocusView{false};
         bool m_debugEyeGaze{false};
         bool m_debugSimulateTracking{false};
         bool m_debugKeys{false};
 
+        // The values of the live options before any configuration file was parsed. Declared after all of them, so that
+        // they are initialized first.
+        LiveOptionValues m_liveOptionDefaults{getLiveOptionValues()};
+
         std::shared_ptr<general::ITimer> m_appFrameCpuTimer;
         std::shared_ptr<general::ITimer> m_appRenderCpuTimer;
         std::shared_ptr<graphics::IGraphicsTimer> m_appFrameGpuTimer[3];
@@ -3170,10 +7030,127 @@ namespace openxr_api_layer {
 
         uint64_t m_lastAppRenderCpuTime{0};
         uint64_t m_lastAppFrameGpuTime{0};
-        std::deque<std::chrono::time_point<std::chrono::steady_clock>> m_frameTimes;
+        std::chrono::time_point<std::chrono::steady_clock> m_fpsWindowStart{};
+        uint32_t m_framesInFpsWindow{0};
+        uint32_t m_fps{0};
+        FrameArena m_frameArena;
 
         std::shared_ptr<graphics::IGraphicsTimer> m_compositionTimer[3 * xr::StereoView::Count];
         uint32_t m_compositionTimerIndex{0};
+        uint64_t m_lastCompositionGpuTime{0};
+        // Per-stage timers, only used with D3D11. With D3D12, the stages are delimited by timestamp queries.
+        std::shared_ptr<graphics::IGraphicsTimer> m_sharpeningTimer[3 * xr::StereoView::Count];
+        std::shared_ptr<graphics::IGraphicsTimer> m_projectionTimer[3 * xr::StereoView::Count];
+        bool m_sharpeningTimerStarted[3 * xr::StereoView::Count]{};
+        std::optional<uint64_t> m_lastSharpeningGpuTime;
+        uint64_t m_lastProjectionGpuTime{0};
+        // The time spent waiting on the output swapchains during the composition of the current frame.
+        uint64_t m_outputWaitTime{0};
+
+        // Always-on frame statistics, in microseconds.
+        using FrameStatistics = general::RollingStatistics<1024>;
+        FrameStatistics m_appCpuTimeStats;
+        FrameStatistics m_appRenderCpuTimeStats;
+        FrameStatistics m_appGpuTimeStats;
+        FrameStatistics m_compositionGpuTimeStats;
+        FrameStatistics m_sharpeningGpuTimeStats;
+        FrameStatistics m_projectionGpuTimeStats;
+        FrameStatistics m_waitFrameTimeStats;
+        FrameStatistics m_outputWaitTimeStats;
+
+        // Statistics recorded from any thread the application calls from.
+        class SharedFrameStatistics {
+          public:
+            void add(uint64_t value) {
+                std::unique_lock lock(m_mutex);
+                m_stats.add(value);
+            }
+
+            void reset() {
+                std::unique_lock lock(m_mutex);
+                m_stats.reset();
+            }
+
+            template <size_t Count>
+            std::array<uint64_t, Count> percentiles(const std::array<uint32_t, Count>& ranks) const {
+                std::unique_lock lock(m_mutex);
+                return m_stats.percentiles(ranks);
+            }
+
+          private:
+            mutable std::mutex m_mutex;
+            FrameStatistics m_stats;
+        };
+
+        // Measure the CPU time spent in the layer during an API call, excluding the time spent in the calls chained to
+        // the downstream implementation.
+        class LayerOverheadScope {
+          public:
+            LayerOverheadScope(SharedFrameStatistics& stats, bool enabled)
+                : m_stats(stats), m_enabled(enabled), m_start(std::chrono::steady_clock::now()),
+                  m_previous(std::exchange(t_current, this)) {
+            }
+
+            ~LayerOverheadScope() {
+                t_current = m_previous;
+                if (m_enabled) {
+                    const auto elapsed = std::chrono::steady_clock::now() - m_start - m_downstreamTime;
+                    m_stats.add(std::max<int64_t>(
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(), 0));
+                }
+            }
+
+            template <typename Call>
+            auto chain(Call&& call) {
+                // The calls made within an already chained call are already accounted for.
+                LayerOverheadScope* const current = std::exchange(t_current, nullptr);
+                auto scopeGuard = MakeScopeGuard([&] { t_current = current; });
+
+                const auto start = std::chrono::steady_clock::now();
+                if constexpr (std::is_void_v<decltype(call())>) {
+                    call();
+                    m_downstreamTime += std::chrono::steady_clock::now() - start;
+                } else {
+                    const auto result = call();
+                    m_downstreamTime += std::chrono::steady_clock::now() - start;
+                    return result;
+                }
+            }
+
+            // Chain a call from a helper, on behalf of the API call in progress on this thread if any.
+            template <typename Call>
+            static auto chainDownstream(Call&& call) {
+                if (t_current) {
+                    return t_current->chain(std::forward<Call>(call));
+                }
+                return call();
+            }
+
+          private:
+            static inline thread_local LayerOverheadScope* t_current{nullptr};
+
+            SharedFrameStatistics& m_stats;
+            const bool m_enabled;
+            const std::chrono::time_point<std::chrono::steady_clock> m_start;
+            LayerOverheadScope* const m_previous;
+            std::chrono::steady_clock::duration m_downstreamTime{};
+        };
+
+        // Layer CPU overhead, in nanoseconds. The API calls may come from different threads.
+        SharedFrameStatistics m_waitFrameOverheadStats;
+        SharedFrameStatistics m_locateViewsOverheadStats;
+        SharedFrameStatistics m_endFrameOverheadStats;
+        SharedFrameStatistics m_acquireSwapchainImageOverheadStats;
+        SharedFrameStatistics m_releaseSwapchainImageOverheadStats;
+
+        uint32_t m_turboFrames{0};
+        uint32_t m_turboPipelinedFrames{0};
+        std::chrono::time_point<std::chrono::steady_clock> m_lastFrameStatisticsLog{};
+
+        // Dynamic resolution.
+        float m_dynamicResolutionScale{1.f};
+        float m_smoothedCompositionGpuTime{0.f};
+        uint32_t m_framesSinceResolutionChange{0};
     };
 
     // This method is required by the framework to instantiate your OpenXrApi implementation.
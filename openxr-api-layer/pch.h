@@ -30,12 +30,14 @@
 // Standard library.
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cstdarg>
 #include <ctime>
 #include <deque>
 #include <iomanip>
 #include <iostream>
 #include <mutex>
+#include <shared_mutex>
 #include <filesystem>
 #include <fstream>
 #include <sstream>
@@ -44,8 +46,11 @@
 #include <optional>
 #include <map>
 #include <set>
+#include <tuple>
 #include <chrono>
+#include <condition_variable>
 #include <future>
+#include <thread>
 #define _USE_MATH_DEFINES
 #include <cmath>
 
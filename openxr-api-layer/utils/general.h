@@ -47,6 +47,53 @@ namespace openxr_api_layer::utils::general {
 
     std::shared_ptr<ITimer> createTimer();
 
+    // A fixed-size history of samples to compute rolling percentiles. Samples are written by a single thread, and no
+    // allocation or locking happens when recording a sample.
+    template <size_t Size>
+    class RollingStatistics {
+      public:
+        void add(uint64_t value) {
+            m_samples[m_index] = value;
+            m_index = (m_index + 1) % Size;
+            m_count = std::min(m_count + 1, Size);
+        }
+
+        void reset() {
+            m_index = 0;
+            m_count = 0;
+        }
+
+        size_t count() const {
+            return m_count;
+        }
+
+        // Compute the requested percentiles (in the 0-100 range), in increasing order.
+        template <size_t Count>
+        std::array<uint64_t, Count> percentiles(const std::array<uint32_t, Count>& ranks) const {
+            std::array<uint64_t, Count> result{};
+            if (!m_count) {
+                return result;
+            }
+
+            std::array<uint64_t, Size> sorted;
+            std::copy_n(m_samples.cbegin(), m_count, sorted.begin());
+            auto begin = sorted.begin();
+            const auto end = sorted.begin() + m_count;
+            for (size_t i = 0; i < Count; i++) {
+                const auto nth = sorted.begin() + std::min((m_count * ranks[i]) / 100, m_count - 1);
+                std::nth_element(begin, nth, end);
+                result[i] = *nth;
+                begin = nth;
+            }
+            return result;
+        }
+
+      private:
+        std::array<uint64_t, Size> m_samples{};
+        size_t m_index{0};
+        size_t m_count{0};
+    };
+
     static inline bool startsWith(const std::string& str, const std::string& substr) {
         return str.find(substr) == 0;
     }
@@ -77,6 +77,103 @@ namespace xr {
             return true;
         }
 
+        // A precomputed mapping between the view space and the tangent space of both eyes, for a fixed FOV and eye
+        // pose. It is the closed form of ProjectPoint() and ComputeBoundingFov(), with both eyes evaluated together.
+        struct StereoProjection {
+            XrFovf fov[xr::StereoView::Count]{};
+
+            // The matrices to compute the projected (x, y) for both eyes with a single transform. The numerator holds
+            // the (left.x, left.y, right.x, right.y) columns of the view to camera transform, and the denominator
+            // the matching w columns.
+            DirectX::XMFLOAT4X4 numerator{};
+            DirectX::XMFLOAT4X4 denominator{};
+
+            // The bounds of the tangent space for each eye, as (left, right, down, up) center and half extent.
+            DirectX::XMFLOAT4 tangentCenter[xr::StereoView::Count]{};
+            DirectX::XMFLOAT4 tangentHalfExtent[xr::StereoView::Count]{};
+        };
+
+        static StereoProjection ComputeStereoProjection(const XrView (&eyeInViewSpace)[xr::StereoView::Count]) {
+            StereoProjection projection;
+
+            DirectX::XMMATRIX viewToCamera[xr::StereoView::Count];
+            for (uint32_t eye = 0; eye < xr::StereoView::Count; eye++) {
+                const XrFovf& fov = eyeInViewSpace[eye].fov;
+                projection.fov[eye] = fov;
+
+                // Same as ProjectPoint().
+                const auto cameraProjection = ComposeProjectionMatrix(fov, {0.001f, 100.f});
+                const auto cameraView = LoadXrPose(eyeInViewSpace[eye].pose);
+                viewToCamera[eye] = DirectX::XMMatrixTranspose(DirectX::XMMatrixMultiply(cameraProjection, cameraView));
+
+                const float tanLeft = std::tan(fov.angleLeft);
+                const float tanRight = std::tan(fov.angleRight);
+                const float tanDown = std::tan(fov.angleDown);
+                const float tanUp = std::tan(fov.angleUp);
+                projection.tangentCenter[eye] = {(tanRight + tanLeft) / 2.f,
+                                                 (tanRight + tanLeft) / 2.f,
+                                                 (tanUp + tanDown) / 2.f,
+                                                 (tanUp + tanDown) / 2.f};
+                projection.tangentHalfExtent[eye] = {(tanRight - tanLeft) / 2.f,
+                                                     (tanRight - tanLeft) / 2.f,
+                                                     (tanUp - tanDown) / 2.f,
+                                                     (tanUp - tanDown) / 2.f};
+            }
+
+            // The rows of the transposed matrices are the columns of the original ones.
+            const auto& left = viewToCamera[xr::StereoView::Left];
+            const auto& right = viewToCamera[xr::StereoView::Right];
+            DirectX::XMStoreFloat4x4(
+                &projection.numerator,
+                DirectX::XMMatrixTranspose(DirectX::XMMATRIX(left.r[0], left.r[1], right.r[0], right.r[1])));
+            DirectX::XMStoreFloat4x4(
+                &projection.denominator,
+                DirectX::XMMatrixTranspose(DirectX::XMMATRIX(left.r[3], left.r[3], right.r[3], right.r[3])));
+
+            return projection;
+        }
+
+        static void ProjectPoint(const StereoProjection& projection,
+                                 const XrVector3f& forward,
+                                 XrVector2f (&projectedPosition)[xr::StereoView::Count],
+                                 bool (&isValid)[xr::StereoView::Count]) {
+            const auto point = DirectX::XMVectorSet(forward.x, forward.y, forward.z, 1.f);
+            const auto numerator = DirectX::XMVector3Transform(point, DirectX::XMLoadFloat4x4(&projection.numerator));
+            const auto denominator =
+                DirectX::XMVector3Transform(point, DirectX::XMLoadFloat4x4(&projection.denominator));
+
+            DirectX::XMFLOAT4 w;
+            DirectX::XMStoreFloat4(&w, denominator);
+            DirectX::XMFLOAT4 ndc;
+            DirectX::XMStoreFloat4(&ndc, DirectX::XMVectorDivide(numerator, denominator));
+
+            isValid[xr::StereoView::Left] = std::abs(w.x) >= FLT_EPSILON;
+            isValid[xr::StereoView::Right] = std::abs(w.z) >= FLT_EPSILON;
+            projectedPosition[xr::StereoView::Left] = {ndc.x, ndc.y};
+            projectedPosition[xr::StereoView::Right] = {ndc.z, ndc.w};
+        }
+
+        static XrFovf ComputeBoundingFov(const StereoProjection& projection,
+                                         uint32_t eye,
+                                         const XrVector2f& min,
+                                         const XrVector2f& max) {
+            const float width = std::max(0.01f, max.x - min.x);
+            const float height = std::max(0.01f, max.y - min.y);
+            const XrVector2f center = (min + max) / 2.f;
+
+            // Map the edges of the bounding box from NDC to the tangent space of the full FOV.
+            const auto ndc = DirectX::XMVectorSet(
+                center.x - width / 2.f, center.x + width / 2.f, center.y - height / 2.f, center.y + height / 2.f);
+            const auto tangents = DirectX::XMVectorMultiplyAdd(
+                ndc,
+                DirectX::XMLoadFloat4(&projection.tangentHalfExtent[eye]),
+                DirectX::XMLoadFloat4(&projection.tangentCenter[eye]));
+            DirectX::XMFLOAT4 angles;
+            DirectX::XMStoreFloat4(&angles, DirectX::XMVectorATan(tangents));
+
+            return {angles.x, angles.y, angles.w, angles.z};
+        }
+
     } // namespace math
 
 } // namespace xr